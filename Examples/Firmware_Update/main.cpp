@@ -23,7 +23,6 @@ Copyright 2021 Chase Cobb
 #include <stdbool.h>
 #include <map>
 #include <sstream>
-#include <mutex>
 #include <chrono>
 
 #include "HdmiTools.h"
@@ -31,21 +30,9 @@ Copyright 2021 Chase Cobb
 
 #define SPINNER_LENGTH 4
 
-void ProgressUpdate(const char* progressUpdate);
-void PercentComplete(int percentComplete);
-void ErrorMessage(const char* currentErrorMessage);
-void FirmwareUpdateComplete(bool flashSuccessful);
-
 bool firmwareFlashInProgress = false;
 bool firmwareUpdateCompleted = false;
 bool firmwareWasUpdatedSuccessfully = false;
-int updateCompletionPercentage = 0;
-
-// using shared pointers for thread safety
-std::string currentProgress;
-std::string errorMessage;
-
-std::mutex mutexObject;
 
 typedef std::chrono::high_resolution_clock Clock;
 typedef std::chrono::duration<float, std::milli> Duration;
@@ -123,6 +110,19 @@ int main(void)
     pb_erase_text_screen();
     SDL_GameControllerUpdate();
 
+    // Update events are queued by the flashing thread and handled
+    // here, on the render thread, so no locking is needed
+    Conflux::FirmwareUpdateEvent updateEvent;
+    while(hdmiTools->PollFirmwareUpdateEvent(&updateEvent))
+    {
+      if(updateEvent.type == Conflux::FirmwareUpdateEventType::EVENT_UPDATE_COMPLETE)
+      {
+        firmwareWasUpdatedSuccessfully = updateEvent.value != 0;
+        firmwareUpdateCompleted = true;
+        firmwareFlashInProgress = false;
+      }
+    }
+
     if(pad != NULL)
     {
       std::ostringstream oss;
@@ -141,12 +141,13 @@ int main(void)
           if(SDL_GameControllerGetButton(pad, SDL_CONTROLLER_BUTTON_A) == 1)
           {
             // This will flash a firmware located in the directory
-            // of the currently executing program.
+            // of the currently executing program. Progress is polled
+            // and events are drained above, so no callbacks are needed.
             if(hdmiTools->UpdateFirmware(Conflux::UpdateSource::WORKING_DIRECTORY,
-                                      (*ProgressUpdate),
-                                      (*PercentComplete),
-                                      (*ErrorMessage),
-                                      (*FirmwareUpdateComplete)))
+                                      nullptr,
+                                      nullptr,
+                                      nullptr,
+                                      nullptr))
             {
               firmwareFlashInProgress = true;
               previousTime = Clock::now();
@@ -160,15 +161,30 @@ int main(void)
           oss << spin << spin << spin << "  Flashing firmware  " << spin << spin << spin << "\n";
           oss << "Do NOT power off your console!!\n\n";
 
-          mutexObject.lock();
-            oss << "Flash status     : " << currentProgress << "\n";
-          mutexObject.unlock();
+          // One snapshot per frame instead of a callback per byte
+          Conflux::FirmwareUpdateProgress progress;
+          hdmiTools->GetFirmwareUpdateProgress(&progress);
 
-          oss << "Overall progress : " << updateCompletionPercentage << " percent complete" << "\n";
-          
-          mutexObject.lock();
-            oss << "Error detected   : " << errorMessage << "\n";
-          mutexObject.unlock();
+          oss << "Flash status     : " << progress.phase << "\n";
+          oss << "Overall progress : " << progress.percentComplete << " percent complete" << "\n";
+          oss << "Page             : " << progress.pagesDone << " of " << progress.pagesTotal << "\n";
+          oss << "Time remaining   : " << (progress.estimatedRemainingMs / 1000) << " seconds" << "\n";
+          oss << "Error detected   : " << (progress.errorCount > 0 ? progress.lastError : "None") << "\n";
+
+          // Pausing and cancelling take effect once the current page is written
+          oss << "\n----X: Pause    Y: Resume    Back: Cancel----\n";
+          if(SDL_GameControllerGetButton(pad, SDL_CONTROLLER_BUTTON_X) == 1)
+          {
+            hdmiTools->PauseFirmwareUpdate();
+          }
+          else if(SDL_GameControllerGetButton(pad, SDL_CONTROLLER_BUTTON_Y) == 1)
+          {
+            hdmiTools->ResumeFirmwareUpdate();
+          }
+          else if(SDL_GameControllerGetButton(pad, SDL_CONTROLLER_BUTTON_BACK) == 1)
+          {
+            hdmiTools->CancelFirmwareUpdate();
+          }
 
           // Update spinner timer with delta time in milliseconds.
           Duration deltaTime = Clock::now() - previousTime;
@@ -246,44 +262,3 @@ int main(void)
 
   return 0;
 }
-
-/*
-The mutex locks below may not be necessary in this specific
-implementation, but they are included to inform application
-developers that these callbacks are coming from a different 
-thread. So make sure to be safe with any operations you run
-inside these functions!!
-*/
-
-void ProgressUpdate(const char* progressUpdate)
-{
-  mutexObject.lock();
-    currentProgress = std::string(progressUpdate);
-  mutexObject.unlock();
-}
-
-void PercentComplete(int percentComplete)
-{
-  // no need to lock an int assignment  
-  updateCompletionPercentage = percentComplete;
-}
-
-void ErrorMessage(const char* currentErrorMessage)
-{
-  mutexObject.lock();
-    errorMessage = std::string(currentErrorMessage);
-  mutexObject.unlock();
-}
-
-void FirmwareUpdateComplete(bool flashSuccessful)
-{
-  updateCompletionPercentage = 0;
-  firmwareWasUpdatedSuccessfully = flashSuccessful;
-  firmwareUpdateCompleted = true;
-  firmwareFlashInProgress = false;
-
-  mutexObject.lock();
-    currentProgress.clear();
-    errorMessage.clear();
-  mutexObject.unlock();
-}
\ No newline at end of file
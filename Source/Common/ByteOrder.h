@@ -0,0 +1,77 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef BYTEORDER_H
+#define BYTEORDER_H
+
+#include <stdint.h>
+
+namespace Conflux
+{
+    /**
+     * @brief Reads a little endian 16 bit value from a byte buffer.
+     * 
+     * @param data buffer to read from. No alignment is required.
+     * @return uint16_t value read.
+     */
+    inline uint16_t ReadU16LittleEndian(const uint8_t* data)
+    {
+        return (uint16_t)(((uint16_t)data[0]) |
+                          ((uint16_t)data[1] << 8));
+    }
+
+    /**
+     * @brief Reads a little endian 32 bit value from a byte buffer.
+     * 
+     * @param data buffer to read from. No alignment is required.
+     * @return uint32_t value read.
+     */
+    inline uint32_t ReadU32LittleEndian(const uint8_t* data)
+    {
+        return ((uint32_t)data[0]) |
+               ((uint32_t)data[1] << 8) |
+               ((uint32_t)data[2] << 16) |
+               ((uint32_t)data[3] << 24);
+    }
+
+    /**
+     * @brief Writes a 16 bit value to a byte buffer as little endian.
+     * 
+     * @param data buffer to write to. No alignment is required.
+     * @param value value to write.
+     */
+    inline void WriteU16LittleEndian(uint8_t* data, uint16_t value)
+    {
+        data[0] = (uint8_t)(value);
+        data[1] = (uint8_t)(value >> 8);
+    }
+
+    /**
+     * @brief Writes a 32 bit value to a byte buffer as little endian.
+     * 
+     * @param data buffer to write to. No alignment is required.
+     * @param value value to write.
+     */
+    inline void WriteU32LittleEndian(uint8_t* data, uint32_t value)
+    {
+        data[0] = (uint8_t)(value);
+        data[1] = (uint8_t)(value >> 8);
+        data[2] = (uint8_t)(value >> 16);
+        data[3] = (uint8_t)(value >> 24);
+    }
+} // Conflux
+
+#endif // BYTEORDER_H
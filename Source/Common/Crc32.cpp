@@ -0,0 +1,109 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "Crc32.h"
+#include "ByteOrder.h"
+
+namespace Conflux
+{
+    namespace
+    {
+        // 0x04C11DB7 bit reversed, for the reflected algorithm
+        const uint32_t REFLECTED_POLYNOMIAL = 0xEDB88320;
+
+        struct Crc32Tables
+        {
+            uint32_t slice[8][256];
+
+            constexpr Crc32Tables() : slice()
+            {
+                for(uint32_t index = 0; index < 256; ++index)
+                {
+                    uint32_t crc = index;
+                    for(int bit = 0; bit < 8; ++bit)
+                    {
+                        crc = (crc & 0x01) ? (crc >> 1) ^ REFLECTED_POLYNOMIAL : (crc >> 1);
+                    }
+                    slice[0][index] = crc;
+                }
+
+                // slice[n] advances an entry of slice[n - 1] by one more zero byte
+                for(uint32_t index = 0; index < 256; ++index)
+                {
+                    for(int table = 1; table < 8; ++table)
+                    {
+                        uint32_t previous = slice[table - 1][index];
+                        slice[table][index] = (previous >> 8) ^ slice[0][previous & 0xFF];
+                    }
+                }
+            }
+        };
+
+        constexpr Crc32Tables CRC32_TABLES;
+    }
+
+    uint32_t Crc32::Update(uint32_t crc, const uint8_t* data, size_t length)
+    {
+        const uint32_t (*slice)[256] = CRC32_TABLES.slice;
+
+        while(length >= 8)
+        {
+            uint32_t low = ReadU32LittleEndian(data) ^ crc;
+            uint32_t high = ReadU32LittleEndian(data + 4);
+
+            crc = slice[7][low & 0xFF] ^
+                  slice[6][(low >> 8) & 0xFF] ^
+                  slice[5][(low >> 16) & 0xFF] ^
+                  slice[4][low >> 24] ^
+                  slice[3][high & 0xFF] ^
+                  slice[2][(high >> 8) & 0xFF] ^
+                  slice[1][(high >> 16) & 0xFF] ^
+                  slice[0][high >> 24];
+
+            data += 8;
+            length -= 8;
+        }
+
+        while(length-- > 0)
+        {
+            crc = (crc >> 8) ^ slice[0][(crc ^ *data++) & 0xFF];
+        }
+
+        return crc;
+    }
+
+    uint32_t Crc32::UpdateZeros(uint32_t crc, size_t length)
+    {
+        const uint32_t (*slice)[256] = CRC32_TABLES.slice;
+
+        // With eight zero bytes the high word lookups are all slice[n][0] == 0
+        while(length >= 8)
+        {
+            crc = slice[7][crc & 0xFF] ^
+                  slice[6][(crc >> 8) & 0xFF] ^
+                  slice[5][(crc >> 16) & 0xFF] ^
+                  slice[4][crc >> 24];
+            length -= 8;
+        }
+
+        while(length-- > 0)
+        {
+            crc = (crc >> 8) ^ slice[0][crc & 0xFF];
+        }
+
+        return crc;
+    }
+} // Conflux
@@ -0,0 +1,83 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace Conflux
+{
+    /**
+     * @brief Table driven CRC-32 (polynomial 0x04C11DB7, reflected
+     * input and output, final XOR 0xFFFFFFFF). Data is consumed
+     * eight bytes at a time using slicing-by-8 lookup tables that
+     * are generated at compile time.
+     * 
+     */
+    class Crc32
+    {
+    public:
+        /**
+         * @brief Initial value of a running CRC.
+         * 
+         */
+        static const uint32_t INITIAL_VALUE = 0xFFFFFFFF;
+
+        /**
+         * @brief Adds a block of data to a running CRC.
+         * 
+         * @param crc running CRC, starting at INITIAL_VALUE.
+         * @param data data to add.
+         * @param length number of bytes in data.
+         * @return uint32_t updated running CRC.
+         */
+        static uint32_t Update(uint32_t crc, const uint8_t* data, size_t length);
+
+        /**
+         * @brief Adds a run of 0x00 bytes to a running CRC without
+         * needing a zero filled buffer. Used for page padding.
+         * 
+         * @param crc running CRC.
+         * @param length number of zero bytes to add.
+         * @return uint32_t updated running CRC.
+         */
+        static uint32_t UpdateZeros(uint32_t crc, size_t length);
+
+        /**
+         * @brief Converts a running CRC into the final CRC value.
+         * 
+         * @param crc running CRC.
+         * @return uint32_t final CRC value.
+         */
+        static uint32_t Finalize(uint32_t crc) {return crc ^ 0xFFFFFFFF;}
+
+        /**
+         * @brief Computes the final CRC of a block of data.
+         * 
+         * @param data data to checksum.
+         * @param length number of bytes in data.
+         * @return uint32_t final CRC value.
+         */
+        static uint32_t Compute(const uint8_t* data, size_t length)
+        {
+            return Finalize(Update(INITIAL_VALUE, data, length));
+        }
+    };
+} // Conflux
+
+#endif // CRC32_H
@@ -0,0 +1,132 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "FileSystem.h"
+
+#ifdef _XBOX
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+namespace Conflux
+{
+#ifdef _XBOX
+    namespace
+    {
+        const char PATH_SEPARATOR = '\\';
+    }
+
+    bool GetFileInfo(const char* filePath, FileInfo* fileInfo)
+    {
+        WIN32_FILE_ATTRIBUTE_DATA fileAttributes;
+        if(!GetFileAttributesExA(filePath, GetFileExInfoStandard, &fileAttributes) ||
+           (fileAttributes.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+        {
+            return false;
+        }
+
+        fileInfo->size = fileAttributes.nFileSizeLow;
+        fileInfo->lastWriteTime = ((uint64_t)fileAttributes.ftLastWriteTime.dwHighDateTime << 32) |
+                                  fileAttributes.ftLastWriteTime.dwLowDateTime;
+        return true;
+    }
+
+    bool ListDirectory(const char* directoryPath, std::vector<std::string>* fileNames)
+    {
+        WIN32_FIND_DATAA findData;
+        HANDLE findHandle = FindFirstFileA(JoinPath(directoryPath, "*").c_str(), &findData);
+        if(findHandle == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        do
+        {
+            if(!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+            {
+                fileNames->push_back(findData.cFileName);
+            }
+        } while(FindNextFileA(findHandle, &findData));
+
+        FindClose(findHandle);
+        return true;
+    }
+
+    bool MakeDirectory(const char* directoryPath)
+    {
+        return CreateDirectoryA(directoryPath, NULL) || GetLastError() == ERROR_ALREADY_EXISTS;
+    }
+#else
+    namespace
+    {
+        const char PATH_SEPARATOR = '/';
+    }
+
+    bool GetFileInfo(const char* filePath, FileInfo* fileInfo)
+    {
+        struct stat fileStatus;
+        if(stat(filePath, &fileStatus) != 0 || !S_ISREG(fileStatus.st_mode))
+        {
+            return false;
+        }
+
+        fileInfo->size = (uint32_t)fileStatus.st_size;
+        fileInfo->lastWriteTime = (uint64_t)fileStatus.st_mtime;
+        return true;
+    }
+
+    bool ListDirectory(const char* directoryPath, std::vector<std::string>* fileNames)
+    {
+        DIR* directory = opendir(directoryPath);
+        if(directory == nullptr)
+        {
+            return false;
+        }
+
+        while(struct dirent* entry = readdir(directory))
+        {
+            FileInfo fileInfo;
+            std::string fileName = entry->d_name;
+            if(GetFileInfo(JoinPath(directoryPath, fileName).c_str(), &fileInfo))
+            {
+                fileNames->push_back(fileName);
+            }
+        }
+
+        closedir(directory);
+        return true;
+    }
+
+    bool MakeDirectory(const char* directoryPath)
+    {
+        struct stat directoryStatus;
+        return mkdir(directoryPath, 0755) == 0 ||
+               (stat(directoryPath, &directoryStatus) == 0 && S_ISDIR(directoryStatus.st_mode));
+    }
+#endif
+
+    std::string JoinPath(const std::string& directoryPath, const std::string& fileName)
+    {
+        if(directoryPath.empty() || directoryPath.back() == PATH_SEPARATOR)
+        {
+            return directoryPath + fileName;
+        }
+
+        return directoryPath + PATH_SEPARATOR + fileName;
+    }
+} // Conflux
@@ -0,0 +1,79 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef FILESYSTEM_H
+#define FILESYSTEM_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace Conflux
+{
+    /**
+     * @brief Size and last write time of a file.
+     * 
+     */
+    struct FileInfo
+    {
+        uint32_t size;
+        uint64_t lastWriteTime;     // Platform ticks, only compared for equality
+    };
+
+    /**
+     * @brief Gets the size and last write time of a file without
+     * opening it.
+     * 
+     * @param filePath absolute path to the file.
+     * @param fileInfo filled out with the file information.
+     * @return true if the path is a regular file.
+     * @return false otherwise.
+     */
+    bool GetFileInfo(const char* filePath, FileInfo* fileInfo);
+
+    /**
+     * @brief Lists the regular files in a directory.
+     * 
+     * @param directoryPath absolute path to the directory.
+     * @param fileNames filled out with the file names, without
+     * the directory.
+     * @return true if the directory could be read.
+     * @return false otherwise.
+     */
+    bool ListDirectory(const char* directoryPath, std::vector<std::string>* fileNames);
+
+    /**
+     * @brief Creates a directory, its parent must already exist.
+     * 
+     * @param directoryPath absolute path to the directory.
+     * @return true if the directory exists afterwards.
+     * @return false otherwise.
+     */
+    bool MakeDirectory(const char* directoryPath);
+
+    /**
+     * @brief Joins a directory and a file name with the platform
+     * path separator.
+     * 
+     * @param directoryPath directory, with or without a trailing
+     * separator.
+     * @param fileName file name.
+     * @return std::string joined path.
+     */
+    std::string JoinPath(const std::string& directoryPath, const std::string& fileName);
+} // Conflux
+
+#endif // FILESYSTEM_H
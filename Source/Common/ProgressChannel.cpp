@@ -0,0 +1,295 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "ProgressChannel.h"
+#include <cstring>
+#include <stdio.h>
+
+namespace Conflux
+{
+    namespace
+    {
+        void CopyMessage(char* destination, const char* message)
+        {
+            snprintf(destination, FirmwareUpdateProgress::MESSAGE_LENGTH, "%s", (message != nullptr) ? message : "");
+        }
+
+        void MakeEvent(FirmwareUpdateEvent* event, FirmwareUpdateEventType type, int value, const char* message)
+        {
+            event->type = type;
+            event->value = value;
+            CopyMessage(event->message, message);
+        }
+    }
+
+    FirmwareUpdateCallbackAdapter::FirmwareUpdateCallbackAdapter()
+    {
+        SetCallbacks(nullptr, nullptr, nullptr, nullptr);
+    }
+
+    void FirmwareUpdateCallbackAdapter::SetCallbacks(void (*currentProcess)(const char* currentProcess),
+                                                     void (*percentComplete)(int percentageComplete),
+                                                     void (*errorMessage)(const char* errorMessage),
+                                                     void (*updateComplete)(bool flashSuccessful))
+    {
+        m_currentProcess = currentProcess;
+        m_percentComplete = percentComplete;
+        m_errorMessage = errorMessage;
+        m_updateComplete = updateComplete;
+    }
+
+    void FirmwareUpdateCallbackAdapter::Deliver(const FirmwareUpdateEvent& event) const
+    {
+        switch(event.type)
+        {
+            case FirmwareUpdateEventType::EVENT_PHASE_CHANGED:
+                if(m_currentProcess != nullptr)
+                {
+                    m_currentProcess(event.message);
+                }
+                break;
+            case FirmwareUpdateEventType::EVENT_PERCENT_CHANGED:
+                if(m_percentComplete != nullptr)
+                {
+                    m_percentComplete(event.value);
+                }
+                break;
+            case FirmwareUpdateEventType::EVENT_ERROR:
+                if(m_errorMessage != nullptr)
+                {
+                    m_errorMessage(event.message);
+                }
+                break;
+            case FirmwareUpdateEventType::EVENT_UPDATE_COMPLETE:
+                if(m_updateComplete != nullptr)
+                {
+                    m_updateComplete(event.value != 0);
+                }
+                break;
+            default:
+                // No callback for this event
+                break;
+        }
+    }
+
+    ProgressChannel::ProgressChannel() : m_generation(0)
+    {
+        memset(&m_progress, 0, sizeof(m_progress));
+        m_callbackInterval = std::chrono::steady_clock::duration::zero();
+        m_phasePending = false;
+        m_percentPending = false;
+    }
+
+    void ProgressChannel::Begin(void (*currentProcess)(const char* currentProcess),
+                                void (*percentComplete)(int percentageComplete),
+                                void (*errorMessage)(const char* errorMessage),
+                                void (*updateComplete)(bool flashSuccessful),
+                                unsigned int maxCallbacksPerSecond)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        memset(&m_progress, 0, sizeof(m_progress));
+        m_progress.inProgress = true;
+
+        m_callbacks.SetCallbacks(currentProcess, percentComplete, errorMessage, updateComplete);
+        m_generation.fetch_add(1, std::memory_order_release);
+
+        m_startTime = std::chrono::steady_clock::now();
+        m_nextCallbackTime = m_startTime;
+        m_callbackInterval = (maxCallbacksPerSecond == 0) ? std::chrono::steady_clock::duration::zero() :
+                             std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                 std::chrono::seconds(1)) / maxCallbacksPerSecond;
+        m_phasePending = false;
+        m_percentPending = false;
+    }
+
+    void ProgressChannel::SetPhase(const char* phase)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        if(strncmp(m_progress.phase, phase, FirmwareUpdateProgress::MESSAGE_LENGTH - 1) == 0)
+        {
+            return;
+        }
+
+        CopyMessage(m_progress.phase, phase);
+        QueueEvent(FirmwareUpdateEventType::EVENT_PHASE_CHANGED, 0, m_progress.phase);
+        m_phasePending = true;
+        Publish(lock, false);
+    }
+
+    void ProgressChannel::SetWorkload(unsigned int pagesTotal, unsigned int bytesTotal)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_progress.pagesTotal = pagesTotal;
+        m_progress.bytesTotal = bytesTotal;
+    }
+
+    void ProgressChannel::SetPage(unsigned int currentPage)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_progress.currentPage = currentPage;
+    }
+
+    void ProgressChannel::PageDone(unsigned int pageIndex)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_progress.pagesDone;
+        QueueEvent(FirmwareUpdateEventType::EVENT_PAGE_DONE, (int)pageIndex, nullptr);
+    }
+
+    void ProgressChannel::SetBytesWritten(unsigned int bytesWritten)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        m_progress.bytesWritten = bytesWritten;
+        if(m_progress.bytesTotal == 0)
+        {
+            return;
+        }
+
+        int percentComplete = (int)(((unsigned long long)bytesWritten * 100) / m_progress.bytesTotal);
+        if(percentComplete != m_progress.percentComplete)
+        {
+            m_progress.percentComplete = percentComplete;
+            QueueEvent(FirmwareUpdateEventType::EVENT_PERCENT_CHANGED, percentComplete, nullptr);
+            m_percentPending = true;
+            Publish(lock, false);
+        }
+    }
+
+    void ProgressChannel::ReportError(const char* errorMessage)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        CopyMessage(m_progress.lastError, errorMessage);
+        ++m_progress.errorCount;
+
+        FirmwareUpdateEvent event;
+        MakeEvent(&event, FirmwareUpdateEventType::EVENT_ERROR, 0, errorMessage);
+        QueueEvent(event.type, event.value, event.message);
+        lock.unlock();
+
+        m_callbacks.Deliver(event);
+    }
+
+    void ProgressChannel::Complete(bool updateSuccessful)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        Publish(lock, true);
+
+        lock.lock();
+        m_progress.elapsedMs = (unsigned int)std::chrono::duration_cast<std::chrono::milliseconds>(
+                                   std::chrono::steady_clock::now() - m_startTime).count();
+        m_progress.estimatedRemainingMs = 0;
+        m_progress.inProgress = false;
+        m_progress.completed = true;
+        m_progress.updateSuccessful = updateSuccessful;
+
+        FirmwareUpdateEvent event;
+        MakeEvent(&event, FirmwareUpdateEventType::EVENT_UPDATE_COMPLETE, updateSuccessful ? 1 : 0, nullptr);
+        QueueEvent(event.type, event.value, event.message);
+        lock.unlock();
+
+        m_callbacks.Deliver(event);
+    }
+
+    void ProgressChannel::GetSnapshot(FirmwareUpdateProgress* progress)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        *progress = m_progress;
+        if(!m_progress.inProgress)
+        {
+            return;
+        }
+
+        unsigned long long elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                           std::chrono::steady_clock::now() - m_startTime).count();
+        progress->elapsedMs = (unsigned int)elapsedMs;
+
+        // Assume the remaining bytes go at the rate seen so far
+        if(m_progress.bytesWritten > 0 && m_progress.bytesWritten < m_progress.bytesTotal)
+        {
+            progress->estimatedRemainingMs = (unsigned int)((elapsedMs * (m_progress.bytesTotal - m_progress.bytesWritten)) /
+                                                            m_progress.bytesWritten);
+        }
+    }
+
+    bool ProgressChannel::PollEvent(FirmwareUpdateEvent* event)
+    {
+        QueuedEvent queued;
+
+        // Read after the pop, an event of a newer update was queued after Begin() moved this on
+        while(m_events.Pop(&queued))
+        {
+            if(queued.generation == m_generation.load(std::memory_order_acquire))
+            {
+                *event = queued.event;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void ProgressChannel::QueueEvent(FirmwareUpdateEventType type, int value, const char* message)
+    {
+        QueuedEvent queued;
+        queued.generation = m_generation.load(std::memory_order_relaxed);
+        MakeEvent(&queued.event, type, value, message);
+
+        // An application that never drains the queue still gets the snapshot
+        if(!m_events.Push(queued))
+        {
+            ++m_progress.droppedEvents;
+        }
+    }
+
+    void ProgressChannel::Publish(std::unique_lock<std::mutex>& lock, bool force)
+    {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+        // Anything held back is delivered by a later change, or by Complete()
+        if((!m_phasePending && !m_percentPending) || (!force && now < m_nextCallbackTime))
+        {
+            lock.unlock();
+            return;
+        }
+        m_nextCallbackTime = now + m_callbackInterval;
+
+        // Callbacks run without the lock so they may poll GetSnapshot()
+        bool publishPhase = m_phasePending;
+        bool publishPercent = m_percentPending;
+        FirmwareUpdateEvent phaseEvent;
+        FirmwareUpdateEvent percentEvent;
+        MakeEvent(&phaseEvent, FirmwareUpdateEventType::EVENT_PHASE_CHANGED, 0, m_progress.phase);
+        MakeEvent(&percentEvent, FirmwareUpdateEventType::EVENT_PERCENT_CHANGED, m_progress.percentComplete, nullptr);
+        m_phasePending = false;
+        m_percentPending = false;
+        lock.unlock();
+
+        if(publishPhase)
+        {
+            m_callbacks.Deliver(phaseEvent);
+        }
+        if(publishPercent)
+        {
+            m_callbacks.Deliver(percentEvent);
+        }
+    }
+} // Conflux
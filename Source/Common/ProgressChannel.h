@@ -0,0 +1,204 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef PROGRESSCHANNEL_H
+#define PROGRESSCHANNEL_H
+
+#include "FirmwareUpdateProgress.h"
+#include "FirmwareUpdateEvent.h"
+#include "SpscQueue.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+namespace Conflux
+{
+    /**
+     * @brief Delivers firmware update events through the function
+     * pointer callbacks taken by UpdateFirmware(). Any callback may
+     * be nullptr.
+     * 
+     */
+    class FirmwareUpdateCallbackAdapter
+    {
+    public:
+        FirmwareUpdateCallbackAdapter();
+
+        /**
+         * @brief Sets the callbacks events are delivered to.
+         * 
+         */
+        void SetCallbacks(void (*currentProcess)(const char* currentProcess),
+                          void (*percentComplete)(int percentageComplete),
+                          void (*errorMessage)(const char* errorMessage),
+                          void (*updateComplete)(bool flashSuccessful));
+
+        /**
+         * @brief Calls the callback matching an event, if there is one.
+         * 
+         * @param event event to deliver.
+         */
+        void Deliver(const FirmwareUpdateEvent& event) const;
+
+    private:
+        void (*m_currentProcess)(const char* currentProcess);
+        void (*m_percentComplete)(int percentageComplete);
+        void (*m_errorMessage)(const char* errorMessage);
+        void (*m_updateComplete)(bool flashSuccessful);
+    };
+
+    /**
+     * @brief Collects firmware update progress from the update
+     * thread and hands it to the application three ways:
+     * 
+     * - GetSnapshot() copies the full state, for polling per frame.
+     * - PollEvent() drains a lock free queue of typed events. Events
+     *   are only raised on a change, and are never rate limited.
+     * - The UpdateFirmware() callbacks, through the callback adapter.
+     *   Phase and percentage callbacks are rate limited, errors and
+     *   completion are not, and anything still pending is delivered
+     *   before the complete callback.
+     * 
+     * The update thread is the only producer of events, and the
+     * application thread that started the update the only consumer.
+     * 
+     */
+    class ProgressChannel
+    {
+    public:
+        /**
+         * @brief Number of events the queue holds. HDMI implementations
+         * check that a full update fits, so an application that drains
+         * late, or only once the update is complete, misses nothing.
+         * Events that don't fit are counted in
+         * FirmwareUpdateProgress::droppedEvents.
+         * 
+         */
+        static const unsigned int EVENT_QUEUE_CAPACITY = 512;
+
+        ProgressChannel();
+
+        /**
+         * @brief Starts tracking a new update. Must not be called
+         * while an update thread is running. Events still queued from
+         * an earlier update are skipped by PollEvent(), the queue
+         * itself is only ever touched by its producer and consumer.
+         * 
+         * @param currentProcess called when the phase changes.
+         * @param percentComplete called when the percentage changes.
+         * @param errorMessage called for every error reported.
+         * @param updateComplete called once when the update ends.
+         * @param maxCallbacksPerSecond upper bound on phase and
+         * percentage callbacks, 0 for no limit.
+         */
+        void Begin(void (*currentProcess)(const char* currentProcess),
+                   void (*percentComplete)(int percentageComplete),
+                   void (*errorMessage)(const char* errorMessage),
+                   void (*updateComplete)(bool flashSuccessful),
+                   unsigned int maxCallbacksPerSecond);
+
+        /**
+         * @brief Sets the current phase. The text is copied.
+         * 
+         * @param phase description of the current step.
+         */
+        void SetPhase(const char* phase);
+
+        /**
+         * @brief Sets how many pages will be programmed and how many
+         * bytes that is.
+         * 
+         * @param pagesTotal pages to program.
+         * @param bytesTotal bytes to program.
+         */
+        void SetWorkload(unsigned int pagesTotal, unsigned int bytesTotal);
+
+        /**
+         * @brief Sets the page being programmed.
+         * 
+         * @param currentPage page index.
+         */
+        void SetPage(unsigned int currentPage);
+
+        /**
+         * @brief Marks a page as programmed.
+         * 
+         * @param pageIndex page index.
+         */
+        void PageDone(unsigned int pageIndex);
+
+        /**
+         * @brief Sets the number of bytes programmed so far.
+         * 
+         * @param bytesWritten bytes programmed.
+         */
+        void SetBytesWritten(unsigned int bytesWritten);
+
+        /**
+         * @brief Reports an error. The text is copied.
+         * 
+         * @param errorMessage error description.
+         */
+        void ReportError(const char* errorMessage);
+
+        /**
+         * @brief Ends the update, flushing anything pending first.
+         * 
+         * @param updateSuccessful true if the update succeeded.
+         */
+        void Complete(bool updateSuccessful);
+
+        /**
+         * @brief Copies the current state of the update.
+         * 
+         * @param progress filled out with the current state.
+         */
+        void GetSnapshot(FirmwareUpdateProgress* progress);
+
+        /**
+         * @brief Removes the oldest queued event. Lock free, so it
+         * can be called from a render loop.
+         * 
+         * @param event filled out with the oldest event.
+         * @return true if an event was removed.
+         * @return false if no events are queued.
+         */
+        bool PollEvent(FirmwareUpdateEvent* event);
+
+    private:
+        struct QueuedEvent
+        {
+            unsigned int generation;    // Update the event belongs to
+            FirmwareUpdateEvent event;
+        };
+
+        std::mutex m_mutex;
+        FirmwareUpdateProgress m_progress;
+        std::chrono::steady_clock::time_point m_startTime;
+        std::chrono::steady_clock::time_point m_nextCallbackTime;
+        std::chrono::steady_clock::duration m_callbackInterval;
+        bool m_phasePending;
+        bool m_percentPending;
+        FirmwareUpdateCallbackAdapter m_callbacks;
+        std::atomic<unsigned int> m_generation;
+        SpscQueue<QueuedEvent, EVENT_QUEUE_CAPACITY> m_events;
+
+        void QueueEvent(FirmwareUpdateEventType type, int value, const char* message);
+        void Publish(std::unique_lock<std::mutex>& lock, bool force);   // Releases the lock
+    };
+} // Conflux
+
+#endif // PROGRESSCHANNEL_H
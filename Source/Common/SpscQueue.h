@@ -0,0 +1,94 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+
+namespace Conflux
+{
+    /**
+     * @brief Fixed capacity, lock free queue for exactly one
+     * producer thread and one consumer thread. Items are copied
+     * into storage owned by the queue, so neither side allocates.
+     * 
+     * @tparam T item type, must be copy assignable.
+     * @tparam CAPACITY number of items, a power of two.
+     */
+    template<typename T, unsigned int CAPACITY>
+    class SpscQueue
+    {
+        static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be a power of two");
+
+    public:
+        SpscQueue() : m_head(0), m_tail(0) {}
+
+        /**
+         * @brief Adds an item. Producer thread only.
+         * 
+         * @param item item to copy into the queue.
+         * @return true if the item was queued.
+         * @return false if the queue is full.
+         */
+        bool Push(const T& item)
+        {
+            unsigned int tail = m_tail.load(std::memory_order_relaxed);
+            if(tail - m_head.load(std::memory_order_acquire) == CAPACITY)
+            {
+                return false;
+            }
+
+            m_items[tail & (CAPACITY - 1)] = item;
+            m_tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Removes the oldest item. Consumer thread only.
+         * 
+         * @param item filled out with the oldest item.
+         * @return true if an item was removed.
+         * @return false if the queue is empty.
+         */
+        bool Pop(T* item)
+        {
+            unsigned int head = m_head.load(std::memory_order_relaxed);
+            if(head == m_tail.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+
+            *item = m_items[head & (CAPACITY - 1)];
+            m_head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+    private:
+        static const unsigned int CACHE_LINE_SIZE = 64;
+
+        // Padded onto separate cache lines so the two threads don't share one.
+        // Not alignas, that would over-align every owner, and heap allocations
+        // are not guaranteed to honour over-aligned types before C++17.
+        std::atomic<unsigned int> m_head;  // Written by the consumer
+        char m_headPadding[CACHE_LINE_SIZE - sizeof(std::atomic<unsigned int>)];
+        std::atomic<unsigned int> m_tail;  // Written by the producer
+        char m_tailPadding[CACHE_LINE_SIZE - sizeof(std::atomic<unsigned int>)];
+        T m_items[CAPACITY];
+    };
+} // Conflux
+
+#endif // SPSCQUEUE_H
@@ -0,0 +1,50 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef FIRMWARE_UPDATE_EVENT_H
+#define FIRMWARE_UPDATE_EVENT_H
+
+#include "FirmwareUpdateProgress.h"
+
+namespace Conflux
+{
+    /**
+     * @brief Kinds of event raised during a firmware update.
+     * 
+     */
+    enum FirmwareUpdateEventType
+    {
+        EVENT_PHASE_CHANGED,    // message holds the new phase
+        EVENT_PERCENT_CHANGED,  // value holds the whole percentage
+        EVENT_PAGE_DONE,        // value holds the page index
+        EVENT_ERROR,            // message holds the error
+        EVENT_UPDATE_COMPLETE,  // value is 1 if the update succeeded
+    };
+
+    /**
+     * @brief A single firmware update event. Fixed size so events
+     * can be queued without allocating.
+     * 
+     */
+    struct FirmwareUpdateEvent
+    {
+        FirmwareUpdateEventType type;
+        int value;
+        char message[FirmwareUpdateProgress::MESSAGE_LENGTH];
+    };
+} // Conflux
+
+#endif // FIRMWARE_UPDATE_EVENT_H
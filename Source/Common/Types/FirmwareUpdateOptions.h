@@ -0,0 +1,113 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef FIRMWARE_UPDATE_OPTIONS_H
+#define FIRMWARE_UPDATE_OPTIONS_H
+
+namespace Conflux
+{
+    /**
+     * @brief Limits on how hard a firmware update tries to
+     * recover from failed pages before giving up.
+     * 
+     */
+    struct FirmwareRetryPolicy
+    {
+        FirmwareRetryPolicy()
+        {
+            maxRetriesPerPage = 5;
+            initialBackoffMs = 100;
+            maxBackoffMs = 2000;
+            maxTotalRetries = 20;
+        }
+
+        unsigned int maxRetriesPerPage; // Retries of a single page
+        unsigned int initialBackoffMs;  // Delay before the first retry, doubled for each retry
+        unsigned int maxBackoffMs;      // Upper bound of the retry delay
+        unsigned int maxTotalRetries;   // Retries across all pages
+    };
+
+    /**
+     * @brief Options that change how HDMI implementations
+     * perform a firmware update. Options a device does not
+     * support are ignored.
+     * 
+     */
+    struct FirmwareUpdateOptions
+    {
+        FirmwareUpdateOptions()
+        {
+            incrementalUpdate = false;
+            maxProgressCallbacksPerSecond = 30;
+            recoverFromJournal = true;
+            resumeFromCheckpoint = false;
+            verifyAfterFlash = false;
+        }
+
+        /**
+         * @brief Only reprogram pages that differ from the last
+         * image successfully flashed by this library. Falls back
+         * to a full update when that can't be determined. Off by
+         * default, skipping pages relies on the bootrom accepting
+         * page selection, which has not been verified on hardware.
+         * 
+         */
+        bool incrementalUpdate;
+
+        /**
+         * @brief Retry limits for pages the device fails to program.
+         * 
+         */
+        FirmwareRetryPolicy retryPolicy;
+
+        /**
+         * @brief Upper bound on progress and percentage callbacks,
+         * 0 for no limit. Errors and completion are always delivered.
+         * 
+         */
+        unsigned int maxProgressCallbacksPerSecond;
+
+        /**
+         * @brief Continue an update of the same image that a power
+         * loss or crash cut short from the page recorded in the
+         * flash journal on the hard drive. Independent of
+         * resumeFromCheckpoint, which only covers updates that were
+         * cancelled or failed while the library was running.
+         * 
+         */
+        bool recoverFromJournal;
+
+        /**
+         * @brief Continue an update of the same image that was
+         * cancelled or failed from the page after the last page the
+         * device verified, instead of from the first page. Off by
+         * default for the same reason as incrementalUpdate, the pages
+         * already written are skipped by selecting the next page.
+         * 
+         */
+        bool resumeFromCheckpoint;
+
+        /**
+         * @brief Check the status the device reports for every
+         * written page against the expected page CRCs, and flash
+         * the pages that fail again once the rest are written.
+         * 
+         */
+        bool verifyAfterFlash;
+    };
+} // Conflux
+
+#endif // FIRMWARE_UPDATE_OPTIONS_H
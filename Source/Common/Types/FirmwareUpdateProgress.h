@@ -0,0 +1,52 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef FIRMWARE_UPDATE_PROGRESS_H
+#define FIRMWARE_UPDATE_PROGRESS_H
+
+namespace Conflux
+{
+    /**
+     * @brief Snapshot of a firmware update in progress, meant to
+     * be polled once per frame instead of handling callbacks.
+     * 
+     */
+    struct FirmwareUpdateProgress
+    {
+        static const unsigned int MESSAGE_LENGTH = 64;
+
+        bool inProgress;
+        bool completed;
+        bool updateSuccessful;      // Only valid once completed
+
+        char phase[MESSAGE_LENGTH];         // Current step of the update
+        char lastError[MESSAGE_LENGTH];     // Empty until an error is reported
+        unsigned int errorCount;
+
+        unsigned int currentPage;   // Page being programmed
+        unsigned int pagesDone;     // Pages finished so far
+        unsigned int pagesTotal;    // Pages this update will program
+        unsigned int bytesWritten;
+        unsigned int bytesTotal;
+        int percentComplete;
+
+        unsigned int elapsedMs;
+        unsigned int estimatedRemainingMs;  // 0 until the first byte is written
+        unsigned int droppedEvents;         // Events lost because the event queue was full
+    };
+} // Conflux
+
+#endif // FIRMWARE_UPDATE_PROGRESS_H
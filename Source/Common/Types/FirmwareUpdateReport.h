@@ -0,0 +1,93 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef FIRMWARE_UPDATE_REPORT_H
+#define FIRMWARE_UPDATE_REPORT_H
+
+#include <vector>
+
+namespace Conflux
+{
+    /**
+     * @brief Where the wall time of the update went, in
+     * microseconds. Pages are prepared while the flash plan
+     * is loaded, before the page loop starts.
+     * 
+     */
+    struct FirmwareStageTimings
+    {
+        unsigned long long prepareUs;       // Reading, padding and computing CRCs of pages
+        unsigned long long busUs;           // Bus transactions for page CRCs, page data and status
+        unsigned long long deviceWaitUs;    // Waiting for the device to finish programming
+    };
+
+    /**
+     * @brief Summary of the last firmware update, filled out
+     * by the HDMI implementation before the update complete
+     * callback is called.
+     * 
+     */
+    struct FirmwareUpdateReport
+    {
+        FirmwareUpdateReport()
+        {
+            Reset(0);
+        }
+
+        /**
+         * @brief Clears the report for a new update.
+         * 
+         * @param pageCount number of pages in the device.
+         */
+        void Reset(unsigned int pageCount)
+        {
+            updateSuccessful = false;
+            updateCancelled = false;
+            verifyPerformed = false;
+            resumedFromPage = 0;
+            pagesTotal = pageCount;
+            pagesWritten = 0;
+            pagesSkipped = 0;
+            totalRetries = 0;
+            pagesReflashed = 0;
+            pageRetries.assign(pageCount, 0);
+            pageVerifyFailed.assign(pageCount, false);
+            stageTimings.prepareUs = 0;
+            stageTimings.busUs = 0;
+            stageTimings.deviceWaitUs = 0;
+        }
+
+        bool updateSuccessful;
+        bool updateCancelled;
+        bool verifyPerformed;
+        unsigned int resumedFromPage;   // Pages before this were done by an earlier, interrupted update
+        unsigned int pagesTotal;
+        unsigned int pagesWritten;
+        unsigned int pagesSkipped;  // Unchanged pages skipped by an incremental update
+        unsigned int totalRetries;
+        unsigned int pagesReflashed;    // Pages flashed again after failing verification
+
+        // Number of times each page was re-driven after a failure
+        std::vector<unsigned int> pageRetries;
+
+        // Pages still failing verification when the update finished
+        std::vector<bool> pageVerifyFailed;
+
+        FirmwareStageTimings stageTimings;
+    };
+} // Conflux
+
+#endif // FIRMWARE_UPDATE_REPORT_H
@@ -16,7 +16,6 @@ Copyright 2021 Chase Cobb
 
 #include "VersionCode.h"
 #include <sstream>
-#include <hal/debug.h>
 
 namespace Conflux
 {
@@ -20,6 +20,11 @@ Copyright 2021 Chase Cobb
 #include "VersionCode.h"
 #include "Enums.h"
 #include "RangedIntValue.h"
+#include "FirmwareUpdateOptions.h"
+#include "FirmwareUpdateReport.h"
+#include "FirmwareUpdateProgress.h"
+#include "FirmwareUpdateEvent.h"
+#include "ProgressChannel.h"
 #include <map>
 
 namespace Conflux
@@ -48,6 +53,25 @@ namespace Conflux
          */
         virtual bool IsFirmwareUpdateAvailable(UpdateSource updateSource, const char* firmwareFilePath = "") = 0;
 
+        /**
+         * @brief Checks the update sources again instead of waiting
+         * for cached results of IsFirmwareUpdateAvailable() to expire.
+         * Returns at once, the results are picked up as each source
+         * finishes scanning.
+         * 
+         */
+        virtual void RefreshFirmwareSources() = 0;
+
+        /**
+         * @brief Adds a directory to search for firmware files on
+         * the provided update source.
+         * 
+         * @param updateSource Enumeration of possible update sources. 
+         * Indexed by Conflux::UpdateSource.
+         * @param directoryPath absolute path to the directory.
+         */
+        virtual void AddFirmwareSearchDirectory(UpdateSource updateSource, const char* directoryPath) = 0;
+
         /**
          * @brief Calling this function with a valid update source
          * will begin the process of updating the firmware. This is an 
@@ -64,11 +88,12 @@ namespace Conflux
          * encountered during the process.
          * @param updateComplete Callback that notifies that the
          * update has completed successfully, or otherwise.
-         * @param pathToFirmware Allows the location of the update
-         * to be provided by absolute path, if the update source is 
-         * Conflux::UpdateSource::WORKING_DIRECTORY.
+         * @param pathToFirmware Allows a specific update file on the
+         * update source to be provided by absolute path, instead of
+         * the newest firmware found on it.
          * @return true if the Process was started successfully.
-         * @return false otherwise.
+         * @return false otherwise, including while another update
+         * is still running or when called from one of its callbacks.
          */
         virtual bool UpdateFirmware(UpdateSource updateSource, void (*currentProcess)(const char* currentProcess)
                                                              , void (*percentComplete)(int percentageComplete)
@@ -76,6 +101,35 @@ namespace Conflux
                                                              , void (*updateComplete)(bool flashSuccessful)
                                                              , const char* pathToFirmware = "") = 0;
 
+        /**
+         * @brief Stops a running firmware update at the next page
+         * boundary. The device is left in its boot rom, and issuing the
+         * update again starts over from the first page, or continues
+         * from the last verified page when
+         * FirmwareUpdateOptions::resumeFromCheckpoint is set.
+         * 
+         * @return true if an update was running.
+         * @return false otherwise.
+         */
+        virtual bool CancelFirmwareUpdate() = 0;
+
+        /**
+         * @brief Holds a running firmware update at the next page
+         * boundary until it is resumed or cancelled.
+         * 
+         * @return true if an update was running.
+         * @return false otherwise.
+         */
+        virtual bool PauseFirmwareUpdate() = 0;
+
+        /**
+         * @brief Continues a paused firmware update.
+         * 
+         * @return true if an update was running.
+         * @return false otherwise.
+         */
+        virtual bool ResumeFirmwareUpdate() = 0;
+
          /**
           * @brief Check to see if this HDMI device supports
           * a specific feature.
@@ -146,6 +200,41 @@ namespace Conflux
          */
         HdmiHardwareId GetHardwareId() {return m_hardwareId;}
 
+        /**
+         * @brief Sets the options used by the next call to
+         * UpdateFirmware(). An update that is already running
+         * keeps the options it was started with.
+         * 
+         * @param options firmware update options.
+         */
+        void SetFirmwareUpdateOptions(const FirmwareUpdateOptions& options) {m_firmwareUpdateOptions = options;}
+
+        /**
+         * @brief Gets the report of the last firmware update.
+         * 
+         * @return const FirmwareUpdateReport& update report. Only
+         * valid once the update complete callback has been called.
+         */
+        const FirmwareUpdateReport& GetFirmwareUpdateReport() {return m_firmwareUpdateReport;}
+
+        /**
+         * @brief Gets the current state of a firmware update. Safe to
+         * call from any thread, for example once per frame.
+         * 
+         * @param progress filled out with the current state.
+         */
+        void GetFirmwareUpdateProgress(FirmwareUpdateProgress* progress) {m_firmwareUpdateProgress.GetSnapshot(progress);}
+
+        /**
+         * @brief Removes the oldest firmware update event. Lock free
+         * and allocation free, and only to be called from one thread.
+         * 
+         * @param event filled out with the oldest event.
+         * @return true if an event was removed.
+         * @return false if no events are queued.
+         */
+        bool PollFirmwareUpdateEvent(FirmwareUpdateEvent* event) {return m_firmwareUpdateProgress.PollEvent(event);}
+
         /**
          * @brief Fills out the int* provided with the current
          * value of the feature specified.
@@ -212,6 +301,9 @@ namespace Conflux
         short m_supportedFeatures;
         HdmiHardwareId m_hardwareId;
         std::map<SupportedFeatures, RangedIntValue*> m_featureValues; // TODO : Clean up all memory!!
+        FirmwareUpdateOptions m_firmwareUpdateOptions;
+        FirmwareUpdateReport m_firmwareUpdateReport;
+        ProgressChannel m_firmwareUpdateProgress;
 
         void SetHardwareId(HdmiHardwareId iD) {m_hardwareId = iD;}
         bool IsFeatureSupportedAndValuesPopulated(SupportedFeatures feature);
@@ -19,18 +19,21 @@ Copyright 2021 Chase Cobb
 #include "VersionCode.h"
 
 #include <stdint.h>
-#include <xboxkrnl/xboxkrnl.h>
 #include <cstring>
 
+#ifdef _XBOX
+#include <xboxkrnl/xboxkrnl.h>
+#endif
+
 namespace Conflux
 {
-    HdmiHardwareId DetectInstalledHardware()
+    HdmiHardwareId DetectInstalledHardware(SmBusTransport* smBus)
     {
         // Look for XboxHDMI hardware
         // HACK : This method of checking should be replaced with soemthing more
         //        scalable.
-        ULONG bootMode;
-        if(HalReadSMBusValue(XboxHDMI::I2C_HDMI_ADRESS, XboxHDMI::I2C_BOOT_MODE, false, &bootMode) == 0)
+        uint8_t bootMode;
+        if(smBus->ReadByte(XboxHDMI::I2C_HDMI_ADRESS, XboxHDMI::I2C_BOOT_MODE, &bootMode))
         {
             return HdmiHardwareId::XBOXHDMI;
         }
@@ -56,6 +59,7 @@ namespace Conflux
 
     bool GetKernelPatchVersionCode(VersionCode* kernelpatchVersion)
     {
+#ifdef _XBOX
         if(kernelpatchVersion != nullptr)
         {
             char tag[] = "HDMIkv";
@@ -75,6 +79,7 @@ namespace Conflux
                 }
             }
         }
+#endif
 
         return false;
     }
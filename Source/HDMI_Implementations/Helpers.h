@@ -18,6 +18,7 @@ Copyright 2021 Chase Cobb
 #define HELPERS_H
 
 #include "Enums.h"
+#include "SmBusTransport.h"
 
 class VersionCode;
 
@@ -27,10 +28,11 @@ namespace Conflux
      * @brief Detects the internal HDMI kit installed in the
      * Xbox console.
      * 
+     * @param smBus transport to look for the kit on.
      * @return HdmiHardwareId ID of the installed HDMI  
      * kit. Indexed by Conflux::HdmiHardwareId.
      */
-    HdmiHardwareId DetectInstalledHardware();
+    HdmiHardwareId DetectInstalledHardware(SmBusTransport* smBus);
 
     /**
      * @brief Clamps a given value from a given minimum 
@@ -52,7 +54,7 @@ namespace Conflux
      * @param kernelPatchVersion Conflux::VersionCode object
      * to be filled out with the kernel patch version information.
      * @return true if the kernel patch version was found.
-     * @return false otherwise.
+     * @return false otherwise, and always off the console.
      */
     bool GetKernelPatchVersionCode(VersionCode* kernelpatchVersion);
 } // Conflux
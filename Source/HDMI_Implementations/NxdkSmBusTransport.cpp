@@ -0,0 +1,96 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "NxdkSmBusTransport.h"
+
+namespace Conflux
+{
+    namespace
+    {
+        // What the kernel's SMBus routines return when a transaction fails.
+        // Lost arbitration isn't reported on its own, it shows up as a device error.
+        const NTSTATUS SMBUS_STATUS_IO_DEVICE_ERROR = (NTSTATUS)0xC0000185;
+        const NTSTATUS SMBUS_STATUS_IO_TIMEOUT = (NTSTATUS)0xC00000B5;
+        const NTSTATUS SMBUS_STATUS_DEVICE_BUSY = (NTSTATUS)0x80000011;
+        const NTSTATUS SMBUS_STATUS_INVALID_PARAMETER = (NTSTATUS)0xC000000D;
+    }
+
+    NxdkSmBusTransport::NxdkSmBusTransport()
+    {
+        m_lastError = SMBUS_OK;
+    }
+
+    bool NxdkSmBusTransport::ReadByte(uint8_t address, uint8_t command, uint8_t* value)
+    {
+        ULONG readValue;
+        if(!TrackStatus(HalReadSMBusValue(address, command, false, &readValue)))
+        {
+            return false;
+        }
+
+        *value = (uint8_t)readValue;
+        return true;
+    }
+
+    bool NxdkSmBusTransport::WriteByte(uint8_t address, uint8_t command, uint8_t value)
+    {
+        return TrackStatus(HalWriteSMBusValue(address, command, false, value));
+    }
+
+    bool NxdkSmBusTransport::ReadWord(uint8_t address, uint8_t command, uint16_t* value)
+    {
+        ULONG readValue;
+        if(!TrackStatus(HalReadSMBusValue(address, command, true, &readValue)))
+        {
+            return false;
+        }
+
+        *value = (uint16_t)readValue;
+        return true;
+    }
+
+    bool NxdkSmBusTransport::WriteWord(uint8_t address, uint8_t command, uint16_t value)
+    {
+        return TrackStatus(HalWriteSMBusValue(address, command, true, value));
+    }
+
+    bool NxdkSmBusTransport::TrackStatus(NTSTATUS status)
+    {
+        switch(status)
+        {
+            case 0:
+                m_lastError = SMBUS_OK;
+                break;
+            case SMBUS_STATUS_IO_DEVICE_ERROR:
+                m_lastError = SMBUS_NAK;
+                break;
+            case SMBUS_STATUS_IO_TIMEOUT:
+                m_lastError = SMBUS_TIMEOUT;
+                break;
+            case SMBUS_STATUS_DEVICE_BUSY:
+                m_lastError = SMBUS_BUS_BUSY;
+                break;
+            case SMBUS_STATUS_INVALID_PARAMETER:
+                m_lastError = SMBUS_INVALID_REQUEST;
+                break;
+            default:
+                m_lastError = SMBUS_UNKNOWN_ERROR;
+                break;
+        }
+
+        return m_lastError == SMBUS_OK;
+    }
+} // Conflux
@@ -0,0 +1,50 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef NXDKSMBUSTRANSPORT_H
+#define NXDKSMBUSTRANSPORT_H
+
+#include "SmBusTransport.h"
+#include <xboxkrnl/xboxkrnl.h>
+
+namespace Conflux
+{
+    /**
+     * @brief The console's SMBus, through the nxdk HAL.
+     * 
+     */
+    class NxdkSmBusTransport : public SmBusTransport
+    {
+    public:
+        NxdkSmBusTransport();
+
+        bool ReadByte(uint8_t address, uint8_t command, uint8_t* value);
+        bool WriteByte(uint8_t address, uint8_t command, uint8_t value);
+
+        // The HAL has no block transfers, words are the widest it goes
+        bool SupportsWordTransfers() {return true;}
+        bool ReadWord(uint8_t address, uint8_t command, uint16_t* value);
+        bool WriteWord(uint8_t address, uint8_t command, uint16_t value);
+        SmBusError GetLastBusError() {return m_lastError;}
+
+    private:
+        SmBusError m_lastError;
+
+        bool TrackStatus(NTSTATUS status);
+    };
+} // Conflux
+
+#endif // NXDKSMBUSTRANSPORT_H
@@ -0,0 +1,214 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "SmBusReplay.h"
+#include <stdio.h>
+#include <string.h>
+
+namespace Conflux
+{
+    namespace
+    {
+        const char* const REPLAY_OPERATION_NAMES[] = {"read byte", "write byte", "read word", "write word"};
+    }
+
+    SmBusReplay::SmBusReplay()
+    {
+        m_cursor = 0;
+        m_hasWords = false;
+        m_timing = REPLAY_RECORDED_TIMING;
+        m_lastError = SMBUS_OK;
+        memset(&m_report, 0, sizeof(m_report));
+        m_started = false;
+        m_firstRecordedNs = 0;
+    }
+
+    bool SmBusReplay::Load(const char* path)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cursor = 0;
+        m_hasWords = false;
+        memset(&m_report, 0, sizeof(m_report));
+        m_firstDivergence.clear();
+        m_started = false;
+        if(!ReadTraceFile(path, &m_records))
+        {
+            m_records.clear();
+            return false;
+        }
+
+        for(const SmBusTraceRecord& record : m_records)
+        {
+            m_hasWords = m_hasWords || record.operation == TRACE_READ_WORD || record.operation == TRACE_WRITE_WORD;
+        }
+        return true;
+    }
+
+    void SmBusReplay::SetTiming(SmBusReplayTiming timing)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_timing = timing;
+    }
+
+    bool SmBusReplay::ReadByte(uint8_t address, uint8_t command, uint8_t* value)
+    {
+        uint16_t readValue = 0;
+        if(!Replay(TRACE_READ_BYTE, address, command, &readValue))
+        {
+            return false;
+        }
+
+        *value = (uint8_t)readValue;
+        return true;
+    }
+
+    bool SmBusReplay::WriteByte(uint8_t address, uint8_t command, uint8_t value)
+    {
+        uint16_t writtenValue = value;
+        return Replay(TRACE_WRITE_BYTE, address, command, &writtenValue);
+    }
+
+    bool SmBusReplay::SupportsWordTransfers()
+    {
+        // Only offered if the recording transport took them
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_hasWords;
+    }
+
+    bool SmBusReplay::ReadWord(uint8_t address, uint8_t command, uint16_t* value)
+    {
+        return Replay(TRACE_READ_WORD, address, command, value);
+    }
+
+    bool SmBusReplay::WriteWord(uint8_t address, uint8_t command, uint16_t value)
+    {
+        return Replay(TRACE_WRITE_WORD, address, command, &value);
+    }
+
+    SmBusError SmBusReplay::GetLastBusError()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_lastError;
+    }
+
+    void SmBusReplay::GetReport(SmBusReplayReport* report)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        *report = m_report;
+        report->remaining = m_records.size() - m_cursor;
+    }
+
+    std::string SmBusReplay::GetFirstDivergence()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_firstDivergence;
+    }
+
+    bool SmBusReplay::Replay(SmBusTraceOperation operation, uint8_t address, uint8_t command, uint16_t* value)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        size_t match = m_cursor;
+        size_t windowEnd = m_cursor + RESYNC_WINDOW < m_records.size() ? m_cursor + RESYNC_WINDOW : m_records.size();
+        while(match < windowEnd && !Matches(m_records[match], operation, address, command))
+        {
+            ++match;
+        }
+
+        if(match == windowEnd)
+        {
+            // Refused as fatal, so the library doesn't retry its way through the session
+            NoteDivergence(operation, address, command, m_cursor < m_records.size() ? "not recorded here" :
+                                                                                      "past the end of the session");
+            m_lastError = SMBUS_INVALID_REQUEST;
+            return false;
+        }
+
+        bool inStep = (match == m_cursor);
+        if(!inStep)
+        {
+            NoteDivergence(operation, address, command, "recorded later");
+            m_report.skipped += match - m_cursor;
+        }
+
+        const SmBusTraceRecord record = m_records[match];
+        m_cursor = match + 1;
+        bool isWrite = (operation == TRACE_WRITE_BYTE || operation == TRACE_WRITE_WORD);
+        if(inStep && isWrite && record.result == SMBUS_OK && record.value != *value)
+        {
+            NoteDivergence(operation, address, command, "different value written");
+        }
+
+        if(!m_started)
+        {
+            m_started = true;
+            m_firstRecordedNs = record.startNs;
+            m_firstReplayed = start;
+        }
+        ++m_report.transactions;
+        m_lastError = (SmBusError)record.result;
+        SmBusReplayTiming timing = m_timing;
+        lock.unlock();
+
+        if(timing == REPLAY_RECORDED_TIMING)
+        {
+            // Spun rather than slept, sleeps are far coarser than a bus transaction
+            std::chrono::steady_clock::time_point until = start + std::chrono::nanoseconds(record.durationNs);
+            while(std::chrono::steady_clock::now() < until)
+            {
+            }
+        }
+
+        lock.lock();
+        m_report.recordedUs = (record.startNs + record.durationNs - m_firstRecordedNs) / 1000;
+        m_report.replayedUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                                  std::chrono::steady_clock::now() - m_firstReplayed).count();
+        lock.unlock();
+
+        if(record.result != SMBUS_OK)
+        {
+            return false;
+        }
+
+        if(!isWrite)
+        {
+            *value = record.value;
+        }
+        return true;
+    }
+
+    bool SmBusReplay::Matches(const SmBusTraceRecord& record, SmBusTraceOperation operation,
+                              uint8_t address, uint8_t command)
+    {
+        return record.operation == operation && record.address == address && record.command == command;
+    }
+
+    void SmBusReplay::NoteDivergence(SmBusTraceOperation operation, uint8_t address, uint8_t command,
+                                     const char* reason)
+    {
+        ++m_report.divergences;
+        if(!m_firstDivergence.empty())
+        {
+            return;
+        }
+
+        char description[128];
+        snprintf(description, sizeof(description), "transaction %llu, %s 0x%02X at 0x%02X: %s",
+                 m_report.transactions, REPLAY_OPERATION_NAMES[operation], command, address, reason);
+        m_firstDivergence = description;
+    }
+} // Conflux
@@ -0,0 +1,131 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef SMBUSREPLAY_H
+#define SMBUSREPLAY_H
+
+#include "SmBusTransport.h"
+#include "SmBusTraceFormat.h"
+#include <stdint.h>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Conflux
+{
+    /**
+     * @brief How fast a recorded session is played back.
+     * 
+     */
+    enum SmBusReplayTiming
+    {
+        REPLAY_RECORDED_TIMING,     // Each transaction takes as long as it did on the device
+        REPLAY_FAST,                // Transactions are answered at once
+    };
+
+    /**
+     * @brief How a replay compared with the recorded session.
+     * 
+     */
+    struct SmBusReplayReport
+    {
+        unsigned long long transactions;    // Transactions answered from the session
+        unsigned long long divergences;     // Transactions that didn't match the session
+        unsigned long long skipped;         // Recorded transactions passed over to get back in step
+        unsigned long long remaining;       // Recorded transactions never reached
+        unsigned long long recordedUs;      // Recorded time from the first to the last answered transaction
+        unsigned long long replayedUs;      // Wall time between the same transactions in the replay
+    };
+
+    /**
+     * @brief A virtual bus that answers from a session recorded by
+     * SmBusTracer::StartRecording(), so the library can be run against
+     * real device behaviour on a PC. Each transaction is matched
+     * against the next recorded one and given its recorded value and
+     * result.
+     * 
+     * A transaction that doesn't match is a divergence. The next few
+     * recorded transactions are searched for it to get back in step,
+     * and if it isn't there it is refused without consuming anything.
+     * A write of a different value still consumes its record.
+     * 
+     */
+    class SmBusReplay : public SmBusTransport
+    {
+    public:
+        static const unsigned int RESYNC_WINDOW = 64;
+
+        SmBusReplay();
+
+        /**
+         * @brief Loads a recorded session and rewinds to its start.
+         * 
+         * @param path path of the session file.
+         * @return true if the session was loaded.
+         * @return false otherwise.
+         */
+        bool Load(const char* path);
+
+        /**
+         * @brief Sets how fast the session is played back.
+         * 
+         * @param timing REPLAY_RECORDED_TIMING by default.
+         */
+        void SetTiming(SmBusReplayTiming timing);
+
+        bool ReadByte(uint8_t address, uint8_t command, uint8_t* value);
+        bool WriteByte(uint8_t address, uint8_t command, uint8_t value);
+        bool SupportsWordTransfers();
+        bool ReadWord(uint8_t address, uint8_t command, uint16_t* value);
+        bool WriteWord(uint8_t address, uint8_t command, uint16_t value);
+        SmBusError GetLastBusError();
+
+        /**
+         * @brief Gets how the replay so far compares with the session.
+         * 
+         * @param report filled out with the replay report.
+         */
+        void GetReport(SmBusReplayReport* report);
+
+        /**
+         * @brief Gets a description of the first divergence.
+         * 
+         * @return std::string empty if the replay hasn't diverged.
+         */
+        std::string GetFirstDivergence();
+
+    private:
+        std::mutex m_mutex;
+        std::vector<SmBusTraceRecord> m_records;
+        size_t m_cursor;
+        bool m_hasWords;
+        SmBusReplayTiming m_timing;
+        SmBusError m_lastError;
+        SmBusReplayReport m_report;
+        std::string m_firstDivergence;
+        bool m_started;
+        uint64_t m_firstRecordedNs;
+        std::chrono::steady_clock::time_point m_firstReplayed;
+
+        bool Replay(SmBusTraceOperation operation, uint8_t address, uint8_t command, uint16_t* value);
+        bool Matches(const SmBusTraceRecord& record, SmBusTraceOperation operation,
+                     uint8_t address, uint8_t command);
+        void NoteDivergence(SmBusTraceOperation operation, uint8_t address, uint8_t command, const char* reason);
+    };
+} // Conflux
+
+#endif // SMBUSREPLAY_H
@@ -0,0 +1,84 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "SmBusTraceFormat.h"
+#include "ByteOrder.h"
+#include <stdio.h>
+
+namespace Conflux
+{
+    void PackTraceHeader(uint32_t recordCount, uint8_t* header)
+    {
+        WriteU32LittleEndian(header, SMBUS_TRACE_MAGIC);
+        WriteU16LittleEndian(header + 4, SMBUS_TRACE_VERSION);
+        WriteU16LittleEndian(header + 6, SMBUS_TRACE_RECORD_SIZE);
+        WriteU32LittleEndian(header + SMBUS_TRACE_RECORD_COUNT_OFFSET, recordCount);
+    }
+
+    void PackTraceRecord(const SmBusTraceRecord& record, uint8_t* packed)
+    {
+        WriteU32LittleEndian(packed, (uint32_t)record.startNs);
+        WriteU32LittleEndian(packed + 4, (uint32_t)(record.startNs >> 32));
+        WriteU32LittleEndian(packed + 8, record.durationNs);
+        WriteU32LittleEndian(packed + 12, record.sequence);
+        WriteU16LittleEndian(packed + 16, record.value);
+        WriteU16LittleEndian(packed + 18, record.thread);
+        packed[20] = record.address;
+        packed[21] = record.command;
+        packed[22] = record.operation;
+        packed[23] = record.result;
+    }
+
+    bool ReadTraceFile(const char* path, std::vector<SmBusTraceRecord>* records)
+    {
+        FILE* traceFile = fopen(path, "rb");
+        if(traceFile == nullptr)
+        {
+            return false;
+        }
+
+        uint8_t header[SMBUS_TRACE_HEADER_SIZE];
+        bool readSuccessful = fread(header, 1, sizeof(header), traceFile) == sizeof(header) &&
+                              ReadU32LittleEndian(header) == SMBUS_TRACE_MAGIC &&
+                              ReadU16LittleEndian(header + 4) == SMBUS_TRACE_VERSION &&
+                              ReadU16LittleEndian(header + 6) == SMBUS_TRACE_RECORD_SIZE;
+
+        uint32_t recordCount = readSuccessful ? ReadU32LittleEndian(header + SMBUS_TRACE_RECORD_COUNT_OFFSET) : 0;
+        records->clear();
+        for(uint32_t index = 0; readSuccessful && index < recordCount; ++index)
+        {
+            uint8_t packed[SMBUS_TRACE_RECORD_SIZE];
+            readSuccessful = fread(packed, 1, sizeof(packed), traceFile) == sizeof(packed);
+            if(readSuccessful)
+            {
+                SmBusTraceRecord record;
+                record.startNs = ReadU32LittleEndian(packed) | ((uint64_t)ReadU32LittleEndian(packed + 4) << 32);
+                record.durationNs = ReadU32LittleEndian(packed + 8);
+                record.sequence = ReadU32LittleEndian(packed + 12);
+                record.value = ReadU16LittleEndian(packed + 16);
+                record.thread = ReadU16LittleEndian(packed + 18);
+                record.address = packed[20];
+                record.command = packed[21];
+                record.operation = packed[22];
+                record.result = packed[23];
+                records->push_back(record);
+            }
+        }
+
+        fclose(traceFile);
+        return readSuccessful;
+    }
+} // Conflux
@@ -0,0 +1,95 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef SMBUSTRACEFORMAT_H
+#define SMBUSTRACEFORMAT_H
+
+#include <stdint.h>
+#include <vector>
+
+namespace Conflux
+{
+    /**
+     * @brief Kinds of traced SMBus transaction.
+     * 
+     */
+    enum SmBusTraceOperation
+    {
+        TRACE_READ_BYTE,
+        TRACE_WRITE_BYTE,
+        TRACE_READ_WORD,
+        TRACE_WRITE_WORD,
+    };
+
+    /**
+     * @brief A single traced transaction.
+     * 
+     */
+    struct SmBusTraceRecord
+    {
+        uint64_t startNs;       // Since the tracer was created
+        uint32_t durationNs;    // End is startNs + durationNs
+        uint32_t sequence;      // Transactions traced before this one
+        uint16_t value;         // Byte or word read or written
+        uint16_t thread;        // Hash of the calling thread
+        uint8_t address;
+        uint8_t command;
+        uint8_t operation;      // SmBusTraceOperation
+        uint8_t result;         // SmBusError, SMBUS_OK if the device acknowledged
+    };
+
+    // Trace files, both ring buffer dumps and recorded sessions, are little
+    // endian: a header of magic "CFTR", u16 version, u16 record size and u32
+    // record count, then the records oldest first, each u64 startNs,
+    // u32 durationNs, u32 sequence, u16 value, u16 thread, u8 address,
+    // u8 command, u8 operation, u8 result (SmBusError).
+    const uint32_t SMBUS_TRACE_MAGIC = 0x52544643; // "CFTR"
+    const uint16_t SMBUS_TRACE_VERSION = 2;
+    const uint16_t SMBUS_TRACE_HEADER_SIZE = 12;
+    const uint16_t SMBUS_TRACE_RECORD_SIZE = 24;
+    const uint32_t SMBUS_TRACE_RECORD_COUNT_OFFSET = 8;
+
+    /**
+     * @brief Packs a trace file header.
+     * 
+     * @param recordCount number of records that follow.
+     * @param header SMBUS_TRACE_HEADER_SIZE bytes filled out with the
+     * header.
+     */
+    void PackTraceHeader(uint32_t recordCount, uint8_t* header);
+
+    /**
+     * @brief Packs a record for a trace file.
+     * 
+     * @param record record to pack.
+     * @param packed SMBUS_TRACE_RECORD_SIZE bytes filled out with the
+     * record.
+     */
+    void PackTraceRecord(const SmBusTraceRecord& record, uint8_t* packed);
+
+    /**
+     * @brief Reads every record of a trace file.
+     * 
+     * @param path path of the trace file.
+     * @param records filled out with the records, oldest first.
+     * @return true if the whole file was read.
+     * @return false if it could not be read or is not a trace file of
+     * this version.
+     */
+    bool ReadTraceFile(const char* path, std::vector<SmBusTraceRecord>* records);
+} // Conflux
+
+#endif // SMBUSTRACEFORMAT_H
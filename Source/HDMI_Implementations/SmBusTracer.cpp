@@ -0,0 +1,194 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "SmBusTracer.h"
+#include "ByteOrder.h"
+#include <stdio.h>
+#include <functional>
+#include <thread>
+
+namespace Conflux
+{
+    SmBusTracer::SmBusTracer(SmBusTransport* transport)
+    {
+        m_transport = transport;
+        m_epoch = std::chrono::steady_clock::now();
+        m_nextSequence = 0;
+        m_sessionFile = nullptr;
+        m_sessionRecords = 0;
+        m_sessionWriteFailed = false;
+    }
+
+    bool SmBusTracer::ReadByte(uint8_t address, uint8_t command, uint8_t* value)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        bool readSuccessful = m_transport->ReadByte(address, command, value);
+        Record(TRACE_READ_BYTE, address, command, readSuccessful ? *value : 0, readSuccessful, start);
+        return readSuccessful;
+    }
+
+    bool SmBusTracer::WriteByte(uint8_t address, uint8_t command, uint8_t value)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        bool writeSuccessful = m_transport->WriteByte(address, command, value);
+        Record(TRACE_WRITE_BYTE, address, command, value, writeSuccessful, start);
+        return writeSuccessful;
+    }
+
+    bool SmBusTracer::SupportsWordTransfers()
+    {
+        return m_transport->SupportsWordTransfers();
+    }
+
+    bool SmBusTracer::ReadWord(uint8_t address, uint8_t command, uint16_t* value)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        bool readSuccessful = m_transport->ReadWord(address, command, value);
+        Record(TRACE_READ_WORD, address, command, readSuccessful ? *value : 0, readSuccessful, start);
+        return readSuccessful;
+    }
+
+    bool SmBusTracer::WriteWord(uint8_t address, uint8_t command, uint16_t value)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        bool writeSuccessful = m_transport->WriteWord(address, command, value);
+        Record(TRACE_WRITE_WORD, address, command, value, writeSuccessful, start);
+        return writeSuccessful;
+    }
+
+    SmBusError SmBusTracer::GetLastBusError()
+    {
+        return m_transport->GetLastBusError();
+    }
+
+    uint32_t SmBusTracer::GetRecordCount()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return (m_nextSequence < RECORD_CAPACITY) ? m_nextSequence : RECORD_CAPACITY;
+    }
+
+    bool SmBusTracer::GetRecord(uint32_t index, SmBusTraceRecord* record)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        uint32_t recordCount = (m_nextSequence < RECORD_CAPACITY) ? m_nextSequence : RECORD_CAPACITY;
+        if(index >= recordCount)
+        {
+            return false;
+        }
+
+        *record = m_records[(m_nextSequence - recordCount + index) % RECORD_CAPACITY];
+        return true;
+    }
+
+    bool SmBusTracer::Dump(const char* path)
+    {
+        FILE* dumpFile = fopen(path, "wb");
+        if(dumpFile == nullptr)
+        {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        uint32_t recordCount = (m_nextSequence < RECORD_CAPACITY) ? m_nextSequence : RECORD_CAPACITY;
+        uint8_t header[SMBUS_TRACE_HEADER_SIZE];
+        PackTraceHeader(recordCount, header);
+        bool dumpWritten = fwrite(header, 1, sizeof(header), dumpFile) == sizeof(header);
+
+        for(uint32_t index = 0; dumpWritten && index < recordCount; ++index)
+        {
+            uint8_t packed[SMBUS_TRACE_RECORD_SIZE];
+            PackTraceRecord(m_records[(m_nextSequence - recordCount + index) % RECORD_CAPACITY], packed);
+            dumpWritten = fwrite(packed, 1, sizeof(packed), dumpFile) == sizeof(packed);
+        }
+
+        return (fclose(dumpFile) == 0) && dumpWritten;
+    }
+
+    void SmBusTracer::Clear()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_nextSequence = 0;
+    }
+
+    bool SmBusTracer::StartRecording(const char* path)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(m_sessionFile != nullptr)
+        {
+            return false;
+        }
+
+        m_sessionFile = fopen(path, "wb");
+        if(m_sessionFile == nullptr)
+        {
+            return false;
+        }
+
+        // The record count is filled in once the session is stopped
+        uint8_t header[SMBUS_TRACE_HEADER_SIZE];
+        PackTraceHeader(0, header);
+        m_sessionWriteFailed = fwrite(header, 1, sizeof(header), m_sessionFile) != sizeof(header);
+        m_sessionRecords = 0;
+        return true;
+    }
+
+    bool SmBusTracer::StopRecording()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(m_sessionFile == nullptr)
+        {
+            return false;
+        }
+
+        uint8_t recordCount[4];
+        WriteU32LittleEndian(recordCount, m_sessionRecords);
+        bool sessionWritten = !m_sessionWriteFailed &&
+                              fseek(m_sessionFile, SMBUS_TRACE_RECORD_COUNT_OFFSET, SEEK_SET) == 0 &&
+                              fwrite(recordCount, 1, sizeof(recordCount), m_sessionFile) == sizeof(recordCount);
+        sessionWritten = (fclose(m_sessionFile) == 0) && sessionWritten;
+        m_sessionFile = nullptr;
+        return sessionWritten;
+    }
+
+    void SmBusTracer::Record(SmBusTraceOperation operation, uint8_t address, uint8_t command, uint16_t value,
+                             bool result, std::chrono::steady_clock::time_point start)
+    {
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        SmBusError error = result ? SMBUS_OK : m_transport->GetLastBusError();
+        uint16_t thread = (uint16_t)std::hash<std::thread::id>()(std::this_thread::get_id());
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        SmBusTraceRecord& record = m_records[m_nextSequence % RECORD_CAPACITY];
+        record.startNs = std::chrono::duration_cast<std::chrono::nanoseconds>(start - m_epoch).count();
+        record.durationNs = (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        record.sequence = m_nextSequence;
+        record.value = value;
+        record.thread = thread;
+        record.address = address;
+        record.command = command;
+        record.operation = (uint8_t)operation;
+        record.result = (uint8_t)error;
+        ++m_nextSequence;
+
+        if(m_sessionFile != nullptr && !m_sessionWriteFailed)
+        {
+            uint8_t packed[SMBUS_TRACE_RECORD_SIZE];
+            PackTraceRecord(record, packed);
+            m_sessionWriteFailed = fwrite(packed, 1, sizeof(packed), m_sessionFile) != sizeof(packed);
+            ++m_sessionRecords;
+        }
+    }
+} // Conflux
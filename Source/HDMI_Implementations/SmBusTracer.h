@@ -0,0 +1,132 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef SMBUSTRACER_H
+#define SMBUSTRACER_H
+
+#include "SmBusTransport.h"
+#include "SmBusTraceFormat.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include <mutex>
+
+namespace Conflux
+{
+    /**
+     * @brief Records every transaction passed through it to another
+     * transport into a fixed size ring buffer, so the traffic leading
+     * up to a failure can be dumped and decoded on a PC.
+     * 
+     * Only wired into the library when built with CONFLUX_SMBUS_TRACE,
+     * otherwise it isn't part of the path at all. An application can
+     * also put one in front of the platform transport with
+     * HdmiTools::SetSmBusTransport() and record a whole session to a
+     * file, for SmBusReplay to play back on a PC.
+     * 
+     * Dumps and recorded sessions are both trace files, see
+     * SmBusTraceFormat.h.
+     * 
+     */
+    class SmBusTracer : public SmBusTransport
+    {
+    public:
+        static const uint32_t RECORD_CAPACITY = 4096;
+
+        /**
+         * @brief Construct a new SmBusTracer object.
+         * 
+         * @param transport transport the traced transactions go to.
+         */
+        SmBusTracer(SmBusTransport* transport);
+
+        bool ReadByte(uint8_t address, uint8_t command, uint8_t* value);
+        bool WriteByte(uint8_t address, uint8_t command, uint8_t value);
+        bool SupportsWordTransfers();
+        bool ReadWord(uint8_t address, uint8_t command, uint16_t* value);
+        bool WriteWord(uint8_t address, uint8_t command, uint16_t value);
+        SmBusError GetLastBusError();
+
+        /**
+         * @brief Gets the number of transactions in the ring buffer.
+         * 
+         * @return uint32_t record count, at most RECORD_CAPACITY.
+         */
+        uint32_t GetRecordCount();
+
+        /**
+         * @brief Gets a traced transaction.
+         * 
+         * @param index 0 for the oldest record held.
+         * @param record filled out with the record.
+         * @return true if index is less than GetRecordCount().
+         * @return false otherwise.
+         */
+        bool GetRecord(uint32_t index, SmBusTraceRecord* record);
+
+        /**
+         * @brief Writes the ring buffer to a file, oldest record first.
+         * 
+         * @param path absolute path of the dump file, replaced if it
+         * exists.
+         * @return true if the dump was written.
+         * @return false otherwise.
+         */
+        bool Dump(const char* path);
+
+        /**
+         * @brief Drops every record.
+         * 
+         */
+        void Clear();
+
+        /**
+         * @brief Starts writing every transaction to a file as well
+         * as the ring buffer, however many there are.
+         * 
+         * @param path absolute path of the session file, replaced if
+         * it exists.
+         * @return true if the file was created.
+         * @return false otherwise, or if a session is already being
+         * recorded.
+         */
+        bool StartRecording(const char* path);
+
+        /**
+         * @brief Finishes the session file started by StartRecording().
+         * 
+         * @return true if every transaction since StartRecording()
+         * reached the file.
+         * @return false otherwise, or if no session was being recorded.
+         */
+        bool StopRecording();
+
+    private:
+        SmBusTransport* m_transport;
+        std::chrono::steady_clock::time_point m_epoch;
+        std::mutex m_mutex;
+        SmBusTraceRecord m_records[RECORD_CAPACITY];
+        uint32_t m_nextSequence;
+        FILE* m_sessionFile;
+        uint32_t m_sessionRecords;
+        bool m_sessionWriteFailed;
+
+        void Record(SmBusTraceOperation operation, uint8_t address, uint8_t command, uint16_t value,
+                    bool result, std::chrono::steady_clock::time_point start);
+    };
+} // Conflux
+
+#endif // SMBUSTRACER_H
@@ -0,0 +1,169 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "SmBusTransport.h"
+#include <chrono>
+
+#ifdef _XBOX
+#include "NxdkSmBusTransport.h"
+#else
+#include "SimulatedXboxHdmi.h"
+#endif
+
+namespace Conflux
+{
+    bool IsTransientSmBusError(SmBusError error)
+    {
+        return error != SMBUS_OK && error != SMBUS_INVALID_REQUEST;
+    }
+
+    SmBusTransport::SmBusTransport()
+    {
+        ResetBatchMetrics();
+    }
+
+    // Transports without word transfers never reach the bus
+    bool SmBusTransport::ReadWord(uint8_t, uint8_t, uint16_t*)
+    {
+        return false;
+    }
+
+    bool SmBusTransport::WriteWord(uint8_t, uint8_t, uint16_t)
+    {
+        return false;
+    }
+
+    bool SmBusTransport::ReadRegisters(uint8_t address, uint8_t firstCommand, uint8_t count, uint8_t* values,
+                                       SmBusTransferWidth width)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        bool useWords = (width == WORD_TRANSFERS) && SupportsWordTransfers();
+        unsigned int transactions = 0;
+        unsigned int wordFallbacks = 0;
+        bool readSuccessful = true;
+        uint8_t index = 0;
+
+        while(readSuccessful && index < count)
+        {
+            uint16_t word;
+            if(useWords && (count - index) >= 2)
+            {
+                ++transactions;
+                if(ReadWord(address, firstCommand + index, &word))
+                {
+                    values[index] = (uint8_t)(word & 0xFF);
+                    values[index + 1] = (uint8_t)(word >> 8);
+                    index += 2;
+                    continue;
+                }
+
+                // Refused once, the rest of the batch goes a byte at a time
+                useWords = false;
+                ++wordFallbacks;
+            }
+
+            ++transactions;
+            readSuccessful = ReadByte(address, firstCommand + index, &values[index]);
+            ++index;
+        }
+
+        RecordBatch(std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - start).count(),
+                    count, transactions, wordFallbacks);
+        return readSuccessful;
+    }
+
+    bool SmBusTransport::WriteRegisters(uint8_t address, uint8_t firstCommand, uint8_t count, const uint8_t* values,
+                                        SmBusTransferWidth width)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        bool useWords = (width == WORD_TRANSFERS) && SupportsWordTransfers();
+        unsigned int transactions = 0;
+        unsigned int wordFallbacks = 0;
+        bool writeSuccessful = true;
+        uint8_t index = 0;
+
+        while(writeSuccessful && index < count)
+        {
+            if(useWords && (count - index) >= 2)
+            {
+                ++transactions;
+                if(WriteWord(address, firstCommand + index, (uint16_t)(values[index] | (values[index + 1] << 8))))
+                {
+                    index += 2;
+                    continue;
+                }
+
+                useWords = false;
+                ++wordFallbacks;
+            }
+
+            ++transactions;
+            writeSuccessful = WriteByte(address, firstCommand + index, values[index]);
+            ++index;
+        }
+
+        RecordBatch(std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - start).count(),
+                    count, transactions, wordFallbacks);
+        return writeSuccessful;
+    }
+
+    void SmBusTransport::GetBatchMetrics(SmBusBatchMetrics* metrics)
+    {
+        std::lock_guard<std::mutex> lock(m_metricsMutex);
+        *metrics = m_batchMetrics;
+    }
+
+    void SmBusTransport::ResetBatchMetrics()
+    {
+        std::lock_guard<std::mutex> lock(m_metricsMutex);
+        m_batchMetrics.batches = 0;
+        m_batchMetrics.registers = 0;
+        m_batchMetrics.transactions = 0;
+        m_batchMetrics.wordFallbacks = 0;
+        m_batchMetrics.totalUs = 0;
+        m_batchMetrics.maxUs = 0;
+        m_batchMetrics.lastUs = 0;
+    }
+
+    void SmBusTransport::RecordBatch(unsigned long long elapsedUs, uint8_t registers,
+                                     unsigned int transactions, unsigned int wordFallbacks)
+    {
+        std::lock_guard<std::mutex> lock(m_metricsMutex);
+        ++m_batchMetrics.batches;
+        m_batchMetrics.registers += registers;
+        m_batchMetrics.transactions += transactions;
+        m_batchMetrics.wordFallbacks += wordFallbacks;
+        m_batchMetrics.totalUs += elapsedUs;
+        m_batchMetrics.lastUs = elapsedUs;
+        if(elapsedUs > m_batchMetrics.maxUs)
+        {
+            m_batchMetrics.maxUs = elapsedUs;
+        }
+    }
+
+    SmBusTransport* GetPlatformSmBusTransport()
+    {
+#ifdef _XBOX
+        static NxdkSmBusTransport transport;
+#else
+        // There is no SMBus off the console
+        static XboxHDMI::SimulatedXboxHdmi transport;
+#endif
+        return &transport;
+    }
+} // Conflux
@@ -0,0 +1,220 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef SMBUSTRANSPORT_H
+#define SMBUSTRANSPORT_H
+
+#include <stdint.h>
+#include <mutex>
+
+namespace Conflux
+{
+    /**
+     * @brief How many consecutive registers a batch moves per
+     * bus transaction.
+     * 
+     */
+    enum SmBusTransferWidth
+    {
+        BYTE_TRANSFERS,     // One register per transaction
+        WORD_TRANSFERS,     // Two registers per transaction, for devices that auto-increment
+    };
+
+    /**
+     * @brief Why a bus transaction failed.
+     * 
+     */
+    enum SmBusError
+    {
+        SMBUS_OK,
+        SMBUS_NAK,                  // Device didn't acknowledge, transient
+        SMBUS_ARBITRATION_LOST,     // Another master took the bus, transient
+        SMBUS_BUS_BUSY,             // Bus or controller still busy, transient
+        SMBUS_TIMEOUT,              // Controller gave up waiting, transient
+        SMBUS_UNKNOWN_ERROR,        // Failed without saying why, treated as transient
+        SMBUS_INVALID_REQUEST,      // Refused by the transport or device, fatal
+    };
+
+    /**
+     * @brief Checks if a failed transaction is worth trying again.
+     * 
+     * @param error why the transaction failed.
+     * @return true if the same transaction may succeed a moment later.
+     * @return false if it will fail the same way every time.
+     */
+    bool IsTransientSmBusError(SmBusError error);
+
+    /**
+     * @brief Cost of the register batches run on a transport.
+     * 
+     */
+    struct SmBusBatchMetrics
+    {
+        unsigned long long batches;
+        unsigned long long registers;       // Registers moved by all batches
+        unsigned long long transactions;    // Bus transactions those took
+        unsigned long long wordFallbacks;   // Word transactions the device refused, redone as bytes
+        unsigned long long totalUs;
+        unsigned long long maxUs;           // Slowest batch
+        unsigned long long lastUs;          // Most recent batch
+    };
+
+    /**
+     * @brief Single byte register access on the SMBus. All
+     * traffic to the HDMI hardware goes through one of these,
+     * so the library can run against the console's bus or
+     * against a simulated device on a development machine.
+     * 
+     */
+    class SmBusTransport
+    {
+    public:
+        SmBusTransport();
+        virtual ~SmBusTransport() {}
+
+        /**
+         * @brief Reads one register of a device.
+         * 
+         * @param address SMBus address of the device.
+         * @param command register to read.
+         * @param value filled out with the register value.
+         * @return true if the device acknowledged the read.
+         * @return false otherwise.
+         */
+        virtual bool ReadByte(uint8_t address, uint8_t command, uint8_t* value) = 0;
+
+        /**
+         * @brief Writes one register of a device.
+         * 
+         * @param address SMBus address of the device.
+         * @param command register to write.
+         * @param value value to write.
+         * @return true if the device acknowledged the write.
+         * @return false otherwise.
+         */
+        virtual bool WriteByte(uint8_t address, uint8_t command, uint8_t value) = 0;
+
+        /**
+         * @brief Checks if ReadWord() and WriteWord() reach the bus.
+         * 
+         * @return true if the transport can do word transactions.
+         * @return false otherwise.
+         */
+        virtual bool SupportsWordTransfers() {return false;}
+
+        /**
+         * @brief Reads two consecutive registers of a device in one
+         * transaction. Only meaningful for devices that auto-increment
+         * their register pointer.
+         * 
+         * @param address SMBus address of the device.
+         * @param command first register to read.
+         * @param value filled out with command in the low byte and
+         * command + 1 in the high byte.
+         * @return true if the device acknowledged the read.
+         * @return false otherwise, or if the transport can't do word
+         * transactions.
+         */
+        virtual bool ReadWord(uint8_t address, uint8_t command, uint16_t* value);
+
+        /**
+         * @brief Writes two consecutive registers of a device in one
+         * transaction, command first.
+         * 
+         * @param address SMBus address of the device.
+         * @param command first register to write.
+         * @param value command in the low byte, command + 1 in the
+         * high byte.
+         * @return true if the device acknowledged the write.
+         * @return false otherwise, or if the transport can't do word
+         * transactions.
+         */
+        virtual bool WriteWord(uint8_t address, uint8_t command, uint16_t value);
+
+        /**
+         * @brief Gets why the most recent transaction failed. Only
+         * meaningful straight after a call returned false.
+         * 
+         * @return SmBusError SMBUS_UNKNOWN_ERROR unless the transport
+         * can tell failures apart.
+         */
+        virtual SmBusError GetLastBusError() {return SMBUS_UNKNOWN_ERROR;}
+
+        /**
+         * @brief Reads a run of consecutive registers in as few
+         * transactions as the width allows. Word transactions the
+         * device refuses are redone a byte at a time.
+         * 
+         * @param address SMBus address of the device.
+         * @param firstCommand first register to read.
+         * @param count number of registers to read.
+         * @param values count bytes filled out with the registers.
+         * @param width widest transfer the device supports.
+         * @return true if every register was read.
+         * @return false otherwise.
+         */
+        bool ReadRegisters(uint8_t address, uint8_t firstCommand, uint8_t count, uint8_t* values,
+                           SmBusTransferWidth width = BYTE_TRANSFERS);
+
+        /**
+         * @brief Writes a run of consecutive registers in as few
+         * transactions as the width allows, lowest register first.
+         * Stops at the first register that can't be written.
+         * 
+         * @param address SMBus address of the device.
+         * @param firstCommand first register to write.
+         * @param count number of registers to write.
+         * @param values count bytes to write.
+         * @param width widest transfer the device supports.
+         * @return true if every register was written.
+         * @return false otherwise.
+         */
+        bool WriteRegisters(uint8_t address, uint8_t firstCommand, uint8_t count, const uint8_t* values,
+                            SmBusTransferWidth width = BYTE_TRANSFERS);
+
+        /**
+         * @brief Gets the cost of the batches run so far.
+         * 
+         * @param metrics filled out with the batch metrics.
+         */
+        void GetBatchMetrics(SmBusBatchMetrics* metrics);
+
+        /**
+         * @brief Clears the batch metrics.
+         * 
+         */
+        void ResetBatchMetrics();
+
+    private:
+        std::mutex m_metricsMutex;
+        SmBusBatchMetrics m_batchMetrics;
+
+        void RecordBatch(unsigned long long elapsedUs, uint8_t registers,
+                         unsigned int transactions, unsigned int wordFallbacks);
+    };
+
+    /**
+     * @brief Gets the transport for the platform the library was
+     * built for: the console's SMBus on Xbox, a simulated XboxHDMI
+     * everywhere else.
+     * 
+     * @return SmBusTransport* transport shared by the whole
+     * application, never nullptr.
+     */
+    SmBusTransport* GetPlatformSmBusTransport();
+} // Conflux
+
+#endif // SMBUSTRANSPORT_H
@@ -0,0 +1,198 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "BusTransactionPolicy.h"
+#include "XboxHDMI_Config.h"
+#include "XboxHdmiRegisters.h"
+#include <string.h>
+#include <chrono>
+#include <thread>
+
+namespace Conflux
+{
+    namespace XboxHDMI
+    {
+        BusTransactionPolicy::BusTransactionPolicy(SmBusTransport* transport)
+            : m_jitter((std::minstd_rand::result_type)std::chrono::steady_clock::now().time_since_epoch().count())
+        {
+            m_transport = transport;
+            m_lastError = SMBUS_OK;
+            ResetErrorCounters();
+        }
+
+        bool BusTransactionPolicy::ReadByte(uint8_t address, uint8_t command, uint8_t* value)
+        {
+            return Run(command, GetRetryLimit(command, false), [this, address, command, value]() {
+                return m_transport->ReadByte(address, command, value);
+            });
+        }
+
+        bool BusTransactionPolicy::WriteByte(uint8_t address, uint8_t command, uint8_t value)
+        {
+            return Run(command, GetRetryLimit(command, true), [this, address, command, value]() {
+                return m_transport->WriteByte(address, command, value);
+            });
+        }
+
+        bool BusTransactionPolicy::SupportsWordTransfers()
+        {
+            return m_transport->SupportsWordTransfers();
+        }
+
+        bool BusTransactionPolicy::ReadWord(uint8_t address, uint8_t command, uint16_t* value)
+        {
+            if(!m_transport->SupportsWordTransfers())
+            {
+                m_lastError = SMBUS_INVALID_REQUEST;
+                return false;
+            }
+
+            unsigned int lowLimit = GetRetryLimit(command, false);
+            unsigned int highLimit = GetRetryLimit(command + 1, false);
+            return Run(command, lowLimit < highLimit ? lowLimit : highLimit, [this, address, command, value]() {
+                return m_transport->ReadWord(address, command, value);
+            });
+        }
+
+        bool BusTransactionPolicy::WriteWord(uint8_t address, uint8_t command, uint16_t value)
+        {
+            if(!m_transport->SupportsWordTransfers())
+            {
+                m_lastError = SMBUS_INVALID_REQUEST;
+                return false;
+            }
+
+            unsigned int lowLimit = GetRetryLimit(command, true);
+            unsigned int highLimit = GetRetryLimit(command + 1, true);
+            return Run(command, lowLimit < highLimit ? lowLimit : highLimit, [this, address, command, value]() {
+                return m_transport->WriteWord(address, command, value);
+            });
+        }
+
+        SmBusError BusTransactionPolicy::GetLastBusError()
+        {
+            return m_lastError;
+        }
+
+        unsigned int BusTransactionPolicy::GetRetryLimit(uint8_t command, bool isWrite)
+        {
+            // Each data byte moves the device's page position on, and a byte
+            // that landed before its acknowledgement was lost would be written
+            // twice. A failed byte fails the page, which is retried as a whole.
+            if(isWrite && XboxHdmiRegisterMap::IsWriteStream(command))
+            {
+                return 0;
+            }
+
+            return SMBUS_TRANSACTION_RETRIES;
+        }
+
+        void BusTransactionPolicy::GetErrorCounters(uint8_t command, BusErrorCounters* counters)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            *counters = m_counters[command];
+        }
+
+        void BusTransactionPolicy::GetErrorTotals(BusErrorCounters* counters)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            memset(counters, 0, sizeof(BusErrorCounters));
+            for(const BusErrorCounters& registerCounters : m_counters)
+            {
+                counters->transientErrors += registerCounters.transientErrors;
+                counters->fatalErrors += registerCounters.fatalErrors;
+                counters->retries += registerCounters.retries;
+                counters->recovered += registerCounters.recovered;
+                counters->failed += registerCounters.failed;
+                counters->deadlinesExceeded += registerCounters.deadlinesExceeded;
+            }
+        }
+
+        void BusTransactionPolicy::ResetErrorCounters()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            memset(m_counters, 0, sizeof(m_counters));
+        }
+
+        template<typename Transaction>
+        bool BusTransactionPolicy::Run(uint8_t command, unsigned int retryLimit, Transaction transaction)
+        {
+            // No lock or clock on the path that succeeds first time
+            if(transaction())
+            {
+                m_lastError = SMBUS_OK;
+                return true;
+            }
+
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            unsigned int backoffUs = SMBUS_RETRY_INITIAL_BACKOFF_US;
+            for(unsigned int retry = 0; ; ++retry)
+            {
+                SmBusError error = m_transport->GetLastBusError();
+                bool isTransient = IsTransientSmBusError(error);
+
+                std::unique_lock<std::mutex> lock(m_mutex);
+                BusErrorCounters& counters = m_counters[command];
+                m_lastError = error;
+                if(isTransient)
+                {
+                    ++counters.transientErrors;
+                }
+                else
+                {
+                    ++counters.fatalErrors;
+                }
+
+                if(!isTransient || retry >= retryLimit)
+                {
+                    ++counters.failed;
+                    return false;
+                }
+
+                unsigned int delayUs = JitterBackoff(backoffUs);
+                unsigned long long elapsedUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                                                   std::chrono::steady_clock::now() - start).count();
+                if(elapsedUs + delayUs > SMBUS_TRANSACTION_DEADLINE_US)
+                {
+                    ++counters.failed;
+                    ++counters.deadlinesExceeded;
+                    return false;
+                }
+
+                ++counters.retries;
+                lock.unlock();
+
+                std::this_thread::sleep_for(std::chrono::microseconds(delayUs));
+                backoffUs = (backoffUs * 2 < SMBUS_RETRY_MAX_BACKOFF_US) ? backoffUs * 2 : SMBUS_RETRY_MAX_BACKOFF_US;
+
+                if(transaction())
+                {
+                    lock.lock();
+                    ++m_counters[command].recovered;
+                    m_lastError = SMBUS_OK;
+                    return true;
+                }
+            }
+        }
+
+        unsigned int BusTransactionPolicy::JitterBackoff(unsigned int backoffUs)
+        {
+            // Somewhere in the upper half, so retries from a shared glitch spread out
+            std::uniform_int_distribution<unsigned int> distribution(backoffUs / 2, backoffUs);
+            return distribution(m_jitter);
+        }
+    } // XboxHDMI
+} // Conflux
@@ -0,0 +1,119 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef BUSTRANSACTIONPOLICY_H
+#define BUSTRANSACTIONPOLICY_H
+
+#include "SmBusTransport.h"
+#include <stdint.h>
+#include <mutex>
+#include <atomic>
+#include <random>
+
+namespace Conflux
+{
+    namespace XboxHDMI
+    {
+        /**
+         * @brief Failures seen by a BusTransactionPolicy, for one
+         * register or for all of them.
+         * 
+         */
+        struct BusErrorCounters
+        {
+            unsigned long long transientErrors;     // Failed attempts worth trying again
+            unsigned long long fatalErrors;         // Failed attempts that never will succeed
+            unsigned long long retries;             // Attempts made after a transient error
+            unsigned long long recovered;           // Transactions that succeeded on a retry
+            unsigned long long failed;              // Transactions that failed after every attempt
+            unsigned long long deadlinesExceeded;   // Of those, ones stopped by the deadline
+        };
+
+        /**
+         * @brief Retries transactions that fail for transient reasons,
+         * such as a NAK or lost arbitration, with a jittered exponential
+         * back off, so a glitch on the bus costs a few milliseconds
+         * rather than a failed operation. Fatal errors are returned
+         * straight away, and no retry starts past the transaction
+         * deadline.
+         * 
+         * Transactions that can't be safely repeated are never retried,
+         * see GetRetryLimit().
+         * 
+         */
+        class BusTransactionPolicy : public SmBusTransport
+        {
+        public:
+            /**
+             * @brief Construct a new BusTransactionPolicy object.
+             * 
+             * @param transport transport the device is reached through.
+             */
+            BusTransactionPolicy(SmBusTransport* transport);
+
+            bool ReadByte(uint8_t address, uint8_t command, uint8_t* value);
+            bool WriteByte(uint8_t address, uint8_t command, uint8_t value);
+            bool SupportsWordTransfers();
+            bool ReadWord(uint8_t address, uint8_t command, uint16_t* value);
+            bool WriteWord(uint8_t address, uint8_t command, uint16_t value);
+            SmBusError GetLastBusError();
+
+            /**
+             * @brief Gets how many times a transaction with a register
+             * may be retried.
+             * 
+             * @param command XboxHDMI register.
+             * @param isWrite true for a write, false for a read.
+             * @return unsigned int retries after the first attempt.
+             */
+            static unsigned int GetRetryLimit(uint8_t command, bool isWrite);
+
+            /**
+             * @brief Gets the failures seen with one register.
+             * 
+             * @param command register, of any device.
+             * @param counters filled out with the register's counters.
+             */
+            void GetErrorCounters(uint8_t command, BusErrorCounters* counters);
+
+            /**
+             * @brief Gets the failures seen with every register.
+             * 
+             * @param counters filled out with the sum of all counters.
+             */
+            void GetErrorTotals(BusErrorCounters* counters);
+
+            /**
+             * @brief Clears every error counter.
+             * 
+             */
+            void ResetErrorCounters();
+
+        private:
+            SmBusTransport* m_transport;
+            std::mutex m_mutex;
+            BusErrorCounters m_counters[256];
+            std::atomic<SmBusError> m_lastError;
+            std::minstd_rand m_jitter;
+
+            template<typename Transaction>
+            bool Run(uint8_t command, unsigned int retryLimit, Transaction transaction);
+            unsigned int JitterBackoff(unsigned int backoffUs);
+        };
+    } // XboxHDMI
+} // Conflux
+
+#endif // BUSTRANSACTIONPOLICY_H
@@ -23,11 +23,31 @@ namespace Conflux
     {
         const char* const DEFAULT_FIRMWARE_WORKING_DIRECTORY = "D:\\firmware.bin";
         const char* const DEFAULT_FIRMWARE_WORKING_DIRECTORY_OPEN_MODE = "rb";
+        const char* const DEFAULT_FLASH_PLAN_WORKING_DIRECTORY = "D:\\firmware.plan";
+        const char* const DEFAULT_FLASH_JOURNAL_DIRECTORY = "E:\\Conflux";
+        const char* const DEFAULT_FLASH_JOURNAL_PATH = "E:\\Conflux\\firmware.journal";
+        const char* const DEFAULT_FLASH_MANIFEST_PATH = "E:\\Conflux\\firmware.manifest";
+        const char* const DEFAULT_SMBUS_TRACE_PATH = "E:\\Conflux\\smbus.trace";
+        const char* const DEFAULT_FIRMWARE_CONTAINER_WORKING_DIRECTORY = "D:\\firmware.cfw";
+        const char* const DEFAULT_FIRMWARE_HDD_DIRECTORIES[] = {"E:\\Conflux", "E:\\Conflux\\Firmware"};
+        const char* const DEFAULT_FIRMWARE_DVD_DIRECTORIES[] = {"R:\\", "R:\\Conflux"};
+        const char* const FIRMWARE_FILE_EXTENSIONS[] = {".cfw", ".bin"};
+        const char HDD_DRIVE_LETTER = 'E';
+        const char* const HDD_DRIVE_DEVICE_PATH = "\\Device\\Harddisk0\\Partition1\\";
+        const char DVD_DRIVE_LETTER = 'R';
+        const char* const DVD_DRIVE_DEVICE_PATH = "\\Device\\CdRom0";
+        const unsigned int FIRMWARE_CATALOG_TIME_TO_LIVE_MS = 2000;
 
         const char* const PROG_PROCESS_LOADING_FIRMWARE = "Loading firmware";
         const char* const PROG_PROCESS_FIRMWARE_FILE_SIZE = "Firmware file size-> ";
         const char* const PROG_PROCESS_LOADED_FIRMWARE = "Firmware loaded!!";
         const char* const PROG_ERROR_FAILED_TO_LOAD_FIRMWARE = "Failed to load firmware";
+        const char* const PROG_PROCESS_BUILDING_FLASH_PLAN = "Computing page CRCs";
+        const char* const PROG_ERROR_FAILED_TO_BUILD_FLASH_PLAN = "Failed to compute page CRCs";
+        const char* const PROG_ERROR_FIRMWARE_IMAGE_SIZE = "Firmware image does not fit the device";
+        const char* const PROG_ERROR_FAILED_TO_READ_FIRMWARE = "Failed to read firmware page";
+        const char* const PROG_ERROR_FIRMWARE_WRONG_HARDWARE = "Firmware is for different hardware";
+        const char* const PROG_ERROR_FIRMWARE_CORRUPT = "Firmware image is corrupt";
         const char* const PROG_SWITCHING_TO_BOOTROM = "Switching to bootrom";
         const char* const PROG_WAITING_FOR_BOOTROM = "Waiting to reset to bootrom";
         const char* const PROG_CHECKING_BOOT_MODE = "Checking boot mode";
@@ -35,6 +55,11 @@ namespace Conflux
         const char* const PROG_FLASHING_FIRMWARE = "Flashing firmware";
         const char* const PROG_WRITING_PAGE_CRC = "Writing page CRC";
         const char* const PROG_WRITING_PAGE_DATA = "Writing page data";
+        const char* const PROG_FIRMWARE_ALREADY_CURRENT = "Firmware is already up to date";
+        const char* const PROG_UPDATE_PAUSED = "Update paused";
+        const char* const PROG_RESUMING_FROM_CHECKPOINT = "Resuming from page ";
+        const char* const PROG_REFLASHING_FAILED_PAGES = "Flashing pages that failed verification";
+        const char* const PROG_WAITING_FOR_NEW_FIRMWARE = "Waiting for the new firmware to boot";
 
         const char* const BOOT_MODE_HDMI_PROGRAM = "HDMI program mode";
         const char* const BOOT_MODE_HDMI_BOOTROM = "Bootrom mode";
@@ -47,6 +72,11 @@ namespace Conflux
         const char* const PROG_ERROR_UNABLE_TO_WRITE_PAGE_DATA = "Unable to write page data";
         const char* const PROG_ERROR_UNABLE_TO_WRITE_CRC_DATA = "Unable to write CRC data";
         const char* const PROG_ERROR_UNABLE_TO_CHECK_ERROR_STATUS = "Unable to read error status";
+        const char* const PROG_ERROR_DEVICE_READY_TIMEOUT = "Timed out waiting for device";
+        const char* const PROG_ERROR_UNABLE_TO_SELECT_PAGE = "Unable to select page";
+        const char* const PROG_ERROR_RETRY_LIMIT_REACHED = "Too many failed pages, giving up";
+        const char* const PROG_ERROR_UPDATE_CANCELLED = "Update cancelled";
+        const char* const PROG_ERROR_PAGE_VERIFY_FAILED = "Page failed verification";
 
         const char* const I2C_PROG_ERROR_CRC_MESSAGE = "Failed to verify CRC";
         const char* const I2C_PROG_ERROR_WRITE_MESSAGE = "Failed to write flash";
@@ -54,9 +84,37 @@ namespace Conflux
 
         const unsigned int PROGRAMMABLE_PAGES = 38;
         const unsigned int XBOX_HDMI_PAGE_SIZE = 1024;
+        const unsigned int PAGE_ARENA_ALIGNMENT = 32;   // Cache line size of the Xbox CPU
 
         const unsigned int CRC_INIT = 0xffffffff;
 
+        // Events a full update with the default retry policy queues: a page done and up
+        // to three phase changes per page, every whole percentage, four events for each
+        // of the 20 retries, and the phases before and after the page loop
+        const unsigned int FIRMWARE_UPDATE_EVENT_BUDGET = (PROGRAMMABLE_PAGES * 4) + 101 + (20 * 4) + 32;
+
+        // Page programming waits, in milliseconds
+        const unsigned int PROG_READY_FIXED_DELAY_MS = 750;
+        const unsigned int PROG_READY_POLL_INITIAL_INTERVAL_MS = 1;
+        const unsigned int PROG_READY_POLL_MAX_INTERVAL_MS = 50;
+        const unsigned int PROG_READY_DEADLINE_MS = 5000;
+
+        // SMBus worker
+        const unsigned int SMBUS_QUERY_LATENCY_TARGET_MS = 20;     // Read-only queries overdue by this much jump the queue
+        const unsigned int SMBUS_PAGE_DATA_BYTES_PER_JOB = 64;     // Page data is handed to the worker in slices this size
+
+        // SMBus transaction retries, in microseconds
+        const unsigned int SMBUS_TRANSACTION_RETRIES = 3;          // Retries after the first attempt at a transient error
+        const unsigned int SMBUS_RETRY_INITIAL_BACKOFF_US = 250;   // Doubled for each retry, then jittered
+        const unsigned int SMBUS_RETRY_MAX_BACKOFF_US = 4000;
+        const unsigned int SMBUS_TRANSACTION_DEADLINE_US = 20000;  // No retry starts past this, counted from the first attempt
+
+        // Boot mode transition waits, in milliseconds
+        const unsigned int BOOT_MODE_POLL_INTERVAL_MS = 20;
+        const unsigned int BOOT_MODE_SWITCH_DEADLINE_MS = 5000;
+        const unsigned int BOOT_MODE_RESET_SETTLE_MS = 250;
+        const unsigned int NEW_FIRMWARE_BOOT_DEADLINE_MS = 5000;  // Manifest is not recorded if the image isn't seen running
+
         // XboxHDMI addresses were changed to const values from
         // preprocessor defines to allow them to be properly
         // namespaced
@@ -0,0 +1,452 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "FirmwareCatalog.h"
+#include "XboxHDMI_Config.h"
+#include "FileSystem.h"
+#include <ctype.h>
+#include <cstring>
+#include <thread>
+
+namespace Conflux
+{
+    namespace XboxHDMI
+    {
+        FirmwareCatalog::FirmwareCatalog()
+        {
+            for(SourceIndex& sourceIndex : m_sources)
+            {
+                sourceIndex.prepareSource = nullptr;
+                sourceIndex.configuration = 0;
+                sourceIndex.indexed = false;
+                sourceIndex.validated = false;
+                sourceIndex.scanRequested = false;
+                sourceIndex.scanRunning = false;
+                sourceIndex.stopScanning = false;
+            }
+            m_timeToLiveMs = FIRMWARE_CATALOG_TIME_TO_LIVE_MS;
+        }
+
+        FirmwareCatalog::~FirmwareCatalog()
+        {
+            for(SourceIndex& sourceIndex : m_sources)
+            {
+                if(sourceIndex.scanThread.joinable())
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(sourceIndex.mutex);
+                        sourceIndex.stopScanning = true;
+                    }
+                    sourceIndex.scanSignal.notify_all();
+                    sourceIndex.scanThread.join();
+                }
+            }
+        }
+
+        void FirmwareCatalog::AddSearchDirectory(UpdateSource updateSource, const char* directoryPath)
+        {
+            SourceIndex* sourceIndex = GetSource(updateSource);
+            if(sourceIndex == nullptr)
+            {
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(sourceIndex->mutex);
+            for(const std::string& directory : sourceIndex->directories)
+            {
+                if(directory == directoryPath)
+                {
+                    return;
+                }
+            }
+
+            sourceIndex->directories.push_back(directoryPath);
+            InvalidateLocked(sourceIndex);
+        }
+
+        void FirmwareCatalog::AddSearchPath(UpdateSource updateSource, const char* firmwareFilePath)
+        {
+            SourceIndex* sourceIndex = GetSource(updateSource);
+            if(sourceIndex == nullptr)
+            {
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(sourceIndex->mutex);
+            AddPathLocked(sourceIndex, firmwareFilePath);
+        }
+
+        void FirmwareCatalog::SetSourcePreparation(UpdateSource updateSource, bool (*prepareSource)())
+        {
+            SourceIndex* sourceIndex = GetSource(updateSource);
+            if(sourceIndex == nullptr)
+            {
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(sourceIndex->mutex);
+            sourceIndex->prepareSource = prepareSource;
+            InvalidateLocked(sourceIndex);
+        }
+
+        void FirmwareCatalog::SetTimeToLive(uint32_t timeToLiveMs)
+        {
+            m_timeToLiveMs = timeToLiveMs;
+        }
+
+        void FirmwareCatalog::Refresh()
+        {
+            for(int source = 0; source < SOURCE_COUNT; ++source)
+            {
+                SourceIndex* sourceIndex = &m_sources[source];
+                std::lock_guard<std::mutex> lock(sourceIndex->mutex);
+
+                // A scan already running may have listed the files before they changed
+                RequestScanLocked((UpdateSource)source, sourceIndex);
+            }
+        }
+
+        void FirmwareCatalog::Refresh(UpdateSource updateSource)
+        {
+            SourceIndex* sourceIndex = GetSource(updateSource);
+            if(sourceIndex == nullptr)
+            {
+                return;
+            }
+
+            ScanSource(updateSource, sourceIndex);
+        }
+
+        bool FirmwareCatalog::IsUpdateAvailable(UpdateSource updateSource, const char* firmwareFilePath)
+        {
+            FirmwareCandidate candidate;
+            return GetBestCandidate(updateSource, &candidate, firmwareFilePath);
+        }
+
+        bool FirmwareCatalog::GetBestCandidate(UpdateSource updateSource, FirmwareCandidate* candidate,
+                                               const char* firmwareFilePath)
+        {
+            SourceIndex* sourceIndex = GetSource(updateSource);
+            if(sourceIndex == nullptr)
+            {
+                return false;
+            }
+
+            std::unique_lock<std::mutex> lock(sourceIndex->mutex);
+
+            // Files named by the caller are remembered so later polls stay cheap,
+            // but the first poll has nothing to answer from and waits for a scan
+            if(firmwareFilePath[0] != '\0' && AddPathLocked(sourceIndex, firmwareFilePath))
+            {
+                lock.unlock();
+                ScanSource(updateSource, sourceIndex);
+                lock.lock();
+            }
+            else
+            {
+                RefreshIfExpired(updateSource, sourceIndex, lock);
+            }
+
+            const FirmwareCandidate* bestCandidate = FindBestCandidate(*sourceIndex, firmwareFilePath);
+            if(bestCandidate == nullptr)
+            {
+                return false;
+            }
+
+            *candidate = *bestCandidate;
+            return true;
+        }
+
+        FirmwareCatalog::SourceIndex* FirmwareCatalog::GetSource(UpdateSource updateSource)
+        {
+            if(updateSource < 0 || updateSource >= SOURCE_COUNT)
+            {
+                return nullptr;
+            }
+
+            return &m_sources[updateSource];
+        }
+
+        bool FirmwareCatalog::AddPathLocked(SourceIndex* sourceIndex, const char* firmwareFilePath)
+        {
+            for(const std::string& file : sourceIndex->files)
+            {
+                if(file == firmwareFilePath)
+                {
+                    return false;
+                }
+            }
+
+            sourceIndex->files.push_back(firmwareFilePath);
+            InvalidateLocked(sourceIndex);
+            return true;
+        }
+
+        void FirmwareCatalog::InvalidateLocked(SourceIndex* sourceIndex)
+        {
+            ++sourceIndex->configuration;
+            sourceIndex->validated = false;
+        }
+
+        void FirmwareCatalog::RefreshIfExpired(UpdateSource updateSource, SourceIndex* sourceIndex,
+                                               std::unique_lock<std::mutex>& lock)
+        {
+            if(!sourceIndex->indexed)
+            {
+                // Nothing to answer from yet
+                lock.unlock();
+                ScanSource(updateSource, sourceIndex);
+                lock.lock();
+            }
+            else if(!sourceIndex->scanRunning &&
+                    (!sourceIndex->validated || std::chrono::steady_clock::now() >= sourceIndex->validUntil))
+            {
+                // Answered from the last index while the source is scanned again
+                RequestScanLocked(updateSource, sourceIndex);
+            }
+        }
+
+        void FirmwareCatalog::RequestScanLocked(UpdateSource updateSource, SourceIndex* sourceIndex)
+        {
+            if(sourceIndex->scanRequested)
+            {
+                return;
+            }
+
+            sourceIndex->scanRequested = true;
+            if(!sourceIndex->scanThread.joinable())
+            {
+                sourceIndex->scanThread = std::thread(&FirmwareCatalog::ScanLoop, this, updateSource);
+            }
+            sourceIndex->scanSignal.notify_all();
+        }
+
+        void FirmwareCatalog::ScanLoop(UpdateSource updateSource)
+        {
+            SourceIndex* sourceIndex = &m_sources[updateSource];
+            std::unique_lock<std::mutex> lock(sourceIndex->mutex);
+
+            while(true)
+            {
+                sourceIndex->scanSignal.wait(lock, [sourceIndex]() {
+                    return sourceIndex->scanRequested || sourceIndex->stopScanning;
+                });
+                if(sourceIndex->stopScanning)
+                {
+                    return;
+                }
+
+                sourceIndex->scanRequested = false;
+                sourceIndex->scanRunning = true;
+                lock.unlock();
+
+                ScanSource(updateSource, sourceIndex);
+
+                lock.lock();
+                sourceIndex->scanRunning = false;
+            }
+        }
+
+        void FirmwareCatalog::ScanSource(UpdateSource updateSource, SourceIndex* sourceIndex)
+        {
+            std::lock_guard<std::mutex> scanLock(sourceIndex->scanMutex);
+
+            // Taken under the lock, the file system is only touched without it
+            std::unique_lock<std::mutex> lock(sourceIndex->mutex);
+            std::vector<std::string> directories = sourceIndex->directories;
+            std::vector<std::string> paths = sourceIndex->files;
+            bool (*prepareSource)() = sourceIndex->prepareSource;
+            std::vector<FirmwareCandidate> previousCandidates = sourceIndex->candidates;
+            uint32_t configuration = sourceIndex->configuration;
+            lock.unlock();
+
+            bool sourceIsReady = prepareSource == nullptr || prepareSource();
+
+            if(sourceIsReady)
+            {
+                for(const std::string& directory : directories)
+                {
+                    std::vector<std::string> fileNames;
+                    ListDirectory(directory.c_str(), &fileNames);
+
+                    for(const std::string& fileName : fileNames)
+                    {
+                        if(HasFirmwareExtension(fileName))
+                        {
+                            paths.push_back(JoinPath(directory, fileName));
+                        }
+                    }
+                }
+            }
+
+            std::vector<FirmwareCandidate> candidates;
+            candidates.reserve(paths.size());
+
+            for(const std::string& path : paths)
+            {
+                // Reuse what is known about files that were seen before
+                FirmwareCandidate candidate;
+                candidate.path = path;
+                candidate.source = updateSource;
+                candidate.fileType = FIRMWARE_FILE_MISSING;
+                candidate.fileSize = 0;
+                candidate.lastWriteTime = 0;
+                candidate.hasVersion = false;
+                candidate.major = 0;
+                candidate.minor = 0;
+                candidate.patch = 0;
+                for(const FirmwareCandidate& previousCandidate : previousCandidates)
+                {
+                    if(previousCandidate.path == path)
+                    {
+                        candidate = previousCandidate;
+                        break;
+                    }
+                }
+
+                if(sourceIsReady)
+                {
+                    Revalidate(&candidate);
+                }
+                else
+                {
+                    candidate.fileType = FIRMWARE_FILE_MISSING;
+                }
+                candidates.push_back(candidate);
+            }
+
+            lock.lock();
+            sourceIndex->candidates.swap(candidates);
+            sourceIndex->validUntil = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_timeToLiveMs);
+            sourceIndex->indexed = true;
+            sourceIndex->validated = (configuration == sourceIndex->configuration);
+        }
+
+        const FirmwareCandidate* FirmwareCatalog::FindBestCandidate(const SourceIndex& sourceIndex,
+                                                                    const char* firmwareFilePath) const
+        {
+            const FirmwareCandidate* bestCandidate = nullptr;
+
+            for(const FirmwareCandidate& candidate : sourceIndex.candidates)
+            {
+                if(firmwareFilePath[0] != '\0' && candidate.path != firmwareFilePath)
+                {
+                    continue;
+                }
+
+                if(IsUsable(candidate) && (bestCandidate == nullptr || IsPreferred(candidate, *bestCandidate)))
+                {
+                    bestCandidate = &candidate;
+                }
+            }
+
+            return bestCandidate;
+        }
+
+        void FirmwareCatalog::Revalidate(FirmwareCandidate* candidate)
+        {
+            FileInfo fileInfo;
+            if(!GetFileInfo(candidate->path.c_str(), &fileInfo))
+            {
+                candidate->fileType = FIRMWARE_FILE_MISSING;
+                candidate->fileSize = 0;
+                candidate->lastWriteTime = 0;
+                candidate->hasVersion = false;
+                return;
+            }
+
+            // Unchanged files keep what was parsed last time
+            if(candidate->fileType != FIRMWARE_FILE_MISSING &&
+               candidate->fileSize == fileInfo.size &&
+               candidate->lastWriteTime == fileInfo.lastWriteTime)
+            {
+                return;
+            }
+
+            FirmwareHeader firmwareHeader;
+            uint32_t fileSize = 0;
+            candidate->fileType = firmwareHeader.ReadFromFile(candidate->path.c_str(), &fileSize);
+            candidate->fileSize = fileSize;
+            candidate->lastWriteTime = fileInfo.lastWriteTime;
+            candidate->hasVersion = false;
+
+            if(candidate->fileType == FIRMWARE_FILE_CONTAINER)
+            {
+                if(firmwareHeader.GetHardwareId() != HdmiHardwareId::XBOXHDMI)
+                {
+                    candidate->fileType = FIRMWARE_FILE_INVALID;
+                    return;
+                }
+
+                candidate->hasVersion = true;
+                candidate->major = firmwareHeader.GetMajor();
+                candidate->minor = firmwareHeader.GetMinor();
+                candidate->patch = firmwareHeader.GetPatch();
+            }
+        }
+
+        bool FirmwareCatalog::HasFirmwareExtension(const std::string& fileName)
+        {
+            for(const char* extension : FIRMWARE_FILE_EXTENSIONS)
+            {
+                size_t extensionLength = strlen(extension);
+                if(fileName.size() <= extensionLength)
+                {
+                    continue;
+                }
+
+                size_t offset = fileName.size() - extensionLength;
+                bool extensionMatches = true;
+                for(size_t i = 0; i < extensionLength && extensionMatches; ++i)
+                {
+                    extensionMatches = tolower((unsigned char)fileName[offset + i]) == extension[i];
+                }
+
+                if(extensionMatches)
+                {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        bool FirmwareCatalog::IsUsable(const FirmwareCandidate& candidate)
+        {
+            // Other .bin files, like BIOS images, are too large to be HDMI firmware
+            return (candidate.fileType == FIRMWARE_FILE_RAW && candidate.fileSize > 0 &&
+                    candidate.fileSize <= PROGRAMMABLE_PAGES * XBOX_HDMI_PAGE_SIZE) ||
+                   candidate.fileType == FIRMWARE_FILE_CONTAINER;
+        }
+
+        bool FirmwareCatalog::IsPreferred(const FirmwareCandidate& candidate, const FirmwareCandidate& current)
+        {
+            if(candidate.hasVersion != current.hasVersion)
+            {
+                return candidate.hasVersion;
+            }
+
+            if(!candidate.hasVersion)
+            {
+                return false;
+            }
+
+            uint32_t candidateVersion = (candidate.major << 16) | (candidate.minor << 8) | candidate.patch;
+            uint32_t currentVersion = (current.major << 16) | (current.minor << 8) | current.patch;
+            return candidateVersion > currentVersion;
+        }
+    } // XboxHDMI
+} // Conflux
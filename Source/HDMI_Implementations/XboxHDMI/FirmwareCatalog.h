@@ -0,0 +1,200 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef FIRMWARECATALOG_H
+#define FIRMWARECATALOG_H
+
+#include "Enums.h"
+#include "FirmwareHeader.h"
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Conflux
+{
+    namespace XboxHDMI
+    {
+        /**
+         * @brief A firmware file found on one of the update sources.
+         * 
+         */
+        struct FirmwareCandidate
+        {
+            std::string path;
+            UpdateSource source;
+            FirmwareFileType fileType;
+            uint32_t fileSize;
+            uint64_t lastWriteTime;     // FILETIME ticks, only compared for equality
+            bool hasVersion;            // Only containers carry a version
+            uint8_t major;
+            uint8_t minor;
+            uint8_t patch;
+        };
+
+        /**
+         * @brief In memory index of the firmware files on the update
+         * sources, so availability can be polled every frame.
+         * 
+         * Each source has its own search directories and files, and is
+         * indexed independently so a slow source, like a DVD drive that
+         * is spinning up, never holds up queries about another. Files
+         * are only stat'd again once the time to live of their source
+         * has expired or Refresh() is called, and headers are only read
+         * again when the size or write time of a file has changed.
+         * 
+         * Once a source has been indexed, queries are answered from the
+         * last index and never touch the file system. An expired source
+         * is scanned again on a background thread of its own, and the
+         * new index replaces the old one when the scan completes.
+         * 
+         */
+        class FirmwareCatalog
+        {
+        public:
+            FirmwareCatalog();
+            ~FirmwareCatalog();
+
+            /**
+             * @brief Adds a directory to scan for firmware files, by
+             * file extension. Directories already added are ignored.
+             * 
+             * @param updateSource source the directory belongs to.
+             * @param directoryPath absolute path to the directory.
+             */
+            void AddSearchDirectory(UpdateSource updateSource, const char* directoryPath);
+
+            /**
+             * @brief Adds a single file to check for firmware. Paths
+             * already added are ignored.
+             * 
+             * @param updateSource source the file belongs to.
+             * @param firmwareFilePath absolute path to the file.
+             */
+            void AddSearchPath(UpdateSource updateSource, const char* firmwareFilePath);
+
+            /**
+             * @brief Sets a function called before a source is scanned,
+             * for example to mount the drive it lives on.
+             * 
+             * @param updateSource source to prepare.
+             * @param prepareSource returns false if the source can't be
+             * scanned right now.
+             */
+            void SetSourcePreparation(UpdateSource updateSource, bool (*prepareSource)());
+
+            /**
+             * @brief Sets how long results are trusted before files
+             * are checked again.
+             * 
+             * @param timeToLiveMs time to live in milliseconds.
+             */
+            void SetTimeToLive(uint32_t timeToLiveMs);
+
+            /**
+             * @brief Queues a scan of every source, each on its own
+             * background thread, and returns at once. Each index is
+             * replaced as the scan of its source completes.
+             * 
+             */
+            void Refresh();
+
+            /**
+             * @brief Scans one source now, on the calling thread. Blocks
+             * until the scan completes, a DVD drive may have to spin up
+             * first, so this is not for a render loop.
+             * 
+             * @param updateSource source to scan.
+             */
+            void Refresh(UpdateSource updateSource);
+
+            /**
+             * @brief Checks if usable firmware was found on a source.
+             * Only the first query about a source, or about a file not
+             * asked about before, waits for a scan.
+             * 
+             * @param updateSource source to check.
+             * @param firmwareFilePath optional absolute path of the file
+             * to check, instead of any file on the source.
+             * @return true if a usable candidate exists.
+             * @return false otherwise.
+             */
+            bool IsUpdateAvailable(UpdateSource updateSource, const char* firmwareFilePath = "");
+
+            /**
+             * @brief Gets the preferred firmware on a source. Containers
+             * are preferred over raw images, then the highest version,
+             * then the order files were found in. Waits for a scan in
+             * the same cases as IsUpdateAvailable().
+             * 
+             * @param updateSource source to check.
+             * @param candidate filled out with the preferred candidate.
+             * @param firmwareFilePath optional absolute path of the file
+             * to use, instead of choosing one.
+             * @return true if a usable candidate was found.
+             * @return false otherwise.
+             */
+            bool GetBestCandidate(UpdateSource updateSource, FirmwareCandidate* candidate,
+                                  const char* firmwareFilePath = "");
+
+        private:
+            struct SourceIndex
+            {
+                std::mutex mutex;                   // Guards everything below, never held across file system calls
+                std::mutex scanMutex;               // One scan of the source at a time, taken before mutex
+                std::condition_variable scanSignal;
+                std::thread scanThread;             // Started by the first background scan
+                std::vector<std::string> directories;
+                std::vector<std::string> files;
+                bool (*prepareSource)();
+                uint32_t configuration;             // Bumped whenever directories, files or preparation change
+                std::vector<FirmwareCandidate> candidates;
+                std::chrono::steady_clock::time_point validUntil;
+                bool indexed;                       // Candidates come from at least one completed scan
+                bool validated;                     // ... of the current configuration
+                bool scanRequested;
+                bool scanRunning;
+                bool stopScanning;
+            };
+
+            static const int SOURCE_COUNT = UpdateSource::WORKING_DIRECTORY + 1;
+
+            SourceIndex m_sources[SOURCE_COUNT];
+            std::atomic<uint32_t> m_timeToLiveMs;
+
+            SourceIndex* GetSource(UpdateSource updateSource);
+            bool AddPathLocked(SourceIndex* sourceIndex, const char* firmwareFilePath);
+            void InvalidateLocked(SourceIndex* sourceIndex);
+            void RefreshIfExpired(UpdateSource updateSource, SourceIndex* sourceIndex,
+                                  std::unique_lock<std::mutex>& lock);
+            void RequestScanLocked(UpdateSource updateSource, SourceIndex* sourceIndex);
+            void ScanLoop(UpdateSource updateSource);
+            void ScanSource(UpdateSource updateSource, SourceIndex* sourceIndex);
+            const FirmwareCandidate* FindBestCandidate(const SourceIndex& sourceIndex,
+                                                       const char* firmwareFilePath) const;
+            static void Revalidate(FirmwareCandidate* candidate);
+            static bool HasFirmwareExtension(const std::string& fileName);
+            static bool IsUsable(const FirmwareCandidate& candidate);
+            static bool IsPreferred(const FirmwareCandidate& candidate, const FirmwareCandidate& current);
+        };
+    } // XboxHDMI
+} // Conflux
+
+#endif // FIRMWARECATALOG_H
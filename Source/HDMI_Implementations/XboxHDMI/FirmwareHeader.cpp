@@ -0,0 +1,167 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "FirmwareHeader.h"
+#include "FlashPlan.h"
+#include "Crc32.h"
+#include "ByteOrder.h"
+#include <stdio.h>
+#include <cstring>
+
+namespace Conflux
+{
+    namespace XboxHDMI
+    {
+        namespace
+        {
+            const uint8_t FIRMWARE_HEADER_MAGIC[4] = {'C', 'F', 'W', 'C'};
+            const uint16_t FIRMWARE_HEADER_FORMAT_VERSION = 1;
+            const uint32_t FIRMWARE_HEADER_PAGE_CRC_OFFSET = 20;
+        }
+
+        FirmwareHeader::FirmwareHeader()
+        {
+            m_hardwareId = 0;
+            m_major = 0;
+            m_minor = 0;
+            m_patch = 0;
+            m_imageLength = 0;
+            m_imageDigest = 0;
+            memset(m_pageCrcs, 0, sizeof(m_pageCrcs));
+        }
+
+        bool FirmwareHeader::Build(const uint8_t* firmwareImage, uint32_t imageLength, uint16_t hardwareId,
+                                   uint8_t major, uint8_t minor, uint8_t patch)
+        {
+            FlashPlan flashPlan;
+
+            if(!flashPlan.Build(firmwareImage, (long)imageLength))
+            {
+                return false;
+            }
+
+            m_hardwareId = hardwareId;
+            m_major = major;
+            m_minor = minor;
+            m_patch = patch;
+            m_imageLength = imageLength;
+            m_imageDigest = Crc32::Compute(firmwareImage, imageLength);
+            for(uint32_t pageIndex = 0; pageIndex < PROGRAMMABLE_PAGES; ++pageIndex)
+            {
+                m_pageCrcs[pageIndex] = flashPlan.GetEntry(pageIndex).crc;
+            }
+
+            return true;
+        }
+
+        bool FirmwareHeader::Serialize(uint8_t* buffer, uint32_t bufferSize) const
+        {
+            if(buffer == nullptr || bufferSize < SERIALIZED_SIZE)
+            {
+                return false;
+            }
+
+            memcpy(buffer, FIRMWARE_HEADER_MAGIC, sizeof(FIRMWARE_HEADER_MAGIC));
+            WriteU16LittleEndian(buffer + 4, FIRMWARE_HEADER_FORMAT_VERSION);
+            WriteU16LittleEndian(buffer + 6, m_hardwareId);
+            buffer[8] = m_major;
+            buffer[9] = m_minor;
+            buffer[10] = m_patch;
+            buffer[11] = 0;
+            WriteU32LittleEndian(buffer + 12, m_imageLength);
+            WriteU32LittleEndian(buffer + 16, m_imageDigest);
+            for(uint32_t pageIndex = 0; pageIndex < PROGRAMMABLE_PAGES; ++pageIndex)
+            {
+                WriteU32LittleEndian(buffer + FIRMWARE_HEADER_PAGE_CRC_OFFSET + (pageIndex * 4), m_pageCrcs[pageIndex]);
+            }
+            WriteU32LittleEndian(buffer + SERIALIZED_SIZE - 4, Crc32::Compute(buffer, SERIALIZED_SIZE - 4));
+
+            return true;
+        }
+
+        FirmwareFileType FirmwareHeader::Deserialize(const uint8_t* buffer, uint32_t bufferSize)
+        {
+            if(buffer == nullptr || bufferSize < sizeof(FIRMWARE_HEADER_MAGIC) ||
+               memcmp(buffer, FIRMWARE_HEADER_MAGIC, sizeof(FIRMWARE_HEADER_MAGIC)) != 0)
+            {
+                return FIRMWARE_FILE_RAW;
+            }
+
+            if(bufferSize < SERIALIZED_SIZE ||
+               ReadU16LittleEndian(buffer + 4) != FIRMWARE_HEADER_FORMAT_VERSION ||
+               ReadU32LittleEndian(buffer + SERIALIZED_SIZE - 4) != Crc32::Compute(buffer, SERIALIZED_SIZE - 4))
+            {
+                return FIRMWARE_FILE_INVALID;
+            }
+
+            m_hardwareId = ReadU16LittleEndian(buffer + 6);
+            m_major = buffer[8];
+            m_minor = buffer[9];
+            m_patch = buffer[10];
+            m_imageLength = ReadU32LittleEndian(buffer + 12);
+            m_imageDigest = ReadU32LittleEndian(buffer + 16);
+            for(uint32_t pageIndex = 0; pageIndex < PROGRAMMABLE_PAGES; ++pageIndex)
+            {
+                m_pageCrcs[pageIndex] = ReadU32LittleEndian(buffer + FIRMWARE_HEADER_PAGE_CRC_OFFSET + (pageIndex * 4));
+            }
+
+            return FIRMWARE_FILE_CONTAINER;
+        }
+
+        FirmwareFileType FirmwareHeader::ReadFromFile(const char* firmwareFilePath, uint32_t* fileSize)
+        {
+            uint8_t buffer[SERIALIZED_SIZE];
+
+            FILE* firmwareFile = fopen(firmwareFilePath, "rb");
+            if(!firmwareFile)
+            {
+                return FIRMWARE_FILE_MISSING;
+            }
+
+            size_t bytesRead = fread(buffer, 1, sizeof(buffer), firmwareFile);
+            fseek(firmwareFile, 0, SEEK_END);
+            long size = ftell(firmwareFile);
+            fclose(firmwareFile);
+
+            *fileSize = (size < 0) ? 0 : (uint32_t)size;
+
+            FirmwareFileType fileType = Deserialize(buffer, (uint32_t)bytesRead);
+            if(fileType == FIRMWARE_FILE_CONTAINER && *fileSize < SERIALIZED_SIZE + m_imageLength)
+            {
+                // Truncated copy
+                fileType = FIRMWARE_FILE_INVALID;
+            }
+
+            return fileType;
+        }
+
+        bool FirmwareHeader::ApplyToPlan(FlashPlan* flashPlan) const
+        {
+            if(!flashPlan->Begin((long)m_imageLength))
+            {
+                return false;
+            }
+
+            for(uint32_t pageIndex = 0; pageIndex < PROGRAMMABLE_PAGES; ++pageIndex)
+            {
+                flashPlan->AddPageCrc(pageIndex, m_pageCrcs[pageIndex]);
+            }
+            flashPlan->SetImageDigest(m_imageDigest);
+
+            return flashPlan->IsReady();
+        }
+    } // XboxHDMI
+} // Conflux
@@ -0,0 +1,148 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef FIRMWAREHEADER_H
+#define FIRMWAREHEADER_H
+
+#include "XboxHDMI_Config.h"
+#include "VersionCode.h"
+#include <stdint.h>
+
+namespace Conflux
+{
+    namespace XboxHDMI
+    {
+        class FlashPlan;
+
+        /**
+         * @brief What was found when probing a firmware file.
+         * 
+         */
+        enum FirmwareFileType
+        {
+            FIRMWARE_FILE_MISSING,
+            FIRMWARE_FILE_RAW,          // Plain .bin image, no header
+            FIRMWARE_FILE_CONTAINER,    // Image prefixed with a FirmwareHeader
+            FIRMWARE_FILE_INVALID,      // Container with a damaged or truncated header
+        };
+
+        /**
+         * @brief Fixed size header that prefixes a firmware image in
+         * a firmware container. It carries everything needed to check
+         * and compare a candidate image without reading the image.
+         * 
+         * Layout, little endian:
+         *  0   magic "CFWC"
+         *  4   u16 header format version
+         *  6   u16 target hardware ID, Conflux::HdmiHardwareId
+         *  8   u8  firmware major, minor, patch, reserved
+         *  12  u32 image length in bytes
+         *  16  u32 image digest, CRC-32 of the image bytes
+         *  20  u32 page CRCs, one per programmable page
+         *  ..  u32 CRC-32 of all preceding header bytes
+         * 
+         */
+        class FirmwareHeader
+        {
+        public:
+            static const uint32_t SERIALIZED_SIZE = 20 + (PROGRAMMABLE_PAGES * 4) + 4;
+
+            FirmwareHeader();
+
+            /**
+             * @brief Fills out the header for a raw firmware image.
+             * 
+             * @param firmwareImage firmware image data.
+             * @param imageLength size of the image in bytes.
+             * @param hardwareId hardware the image is built for.
+             * @param major firmware major version.
+             * @param minor firmware minor version.
+             * @param patch firmware patch version.
+             * @return true if the image fits the device.
+             * @return false otherwise.
+             */
+            bool Build(const uint8_t* firmwareImage, uint32_t imageLength, uint16_t hardwareId,
+                       uint8_t major, uint8_t minor, uint8_t patch);
+
+            /**
+             * @brief Writes the header to a buffer.
+             * 
+             * @param buffer destination buffer.
+             * @param bufferSize size of buffer, at least SERIALIZED_SIZE.
+             * @return true if the header was written.
+             * @return false otherwise.
+             */
+            bool Serialize(uint8_t* buffer, uint32_t bufferSize) const;
+
+            /**
+             * @brief Reads a header written by Serialize().
+             * 
+             * @param buffer source buffer.
+             * @param bufferSize size of buffer.
+             * @return FirmwareFileType FIRMWARE_FILE_CONTAINER if an intact
+             * header was read, FIRMWARE_FILE_RAW if the buffer doesn't start
+             * with a header, FIRMWARE_FILE_INVALID if the header is damaged.
+             */
+            FirmwareFileType Deserialize(const uint8_t* buffer, uint32_t bufferSize);
+
+            /**
+             * @brief Reads the header of a firmware file with a single
+             * small read.
+             * 
+             * @param firmwareFilePath absolute path to the firmware file.
+             * @param fileSize filled out with the size of the file.
+             * @return FirmwareFileType what was found. A container is only
+             * reported if the file is long enough to hold its image.
+             */
+            FirmwareFileType ReadFromFile(const char* firmwareFilePath, uint32_t* fileSize);
+
+            /**
+             * @brief Fills out a flash plan from the page CRCs in the header.
+             * 
+             * @param flashPlan plan to fill out.
+             * @return true if the plan is ready.
+             * @return false otherwise.
+             */
+            bool ApplyToPlan(FlashPlan* flashPlan) const;
+
+            /**
+             * @brief Fills out a Conflux::VersionCode with the firmware version.
+             * 
+             * @param versionCode version to fill out.
+             */
+            void GetVersion(VersionCode* versionCode) const {versionCode->SetVersion(m_major, m_minor, m_patch);}
+
+            uint16_t GetHardwareId() const {return m_hardwareId;}
+            uint8_t GetMajor() const {return m_major;}
+            uint8_t GetMinor() const {return m_minor;}
+            uint8_t GetPatch() const {return m_patch;}
+            uint32_t GetImageLength() const {return m_imageLength;}
+            uint32_t GetImageDigest() const {return m_imageDigest;}
+            uint32_t GetPageCrc(uint32_t pageIndex) const {return m_pageCrcs[pageIndex];}
+
+        private:
+            uint16_t m_hardwareId;
+            uint8_t m_major;
+            uint8_t m_minor;
+            uint8_t m_patch;
+            uint32_t m_imageLength;
+            uint32_t m_imageDigest;
+            uint32_t m_pageCrcs[PROGRAMMABLE_PAGES];
+        };
+    } // XboxHDMI
+} // Conflux
+
+#endif // FIRMWAREHEADER_H
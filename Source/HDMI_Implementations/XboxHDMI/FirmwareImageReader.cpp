@@ -0,0 +1,170 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "FirmwareImageReader.h"
+#include "Crc32.h"
+#include <chrono>
+#include <cstring>
+
+namespace Conflux
+{
+    namespace XboxHDMI
+    {
+        FirmwareImageReader::FirmwareImageReader()
+        {
+            m_firmwareFile = nullptr;
+            m_imageSize = 0;
+            m_imageOffset = 0;
+            m_isContainer = false;
+            m_preparationUs = 0;
+        }
+
+        FirmwareImageReader::~FirmwareImageReader()
+        {
+            Close();
+        }
+
+        bool FirmwareImageReader::Open(const char* firmwareFilePath)
+        {
+            Close();
+
+            m_firmwareFile = fopen(firmwareFilePath, DEFAULT_FIRMWARE_WORKING_DIRECTORY_OPEN_MODE);
+            if(!m_firmwareFile)
+            {
+                return false;
+            }
+
+            uint8_t headerBuffer[FirmwareHeader::SERIALIZED_SIZE];
+            size_t headerBytesRead = fread(headerBuffer, 1, sizeof(headerBuffer), m_firmwareFile);
+
+            fseek(m_firmwareFile, 0, SEEK_END);
+            long fileSize = ftell(m_firmwareFile);
+            if(fileSize < 0)
+            {
+                Close();
+                return false;
+            }
+
+            switch(m_header.Deserialize(headerBuffer, (uint32_t)headerBytesRead))
+            {
+                case FIRMWARE_FILE_CONTAINER:
+                {
+                    m_isContainer = true;
+                    m_imageOffset = FirmwareHeader::SERIALIZED_SIZE;
+                    m_imageSize = m_header.GetImageLength();
+                    if((uint32_t)fileSize < m_imageOffset + m_imageSize)
+                    {
+                        // Truncated copy
+                        Close();
+                        return false;
+                    }
+                    break;
+                }
+                case FIRMWARE_FILE_RAW:
+                {
+                    m_imageSize = (uint32_t)fileSize;
+                    break;
+                }
+                default:
+                {
+                    Close();
+                    return false;
+                }
+            }
+
+            m_preparationUs = 0;
+
+            return true;
+        }
+
+        void FirmwareImageReader::Close()
+        {
+            if(m_firmwareFile)
+            {
+                fclose(m_firmwareFile);
+                m_firmwareFile = nullptr;
+            }
+
+            m_imageSize = 0;
+            m_imageOffset = 0;
+            m_isContainer = false;
+            m_pageArena.Clear();
+        }
+
+        const uint8_t* FirmwareImageReader::AcquirePage(uint32_t pageIndex, uint32_t* pageCrc)
+        {
+            if(!m_firmwareFile || pageIndex >= PROGRAMMABLE_PAGES)
+            {
+                return nullptr;
+            }
+
+            if(!m_pageArena.IsPrepared(pageIndex))
+            {
+                uint32_t preparedCrc;
+                if(!PreparePage(pageIndex, m_pageArena.GetPage(pageIndex), &preparedCrc))
+                {
+                    return nullptr;
+                }
+                m_pageArena.MarkPrepared(pageIndex, preparedCrc);
+            }
+
+            if(pageCrc)
+            {
+                *pageCrc = m_pageArena.GetPageCrc(pageIndex);
+            }
+
+            return m_pageArena.GetPage(pageIndex);
+        }
+
+        void FirmwareImageReader::DiscardPage(uint32_t pageIndex)
+        {
+            if(pageIndex < PROGRAMMABLE_PAGES)
+            {
+                m_pageArena.Discard(pageIndex);
+            }
+        }
+
+        bool FirmwareImageReader::PreparePage(uint32_t pageIndex, uint8_t* pageBuffer, uint32_t* pageCrc)
+        {
+            std::chrono::steady_clock::time_point prepareStart = std::chrono::steady_clock::now();
+            uint32_t pageOffset = pageIndex * XBOX_HDMI_PAGE_SIZE;
+            uint32_t bytesInImage = 0;
+
+            if(pageOffset < m_imageSize)
+            {
+                bytesInImage = m_imageSize - pageOffset;
+                if(bytesInImage > XBOX_HDMI_PAGE_SIZE)
+                {
+                    bytesInImage = XBOX_HDMI_PAGE_SIZE;
+                }
+
+                if(fseek(m_firmwareFile, (long)(m_imageOffset + pageOffset), SEEK_SET) != 0 ||
+                   fread(pageBuffer, 1, bytesInImage, m_firmwareFile) != bytesInImage)
+                {
+                    return false;
+                }
+            }
+
+            // Bytes past the end of the image are flashed as 0x00
+            memset(pageBuffer + bytesInImage, 0x00, XBOX_HDMI_PAGE_SIZE - bytesInImage);
+            *pageCrc = Crc32::Compute(pageBuffer, XBOX_HDMI_PAGE_SIZE);
+
+            m_preparationUs += std::chrono::duration_cast<std::chrono::microseconds>(
+                                   std::chrono::steady_clock::now() - prepareStart).count();
+            return true;
+        }
+    } // XboxHDMI
+} // Conflux
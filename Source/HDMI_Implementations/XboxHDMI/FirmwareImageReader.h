@@ -0,0 +1,132 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef FIRMWAREIMAGEREADER_H
+#define FIRMWAREIMAGEREADER_H
+
+#include "XboxHDMI_Config.h"
+#include "FirmwareHeader.h"
+#include "PageArena.h"
+#include <stdint.h>
+#include <stdio.h>
+
+namespace Conflux
+{
+    namespace XboxHDMI
+    {
+        /**
+         * @brief Reads a firmware image from disk one page at a time
+         * into a PageArena, padding each page and computing its CRC
+         * as it is read. Each page is only read once per Open(), so
+         * the flash plan, later passes and retries are all served from
+         * memory, and memory use is bounded by the device rather than
+         * the file.
+         * 
+         * Both raw images and firmware containers can be read, pages
+         * are always numbered from the start of the image.
+         * 
+         */
+        class FirmwareImageReader
+        {
+        public:
+            FirmwareImageReader();
+            ~FirmwareImageReader();
+
+            /**
+             * @brief Opens a firmware image and reads its size, or the
+             * header if the file is a firmware container.
+             * 
+             * @param firmwareFilePath absolute path to the image.
+             * @return true if the image was opened.
+             * @return false otherwise, including damaged containers.
+             */
+            bool Open(const char* firmwareFilePath);
+
+            /**
+             * @brief Closes the image and drops the prepared pages.
+             * 
+             */
+            void Close();
+
+            /**
+             * @brief Gets the size of the open image.
+             * 
+             * @return uint32_t image size in bytes.
+             */
+            uint32_t GetImageSize() const {return m_imageSize;}
+
+            /**
+             * @brief Checks if the open file is a firmware container.
+             * 
+             * @return true if GetHeader() describes the image.
+             * @return false for raw images.
+             */
+            bool IsContainer() const {return m_isContainer;}
+
+            /**
+             * @brief Gets the header of a firmware container.
+             * 
+             * @return const FirmwareHeader& container header.
+             */
+            const FirmwareHeader& GetHeader() const {return m_header;}
+
+            /**
+             * @brief Gets a page of the image, padded with 0x00 past the
+             * end of the image. Pages are read from disk the first time
+             * they are asked for.
+             * 
+             * @param pageIndex page to get.
+             * @param pageCrc if not nullptr, filled out with the CRC of
+             * the padded page.
+             * @return const uint8_t* XBOX_HDMI_PAGE_SIZE bytes of page
+             * data, valid until the image is closed or the page is
+             * discarded. nullptr if the page could not be read.
+             */
+            const uint8_t* AcquirePage(uint32_t pageIndex, uint32_t* pageCrc = nullptr);
+
+            /**
+             * @brief Drops a prepared page so the next AcquirePage()
+             * reads it from disk again, for pages that look damaged.
+             * 
+             * @param pageIndex page to drop.
+             */
+            void DiscardPage(uint32_t pageIndex);
+
+            /**
+             * @brief Gets the time spent preparing pages since the image
+             * was opened.
+             * 
+             * @return uint64_t time spent reading, padding and computing
+             * the CRC of pages, in microseconds.
+             */
+            uint64_t GetPreparationUs() const {return m_preparationUs;}
+
+        private:
+            FILE* m_firmwareFile;
+            uint32_t m_imageSize;
+            uint32_t m_imageOffset;     // Start of the image in the file
+            bool m_isContainer;
+            FirmwareHeader m_header;
+
+            PageArena m_pageArena;
+            uint64_t m_preparationUs;
+
+            bool PreparePage(uint32_t pageIndex, uint8_t* pageBuffer, uint32_t* pageCrc);
+        };
+    } // XboxHDMI
+} // Conflux
+
+#endif // FIRMWAREIMAGEREADER_H
@@ -0,0 +1,67 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "FlashCheckpoint.h"
+
+namespace Conflux
+{
+    namespace XboxHDMI
+    {
+        FlashCheckpoint::FlashCheckpoint()
+        {
+            Clear();
+        }
+
+        void FlashCheckpoint::Begin(uint32_t planIdentity)
+        {
+            if(m_valid && m_planIdentity == planIdentity)
+            {
+                return;
+            }
+
+            m_valid = true;
+            m_planIdentity = planIdentity;
+            m_resumePage = 0;
+        }
+
+        void FlashCheckpoint::Restore(uint32_t planIdentity, uint32_t resumePage)
+        {
+            m_valid = true;
+            m_planIdentity = planIdentity;
+            m_resumePage = resumePage;
+        }
+
+        void FlashCheckpoint::MarkVerified(uint32_t pageIndex)
+        {
+            if(m_valid && pageIndex + 1 > m_resumePage)
+            {
+                m_resumePage = pageIndex + 1;
+            }
+        }
+
+        uint32_t FlashCheckpoint::GetResumePage(uint32_t planIdentity) const
+        {
+            return (m_valid && m_planIdentity == planIdentity) ? m_resumePage : 0;
+        }
+
+        void FlashCheckpoint::Clear()
+        {
+            m_valid = false;
+            m_planIdentity = 0;
+            m_resumePage = 0;
+        }
+    } // XboxHDMI
+} // Conflux
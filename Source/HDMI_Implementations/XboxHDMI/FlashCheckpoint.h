@@ -0,0 +1,91 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef FLASHCHECKPOINT_H
+#define FLASHCHECKPOINT_H
+
+#include <stdint.h>
+
+namespace Conflux
+{
+    namespace XboxHDMI
+    {
+        /**
+         * @brief Remembers how far a flash of a given plan got, so an
+         * update that was cancelled or failed can continue from the
+         * page after the last one the device verified.
+         * 
+         * Pages are always programmed in index order, so everything
+         * before the resume page is either verified or was skipped as
+         * unchanged.
+         * 
+         */
+        class FlashCheckpoint
+        {
+        public:
+            FlashCheckpoint();
+
+            /**
+             * @brief Starts tracking a flash. Progress is kept if the
+             * checkpoint already belongs to the same plan.
+             * 
+             * @param planIdentity identity of the plan being flashed,
+             * from FlashPlan::GetIdentity().
+             */
+            void Begin(uint32_t planIdentity);
+
+            /**
+             * @brief Replaces the checkpoint with progress recovered
+             * from elsewhere, such as the flash journal.
+             * 
+             * @param planIdentity identity of the plan that was being
+             * flashed.
+             * @param resumePage first page that still needs programming.
+             */
+            void Restore(uint32_t planIdentity, uint32_t resumePage);
+
+            /**
+             * @brief Records that the device verified a page.
+             * 
+             * @param pageIndex page index.
+             */
+            void MarkVerified(uint32_t pageIndex);
+
+            /**
+             * @brief Gets the page a flash of the given plan should
+             * start from.
+             * 
+             * @param planIdentity identity of the plan to flash.
+             * @return uint32_t first page that still needs programming,
+             * 0 if the checkpoint is for another plan.
+             */
+            uint32_t GetResumePage(uint32_t planIdentity) const;
+
+            /**
+             * @brief Forgets the checkpoint, once a flash has finished.
+             * 
+             */
+            void Clear();
+
+        private:
+            bool m_valid;
+            uint32_t m_planIdentity;
+            uint32_t m_resumePage;
+        };
+    } // XboxHDMI
+} // Conflux
+
+#endif // FLASHCHECKPOINT_H
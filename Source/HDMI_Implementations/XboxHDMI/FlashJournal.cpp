@@ -0,0 +1,211 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+#include "FlashJournal.h"
+#include "Crc32.h"
+#include "ByteOrder.h"
+#include <cstring>
+
+namespace Conflux
+{
+    namespace XboxHDMI
+    {
+        namespace
+        {
+            const uint8_t FLASH_JOURNAL_MAGIC[4] = {'C', 'F', 'J', 'L'};
+            const uint16_t FLASH_JOURNAL_FORMAT_VERSION = 1;
+            const uint32_t FLASH_JOURNAL_HEADER_SIZE = 24;
+            const uint32_t FLASH_JOURNAL_SLOTS = 2;
+        }
+
+        FlashJournal::FlashJournal()
+        {
+            m_journalFile = nullptr;
+            Clear();
+        }
+
+        FlashJournal::~FlashJournal()
+        {
+            Close();
+        }
+
+        void FlashJournal::Clear()
+        {
+            memset(m_pageCrcs, 0, sizeof(m_pageCrcs));
+            m_sequence = 0;
+            m_imageDigest = 0;
+            m_imageSize = 0;
+            m_resumePage = 0;
+            m_valid = false;
+        }
+
+        bool FlashJournal::Load(const char* journalPath)
+        {
+            uint8_t buffer[RECORD_SIZE * FLASH_JOURNAL_SLOTS];
+
+            Close();
+            Clear();
+
+            FILE* journalFile = fopen(journalPath, "rb");
+            if(!journalFile)
+            {
+                return false;
+            }
+
+            size_t bytesRead = fread(buffer, 1, sizeof(buffer), journalFile);
+            fclose(journalFile);
+
+            // The second slot doesn't exist until the second record
+            for(uint32_t slot = 0; slot < FLASH_JOURNAL_SLOTS && (slot + 1) * RECORD_SIZE <= bytesRead; ++slot)
+            {
+                const uint8_t* record = buffer + (slot * RECORD_SIZE);
+                if(memcmp(record, FLASH_JOURNAL_MAGIC, sizeof(FLASH_JOURNAL_MAGIC)) != 0 ||
+                   ReadU16LittleEndian(record + 4) != FLASH_JOURNAL_FORMAT_VERSION ||
+                   ReadU32LittleEndian(record + RECORD_SIZE - 4) != Crc32::Compute(record, RECORD_SIZE - 4))
+                {
+                    continue;
+                }
+
+                uint32_t sequence = ReadU32LittleEndian(record + 8);
+                if(m_valid && sequence <= m_sequence)
+                {
+                    continue;
+                }
+
+                m_sequence = sequence;
+                m_imageDigest = ReadU32LittleEndian(record + 12);
+                m_imageSize = ReadU32LittleEndian(record + 16);
+                m_resumePage = ReadU32LittleEndian(record + 20);
+                for(uint32_t pageIndex = 0; pageIndex < PROGRAMMABLE_PAGES; ++pageIndex)
+                {
+                    m_pageCrcs[pageIndex] = ReadU32LittleEndian(record + FLASH_JOURNAL_HEADER_SIZE + (pageIndex * 4));
+                }
+                m_valid = true;
+            }
+
+            if(!m_valid || m_resumePage > PROGRAMMABLE_PAGES)
+            {
+                Clear();
+                return false;
+            }
+
+            return true;
+        }
+
+        bool FlashJournal::Begin(const char* journalPath, const FlashPlan& flashPlan, uint32_t resumePage)
+        {
+            Close();
+            Clear();
+
+            if(!flashPlan.IsReady())
+            {
+                return false;
+            }
+
+            m_imageDigest = flashPlan.GetIdentity();
+            m_imageSize = flashPlan.GetImageSize();
+            m_resumePage = resumePage;
+            for(uint32_t pageIndex = 0; pageIndex < PROGRAMMABLE_PAGES; ++pageIndex)
+            {
+                m_pageCrcs[pageIndex] = flashPlan.GetEntry(pageIndex).crc;
+            }
+            m_valid = true;
+
+            // Truncated so a record left by another image can't outlive this one
+            m_journalFile = fopen(journalPath, "w+b");
+            if(!m_journalFile || !WriteRecord())
+            {
+                Close();
+                Clear();
+                return false;
+            }
+
+            return true;
+        }
+
+        bool FlashJournal::Record(uint32_t resumePage)
+        {
+            if(!m_journalFile || resumePage <= m_resumePage)
+            {
+                return false;
+            }
+
+            m_resumePage = resumePage;
+            return WriteRecord();
+        }
+
+        bool FlashJournal::WriteRecord()
+        {
+            uint8_t record[RECORD_SIZE];
+
+            ++m_sequence;
+
+            memcpy(record, FLASH_JOURNAL_MAGIC, sizeof(FLASH_JOURNAL_MAGIC));
+            WriteU16LittleEndian(record + 4, FLASH_JOURNAL_FORMAT_VERSION);
+            WriteU16LittleEndian(record + 6, 0);
+            WriteU32LittleEndian(record + 8, m_sequence);
+            WriteU32LittleEndian(record + 12, m_imageDigest);
+            WriteU32LittleEndian(record + 16, m_imageSize);
+            WriteU32LittleEndian(record + 20, m_resumePage);
+            for(uint32_t pageIndex = 0; pageIndex < PROGRAMMABLE_PAGES; ++pageIndex)
+            {
+                WriteU32LittleEndian(record + FLASH_JOURNAL_HEADER_SIZE + (pageIndex * 4), m_pageCrcs[pageIndex]);
+            }
+            WriteU32LittleEndian(record + RECORD_SIZE - 4, Crc32::Compute(record, RECORD_SIZE - 4));
+
+            // Alternating slots leave the previous record intact while this one is written
+            long slotOffset = (long)(((m_sequence - 1) % FLASH_JOURNAL_SLOTS) * RECORD_SIZE);
+            return fseek(m_journalFile, slotOffset, SEEK_SET) == 0 &&
+                   fwrite(record, 1, sizeof(record), m_journalFile) == sizeof(record) &&
+                   fflush(m_journalFile) == 0;
+        }
+
+        void FlashJournal::Close()
+        {
+            if(m_journalFile)
+            {
+                fclose(m_journalFile);
+                m_journalFile = nullptr;
+            }
+        }
+
+        void FlashJournal::Discard(const char* journalPath)
+        {
+            Close();
+            Clear();
+            remove(journalPath);
+        }
+
+        bool FlashJournal::Matches(const FlashPlan& flashPlan) const
+        {
+            if(!m_valid || !flashPlan.IsReady() ||
+               m_imageDigest != flashPlan.GetIdentity() ||
+               m_imageSize != flashPlan.GetImageSize())
+            {
+                return false;
+            }
+
+            for(uint32_t pageIndex = 0; pageIndex < PROGRAMMABLE_PAGES; ++pageIndex)
+            {
+                if(m_pageCrcs[pageIndex] != flashPlan.GetEntry(pageIndex).crc)
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+    } // XboxHDMI
+} // Conflux
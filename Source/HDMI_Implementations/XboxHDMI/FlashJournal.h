@@ -0,0 +1,138 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+#ifndef FLASHJOURNAL_H
+#define FLASHJOURNAL_H
+
+#include "FlashPlan.h"
+#include <stdint.h>
+#include <stdio.h>
+
+namespace Conflux
+{
+    namespace XboxHDMI
+    {
+        /**
+         * @brief Write-ahead record of a flash in progress, kept on
+         * the hard drive so an update cut short by a power loss can
+         * continue from the page after the last one the device
+         * acknowledged.
+         * 
+         * The journal holds two record slots that are written in
+         * turn, each with its own CRC. A record torn by a power loss
+         * only ever costs the newest slot, and loading falls back to
+         * the other one.
+         * 
+         */
+        class FlashJournal
+        {
+        public:
+            /**
+             * @brief Size in bytes of one journal record.
+             * 
+             */
+            static const uint32_t RECORD_SIZE = 24 + (PROGRAMMABLE_PAGES * 4) + 4;
+
+            FlashJournal();
+            ~FlashJournal();
+
+            /**
+             * @brief Loads the newest intact record of a journal.
+             * 
+             * @param journalPath absolute path of the journal.
+             * @return true if an intact record was found.
+             * @return false otherwise. The journal is left empty.
+             */
+            bool Load(const char* journalPath);
+
+            /**
+             * @brief Starts journaling a flash, replacing whatever the
+             * journal held before. The file stays open until Close()
+             * or Discard().
+             * 
+             * @param journalPath absolute path of the journal.
+             * @param flashPlan plan of the image being flashed.
+             * @param resumePage first page that still needs programming.
+             * @return true if the first record reached the disk.
+             * @return false otherwise, nothing is journaled.
+             */
+            bool Begin(const char* journalPath, const FlashPlan& flashPlan, uint32_t resumePage);
+
+            /**
+             * @brief Records that every page before resumePage has
+             * been acknowledged by the device. Called at page
+             * boundaries, after Begin().
+             * 
+             * @param resumePage first page that still needs programming.
+             * @return true if the record reached the disk.
+             * @return false otherwise.
+             */
+            bool Record(uint32_t resumePage);
+
+            /**
+             * @brief Closes the journal file, keeping it on disk so
+             * the flash can be resumed later.
+             * 
+             */
+            void Close();
+
+            /**
+             * @brief Closes and deletes the journal, once the flash it
+             * describes has finished.
+             * 
+             * @param journalPath absolute path of the journal.
+             */
+            void Discard(const char* journalPath);
+
+            /**
+             * @brief Checks if the journal describes a flash of the
+             * given plan.
+             * 
+             * @param flashPlan plan of the image about to be flashed.
+             * @return true if the image digest and every page CRC match.
+             * @return false otherwise.
+             */
+            bool Matches(const FlashPlan& flashPlan) const;
+
+            /**
+             * @brief Gets the first page that still needs programming.
+             * 
+             * @return uint32_t resume page, 0 if the journal is empty.
+             */
+            uint32_t GetResumePage() const {return m_resumePage;}
+
+        private:
+            /**
+             * @brief Writes the current state into the next record slot.
+             * 
+             * @return true if the record was written and flushed.
+             * @return false otherwise.
+             */
+            bool WriteRecord();
+
+            void Clear();
+
+            FILE* m_journalFile;
+            uint32_t m_sequence;
+            uint32_t m_imageDigest;
+            uint32_t m_imageSize;
+            uint32_t m_resumePage;
+            uint32_t m_pageCrcs[PROGRAMMABLE_PAGES];
+            bool m_valid;
+        };
+    } // XboxHDMI
+} // Conflux
+
+#endif // FLASHJOURNAL_H
@@ -0,0 +1,152 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "FlashManifest.h"
+#include "Crc32.h"
+#include "ByteOrder.h"
+#include <stdio.h>
+#include <cstring>
+
+namespace Conflux
+{
+    namespace XboxHDMI
+    {
+        namespace
+        {
+            const uint8_t FLASH_MANIFEST_MAGIC[4] = {'C', 'F', 'M', 'F'};
+            const uint16_t FLASH_MANIFEST_FORMAT_VERSION = 1;
+            const uint16_t FLASH_MANIFEST_FLAG_BOUND = 0x0001;
+            const uint32_t FLASH_MANIFEST_HEADER_SIZE = 12;
+        }
+
+        FlashManifest::FlashManifest()
+        {
+            Clear();
+        }
+
+        void FlashManifest::Clear()
+        {
+            memset(m_pageCrcs, 0, sizeof(m_pageCrcs));
+            m_compileTime = 0;
+            m_bound = false;
+            m_valid = false;
+        }
+
+        bool FlashManifest::Load(const char* manifestPath)
+        {
+            uint8_t buffer[SERIALIZED_SIZE];
+
+            Clear();
+
+            FILE* manifestFile = fopen(manifestPath, "rb");
+            if(!manifestFile)
+            {
+                return false;
+            }
+
+            size_t bytesRead = fread(buffer, 1, sizeof(buffer), manifestFile);
+            fclose(manifestFile);
+
+            if(bytesRead != sizeof(buffer) ||
+               memcmp(buffer, FLASH_MANIFEST_MAGIC, sizeof(FLASH_MANIFEST_MAGIC)) != 0 ||
+               ReadU16LittleEndian(buffer + 4) != FLASH_MANIFEST_FORMAT_VERSION)
+            {
+                return false;
+            }
+
+            if(ReadU32LittleEndian(buffer + SERIALIZED_SIZE - 4) != Crc32::Compute(buffer, SERIALIZED_SIZE - 4))
+            {
+                return false;
+            }
+
+            m_bound = (ReadU16LittleEndian(buffer + 6) & FLASH_MANIFEST_FLAG_BOUND) != 0;
+            m_compileTime = ReadU32LittleEndian(buffer + 8);
+            for(uint32_t pageIndex = 0; pageIndex < PROGRAMMABLE_PAGES; ++pageIndex)
+            {
+                m_pageCrcs[pageIndex] = ReadU32LittleEndian(buffer + FLASH_MANIFEST_HEADER_SIZE + (pageIndex * 4));
+            }
+            m_valid = true;
+
+            return true;
+        }
+
+        bool FlashManifest::Save(const char* manifestPath) const
+        {
+            uint8_t buffer[SERIALIZED_SIZE];
+
+            if(!m_valid)
+            {
+                return false;
+            }
+
+            memcpy(buffer, FLASH_MANIFEST_MAGIC, sizeof(FLASH_MANIFEST_MAGIC));
+            WriteU16LittleEndian(buffer + 4, FLASH_MANIFEST_FORMAT_VERSION);
+            WriteU16LittleEndian(buffer + 6, m_bound ? FLASH_MANIFEST_FLAG_BOUND : 0);
+            WriteU32LittleEndian(buffer + 8, m_compileTime);
+            for(uint32_t pageIndex = 0; pageIndex < PROGRAMMABLE_PAGES; ++pageIndex)
+            {
+                WriteU32LittleEndian(buffer + FLASH_MANIFEST_HEADER_SIZE + (pageIndex * 4), m_pageCrcs[pageIndex]);
+            }
+            WriteU32LittleEndian(buffer + SERIALIZED_SIZE - 4, Crc32::Compute(buffer, SERIALIZED_SIZE - 4));
+
+            FILE* manifestFile = fopen(manifestPath, "wb");
+            if(!manifestFile)
+            {
+                return false;
+            }
+
+            bool writeSuccessful = fwrite(buffer, 1, sizeof(buffer), manifestFile) == sizeof(buffer);
+            writeSuccessful = (fclose(manifestFile) == 0) && writeSuccessful;
+
+            return writeSuccessful;
+        }
+
+        void FlashManifest::Record(const FlashPlan& flashPlan)
+        {
+            Clear();
+
+            for(uint32_t pageIndex = 0; pageIndex < PROGRAMMABLE_PAGES; ++pageIndex)
+            {
+                m_pageCrcs[pageIndex] = flashPlan.GetEntry(pageIndex).crc;
+            }
+            m_valid = flashPlan.IsReady();
+        }
+
+        bool FlashManifest::Bind(uint32_t compileTime)
+        {
+            if(!m_valid || m_bound)
+            {
+                return false;
+            }
+
+            m_compileTime = compileTime;
+            m_bound = true;
+
+            return true;
+        }
+
+        void FlashManifest::Discard(const char* manifestPath)
+        {
+            Clear();
+            remove(manifestPath);
+        }
+
+        bool FlashManifest::Matches(uint32_t compileTime) const
+        {
+            return m_valid && m_bound && m_compileTime == compileTime;
+        }
+    } // XboxHDMI
+} // Conflux
@@ -0,0 +1,127 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef FLASHMANIFEST_H
+#define FLASHMANIFEST_H
+
+#include "FlashPlan.h"
+#include <stdint.h>
+
+namespace Conflux
+{
+    namespace XboxHDMI
+    {
+        /**
+         * @brief Page CRCs of the last image successfully flashed,
+         * keyed by the compile time that image reports once it is
+         * running. Used to skip pages that would not change.
+         * 
+         * A manifest is only bound, and saved, once the new image has
+         * been seen running straight after its flash. An image that
+         * never boots, or one replaced by another tool, then leaves
+         * nothing behind that would vouch for the pages on the device.
+         * 
+         */
+        class FlashManifest
+        {
+        public:
+            /**
+             * @brief Size in bytes of a saved manifest.
+             * 
+             */
+            static const uint32_t SERIALIZED_SIZE = 12 + (PROGRAMMABLE_PAGES * 4) + 4;
+
+            FlashManifest();
+
+            /**
+             * @brief Loads a manifest from disk.
+             * 
+             * @param manifestPath absolute path of the manifest.
+             * @return true if an intact manifest was loaded.
+             * @return false otherwise. The manifest is left empty.
+             */
+            bool Load(const char* manifestPath);
+
+            /**
+             * @brief Saves the manifest to disk.
+             * 
+             * @param manifestPath absolute path of the manifest.
+             * @return true if the manifest was written.
+             * @return false otherwise.
+             */
+            bool Save(const char* manifestPath) const;
+
+            /**
+             * @brief Replaces the manifest contents with the page CRCs
+             * of a plan that was just flashed. The manifest is unbound
+             * until Bind() is called.
+             * 
+             * @param flashPlan plan of the flashed image.
+             */
+            void Record(const FlashPlan& flashPlan);
+
+            /**
+             * @brief Binds an unbound manifest to the compile time of
+             * the firmware that was just flashed and is now running.
+             * 
+             * @param compileTime compile time reported by the device.
+             * @return true if the manifest was unbound and is now bound.
+             * @return false otherwise.
+             */
+            bool Bind(uint32_t compileTime);
+
+            /**
+             * @brief Checks if the manifest describes the firmware
+             * currently on the device.
+             * 
+             * @param compileTime compile time reported by the device.
+             * @return true if the page CRCs can be trusted.
+             * @return false if the manifest is missing or stale.
+             */
+            bool Matches(uint32_t compileTime) const;
+
+            /**
+             * @brief Gets the recorded CRC of a page.
+             * 
+             * @param pageIndex page index, less than PROGRAMMABLE_PAGES.
+             * @return uint32_t recorded page CRC.
+             */
+            uint32_t GetPageCrc(uint32_t pageIndex) const {return m_pageCrcs[pageIndex];}
+
+            /**
+             * @brief Empties the manifest and deletes it from disk,
+             * for when the pages on the device are about to change.
+             * 
+             * @param manifestPath absolute path of the manifest.
+             */
+            void Discard(const char* manifestPath);
+
+            /**
+             * @brief Empties the manifest.
+             * 
+             */
+            void Clear();
+
+        private:
+            uint32_t m_pageCrcs[PROGRAMMABLE_PAGES];
+            uint32_t m_compileTime;
+            bool m_bound;
+            bool m_valid;
+        };
+    } // XboxHDMI
+} // Conflux
+
+#endif // FLASHMANIFEST_H
@@ -0,0 +1,222 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "FlashPlan.h"
+#include "Crc32.h"
+#include "ByteOrder.h"
+#include <cstring>
+
+namespace Conflux
+{
+    namespace XboxHDMI
+    {
+        namespace
+        {
+            const uint8_t FLASH_PLAN_MAGIC[4] = {'C', 'F', 'P', 'L'};
+            const uint16_t FLASH_PLAN_FORMAT_VERSION = 2;
+            const uint32_t FLASH_PLAN_HEADER_SIZE = 16;
+            const uint32_t FLASH_PLAN_ENTRY_SIZE = 12;
+
+            uint16_t GetPageDataLength(uint32_t pageOffset, uint32_t imageSize)
+            {
+                if(pageOffset >= imageSize)
+                {
+                    return 0;
+                }
+
+                uint32_t remaining = imageSize - pageOffset;
+                return (uint16_t)(remaining > XBOX_HDMI_PAGE_SIZE ? XBOX_HDMI_PAGE_SIZE : remaining);
+            }
+        }
+
+        FlashPlan::FlashPlan()
+        {
+            Clear();
+        }
+
+        void FlashPlan::Clear()
+        {
+            memset(m_entries, 0, sizeof(m_entries));
+            m_imageSize = 0;
+            m_imageDigest = 0;
+            m_pagesAdded = 0;
+            m_ready = false;
+        }
+
+        bool FlashPlan::Build(const uint8_t* firmwareImage, long imageSize)
+        {
+            if(firmwareImage == nullptr || !Begin(imageSize))
+            {
+                return false;
+            }
+
+            for(uint32_t pageIndex = 0; pageIndex < PROGRAMMABLE_PAGES; ++pageIndex)
+            {
+                FlashPlanEntry& entry = m_entries[pageIndex];
+
+                // Bytes past the end of the image are flashed as 0x00
+                uint32_t crcValue = Crc32::Update(CRC_INIT, firmwareImage + entry.pageOffset, entry.dataLength);
+                crcValue = Crc32::UpdateZeros(crcValue, entry.paddedLength - entry.dataLength);
+                entry.crc = Crc32::Finalize(crcValue);
+            }
+
+            m_imageDigest = Crc32::Compute(firmwareImage, m_imageSize);
+            m_pagesAdded = PROGRAMMABLE_PAGES;
+            m_ready = true;
+
+            return true;
+        }
+
+        bool FlashPlan::Begin(long imageSize)
+        {
+            Clear();
+
+            if(imageSize <= 0 || imageSize > (long)(PROGRAMMABLE_PAGES * XBOX_HDMI_PAGE_SIZE))
+            {
+                return false;
+            }
+
+            for(uint32_t pageIndex = 0; pageIndex < PROGRAMMABLE_PAGES; ++pageIndex)
+            {
+                FlashPlanEntry& entry = m_entries[pageIndex];
+                entry.pageOffset = pageIndex * XBOX_HDMI_PAGE_SIZE;
+                entry.dataLength = GetPageDataLength(entry.pageOffset, (uint32_t)imageSize);
+                entry.paddedLength = XBOX_HDMI_PAGE_SIZE;
+            }
+
+            m_imageSize = (uint32_t)imageSize;
+
+            return true;
+        }
+
+        void FlashPlan::AddPageCrc(uint32_t pageIndex, uint32_t crc)
+        {
+            m_entries[pageIndex].crc = crc;
+
+            if(++m_pagesAdded == PROGRAMMABLE_PAGES)
+            {
+                m_ready = true;
+            }
+        }
+
+        uint32_t FlashPlan::GetIdentity() const
+        {
+            uint8_t value[4];
+
+            WriteU32LittleEndian(value, m_imageSize);
+            uint32_t identity = Crc32::Update(Crc32::INITIAL_VALUE, value, sizeof(value));
+            for(uint32_t pageIndex = 0; pageIndex < PROGRAMMABLE_PAGES; ++pageIndex)
+            {
+                WriteU32LittleEndian(value, m_entries[pageIndex].crc);
+                identity = Crc32::Update(identity, value, sizeof(value));
+            }
+
+            return Crc32::Finalize(identity);
+        }
+
+        bool FlashPlan::Validate(long imageSize) const
+        {
+            if(!m_ready || imageSize <= 0 || (uint32_t)imageSize != m_imageSize)
+            {
+                return false;
+            }
+
+            for(uint32_t pageIndex = 0; pageIndex < PROGRAMMABLE_PAGES; ++pageIndex)
+            {
+                const FlashPlanEntry& entry = m_entries[pageIndex];
+                if(entry.pageOffset != pageIndex * XBOX_HDMI_PAGE_SIZE ||
+                   entry.paddedLength != XBOX_HDMI_PAGE_SIZE ||
+                   entry.dataLength != GetPageDataLength(entry.pageOffset, m_imageSize))
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        bool FlashPlan::Serialize(uint8_t* buffer, uint32_t bufferSize) const
+        {
+            if(!m_ready || buffer == nullptr || bufferSize < SERIALIZED_SIZE)
+            {
+                return false;
+            }
+
+            // Header : magic, format version, page count, image size, image digest
+            memcpy(buffer, FLASH_PLAN_MAGIC, sizeof(FLASH_PLAN_MAGIC));
+            WriteU16LittleEndian(buffer + 4, FLASH_PLAN_FORMAT_VERSION);
+            WriteU16LittleEndian(buffer + 6, (uint16_t)PROGRAMMABLE_PAGES);
+            WriteU32LittleEndian(buffer + 8, m_imageSize);
+            WriteU32LittleEndian(buffer + 12, m_imageDigest);
+
+            uint8_t* entryData = buffer + FLASH_PLAN_HEADER_SIZE;
+            for(uint32_t pageIndex = 0; pageIndex < PROGRAMMABLE_PAGES; ++pageIndex)
+            {
+                const FlashPlanEntry& entry = m_entries[pageIndex];
+                WriteU32LittleEndian(entryData, entry.pageOffset);
+                WriteU16LittleEndian(entryData + 4, entry.dataLength);
+                WriteU16LittleEndian(entryData + 6, entry.paddedLength);
+                WriteU32LittleEndian(entryData + 8, entry.crc);
+                entryData += FLASH_PLAN_ENTRY_SIZE;
+            }
+
+            // Trailer : CRC of everything before it
+            WriteU32LittleEndian(entryData, Crc32::Compute(buffer, SERIALIZED_SIZE - 4));
+
+            return true;
+        }
+
+        bool FlashPlan::Deserialize(const uint8_t* buffer, uint32_t bufferSize)
+        {
+            Clear();
+
+            if(buffer == nullptr || bufferSize < SERIALIZED_SIZE)
+            {
+                return false;
+            }
+
+            if(memcmp(buffer, FLASH_PLAN_MAGIC, sizeof(FLASH_PLAN_MAGIC)) != 0 ||
+               ReadU16LittleEndian(buffer + 4) != FLASH_PLAN_FORMAT_VERSION ||
+               ReadU16LittleEndian(buffer + 6) != PROGRAMMABLE_PAGES)
+            {
+                return false;
+            }
+
+            if(ReadU32LittleEndian(buffer + SERIALIZED_SIZE - 4) != Crc32::Compute(buffer, SERIALIZED_SIZE - 4))
+            {
+                return false;
+            }
+
+            const uint8_t* entryData = buffer + FLASH_PLAN_HEADER_SIZE;
+            for(uint32_t pageIndex = 0; pageIndex < PROGRAMMABLE_PAGES; ++pageIndex)
+            {
+                FlashPlanEntry& entry = m_entries[pageIndex];
+                entry.pageOffset = ReadU32LittleEndian(entryData);
+                entry.dataLength = ReadU16LittleEndian(entryData + 4);
+                entry.paddedLength = ReadU16LittleEndian(entryData + 6);
+                entry.crc = ReadU32LittleEndian(entryData + 8);
+                entryData += FLASH_PLAN_ENTRY_SIZE;
+            }
+
+            m_imageSize = ReadU32LittleEndian(buffer + 8);
+            m_imageDigest = ReadU32LittleEndian(buffer + 12);
+            m_pagesAdded = PROGRAMMABLE_PAGES;
+            m_ready = true;
+
+            return true;
+        }
+    } // XboxHDMI
+} // Conflux
@@ -0,0 +1,185 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef FLASHPLAN_H
+#define FLASHPLAN_H
+
+#include "XboxHDMI_Config.h"
+#include <stdint.h>
+
+namespace Conflux
+{
+    namespace XboxHDMI
+    {
+        /**
+         * @brief Everything the flash loop needs to know about a
+         * single page, computed before any bus traffic starts.
+         * 
+         */
+        struct FlashPlanEntry
+        {
+            uint32_t pageOffset;    // Offset of the page in the image
+            uint16_t dataLength;    // Bytes taken from the image
+            uint16_t paddedLength;  // Bytes sent, padded with 0x00
+            uint32_t crc;           // Final CRC of the padded page
+        };
+
+        /**
+         * @brief Precomputed page CRCs for a firmware image. A plan
+         * is built once when the image is loaded, or produced offline
+         * by host tooling and deserialized on the console, so the
+         * flash loop itself only performs bus I/O.
+         * 
+         */
+        class FlashPlan
+        {
+        public:
+            /**
+             * @brief Size in bytes of a serialized plan.
+             * 
+             */
+            static const uint32_t SERIALIZED_SIZE = 16 + (PROGRAMMABLE_PAGES * 12) + 4;
+
+            FlashPlan();
+
+            /**
+             * @brief Builds the plan by computing the CRC of every
+             * padded page in the image.
+             * 
+             * @param firmwareImage firmware image data.
+             * @param imageSize size of the firmware image in bytes.
+             * @return true if the plan was built.
+             * @return false if the image does not fit the device.
+             */
+            bool Build(const uint8_t* firmwareImage, long imageSize);
+
+            /**
+             * @brief Starts building a plan page by page, for images
+             * that are streamed rather than held in memory. The plan
+             * is ready once AddPageCrc() has been called for every page.
+             * 
+             * @param imageSize size of the firmware image in bytes.
+             * @return true if the image fits the device.
+             * @return false otherwise.
+             */
+            bool Begin(long imageSize);
+
+            /**
+             * @brief Adds a page CRC that is already known, for example
+             * from a firmware container header, to a plan started with
+             * Begin().
+             * 
+             * @param pageIndex page index, less than PROGRAMMABLE_PAGES.
+             * @param crc final CRC of the padded page.
+             */
+            void AddPageCrc(uint32_t pageIndex, uint32_t crc);
+
+            /**
+             * @brief Records the CRC of the whole image, for a plan
+             * started with Begin().
+             * 
+             * @param imageDigest CRC of the image data.
+             */
+            void SetImageDigest(uint32_t imageDigest) {m_imageDigest = imageDigest;}
+
+            /**
+             * @brief Checks that the plan describes an image of the
+             * given size, without touching the image data. A plan
+             * read from disk also has to be checked against the image
+             * itself, see GetImageDigest().
+             * 
+             * @param imageSize size of the firmware image in bytes.
+             * @return true if the plan can be used for the image.
+             * @return false otherwise.
+             */
+            bool Validate(long imageSize) const;
+
+            /**
+             * @brief Writes the plan to a buffer in a portable little
+             * endian format.
+             * 
+             * @param buffer destination buffer.
+             * @param bufferSize size of buffer, at least SERIALIZED_SIZE.
+             * @return true if the plan was written.
+             * @return false otherwise.
+             */
+            bool Serialize(uint8_t* buffer, uint32_t bufferSize) const;
+
+            /**
+             * @brief Reads a plan written by Serialize().
+             * 
+             * @param buffer source buffer.
+             * @param bufferSize size of buffer.
+             * @return true if the buffer held an intact plan.
+             * @return false otherwise. The plan is left empty.
+             */
+            bool Deserialize(const uint8_t* buffer, uint32_t bufferSize);
+
+            /**
+             * @brief Gets the plan entry for a page.
+             * 
+             * @param pageIndex page index, less than PROGRAMMABLE_PAGES.
+             * @return const FlashPlanEntry& plan entry.
+             */
+            const FlashPlanEntry& GetEntry(uint32_t pageIndex) const {return m_entries[pageIndex];}
+
+            /**
+             * @brief Gets the size of the image this plan was built for.
+             * 
+             * @return uint32_t image size in bytes.
+             */
+            uint32_t GetImageSize() const {return m_imageSize;}
+
+            /**
+             * @brief Gets the CRC of the image this plan was built for.
+             * 
+             * @return uint32_t CRC of the image data.
+             */
+            uint32_t GetImageDigest() const {return m_imageDigest;}
+
+            /**
+             * @brief Gets a value that identifies the image this plan
+             * describes, derived from the image size and page CRCs.
+             * 
+             * @return uint32_t plan identity.
+             */
+            uint32_t GetIdentity() const;
+
+            /**
+             * @brief Checks if the plan has been built or deserialized.
+             * 
+             * @return true if the plan holds valid entries.
+             * @return false otherwise.
+             */
+            bool IsReady() const {return m_ready;}
+
+            /**
+             * @brief Empties the plan.
+             * 
+             */
+            void Clear();
+
+        private:
+            FlashPlanEntry m_entries[PROGRAMMABLE_PAGES];
+            uint32_t m_imageSize;
+            uint32_t m_imageDigest;
+            uint32_t m_pagesAdded;
+            bool m_ready;
+        };
+    } // XboxHDMI
+} // Conflux
+
+#endif // FLASHPLAN_H
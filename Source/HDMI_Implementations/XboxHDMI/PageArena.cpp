@@ -0,0 +1,53 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+#include "PageArena.h"
+
+namespace Conflux
+{
+    namespace XboxHDMI
+    {
+        PageArena::PageArena()
+        {
+            Clear();
+        }
+
+        uint8_t* PageArena::GetPage(uint32_t pageIndex)
+        {
+            uintptr_t firstPage = ((uintptr_t)m_storage + PAGE_ARENA_ALIGNMENT - 1) & ~(uintptr_t)(PAGE_ARENA_ALIGNMENT - 1);
+            return (uint8_t*)firstPage + (pageIndex * XBOX_HDMI_PAGE_SIZE);
+        }
+
+        void PageArena::MarkPrepared(uint32_t pageIndex, uint32_t pageCrc)
+        {
+            m_pageCrcs[pageIndex] = pageCrc;
+            m_pagePrepared[pageIndex] = true;
+        }
+
+        void PageArena::Discard(uint32_t pageIndex)
+        {
+            m_pagePrepared[pageIndex] = false;
+        }
+
+        void PageArena::Clear()
+        {
+            for(uint32_t pageIndex = 0; pageIndex < PROGRAMMABLE_PAGES; ++pageIndex)
+            {
+                m_pageCrcs[pageIndex] = 0;
+                m_pagePrepared[pageIndex] = false;
+            }
+        }
+    } // XboxHDMI
+} // Conflux
@@ -0,0 +1,101 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+#ifndef PAGEARENA_H
+#define PAGEARENA_H
+
+#include "XboxHDMI_Config.h"
+#include <stdint.h>
+
+namespace Conflux
+{
+    namespace XboxHDMI
+    {
+        /**
+         * @brief Storage for every page of a firmware image, already
+         * padded to XBOX_HDMI_PAGE_SIZE and aligned to a cache line,
+         * along with the CRC of each page. Pages are filled in lazily
+         * by whoever prepares them, so CRC and bus code only ever see
+         * whole fixed size pages.
+         * 
+         * The arena does no locking of its own, FirmwareImageReader
+         * guards it.
+         * 
+         */
+        class PageArena
+        {
+        public:
+            PageArena();
+
+            /**
+             * @brief Gets the storage of a page, to prepare it or to
+             * read it once prepared.
+             * 
+             * @param pageIndex page index, less than PROGRAMMABLE_PAGES.
+             * @return uint8_t* XBOX_HDMI_PAGE_SIZE bytes, aligned to
+             * PAGE_ARENA_ALIGNMENT.
+             */
+            uint8_t* GetPage(uint32_t pageIndex);
+
+            /**
+             * @brief Checks if a page has been prepared.
+             * 
+             * @param pageIndex page index, less than PROGRAMMABLE_PAGES.
+             * @return true if the page data and CRC can be used.
+             * @return false otherwise.
+             */
+            bool IsPrepared(uint32_t pageIndex) const {return m_pagePrepared[pageIndex];}
+
+            /**
+             * @brief Marks a page as prepared once its storage holds
+             * the padded page.
+             * 
+             * @param pageIndex page index, less than PROGRAMMABLE_PAGES.
+             * @param pageCrc CRC of the padded page.
+             */
+            void MarkPrepared(uint32_t pageIndex, uint32_t pageCrc);
+
+            /**
+             * @brief Gets the CRC of a prepared page.
+             * 
+             * @param pageIndex page index, less than PROGRAMMABLE_PAGES.
+             * @return uint32_t CRC of the padded page.
+             */
+            uint32_t GetPageCrc(uint32_t pageIndex) const {return m_pageCrcs[pageIndex];}
+
+            /**
+             * @brief Forgets a page so it is prepared again on next use.
+             * 
+             * @param pageIndex page index, less than PROGRAMMABLE_PAGES.
+             */
+            void Discard(uint32_t pageIndex);
+
+            /**
+             * @brief Forgets every page.
+             * 
+             */
+            void Clear();
+
+        private:
+            // Aligned by hand, heap allocations of the owner are not
+            // guaranteed to honour over-aligned members
+            uint8_t m_storage[(PROGRAMMABLE_PAGES * XBOX_HDMI_PAGE_SIZE) + PAGE_ARENA_ALIGNMENT];
+            uint32_t m_pageCrcs[PROGRAMMABLE_PAGES];
+            bool m_pagePrepared[PROGRAMMABLE_PAGES];
+        };
+    } // XboxHDMI
+} // Conflux
+
+#endif // PAGEARENA_H
@@ -0,0 +1,232 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "RegisterShadow.h"
+#include "XboxHDMI_Config.h"
+
+namespace Conflux
+{
+    namespace XboxHDMI
+    {
+        RegisterShadow::RegisterShadow(SmBusTransport* transport)
+        {
+            m_transport = transport;
+            m_bootModeKnown = false;
+            m_bootMode = BOOT_HDMI_INVALID;
+            for(unsigned int command = 0; command < 256; ++command)
+            {
+                m_shadowed[command] = false;
+                m_values[command] = 0;
+            }
+            ResetMetrics();
+        }
+
+        RegisterVolatility RegisterShadow::GetVolatility(uint8_t command)
+        {
+            return XboxHdmiRegisterMap::GetVolatility(command);
+        }
+
+        bool RegisterShadow::ReadByte(uint8_t address, uint8_t command, uint8_t* value)
+        {
+            if(LookUp(address, command, value))
+            {
+                return true;
+            }
+
+            bool readSuccessful = m_transport->ReadByte(address, command, value);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(!readSuccessful)
+            {
+                InvalidateLocked();
+            }
+            else if(address == I2C_HDMI_ADRESS)
+            {
+                Store(command, *value);
+            }
+
+            return readSuccessful;
+        }
+
+        bool RegisterShadow::WriteByte(uint8_t address, uint8_t command, uint8_t value)
+        {
+            bool writeSuccessful = m_transport->WriteByte(address, command, value);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(!writeSuccessful || (address == I2C_HDMI_ADRESS && command == I2C_LOAD_APP))
+            {
+                InvalidateLocked();
+            }
+            else if(address == I2C_HDMI_ADRESS && GetVolatility(command) == EEPROM_REGISTER)
+            {
+                m_shadowed[command] = true;
+                m_values[command] = value;
+            }
+
+            return writeSuccessful;
+        }
+
+        bool RegisterShadow::SupportsWordTransfers()
+        {
+            return m_transport->SupportsWordTransfers();
+        }
+
+        SmBusError RegisterShadow::GetLastBusError()
+        {
+            return m_transport->GetLastBusError();
+        }
+
+        bool RegisterShadow::ReadWord(uint8_t address, uint8_t command, uint16_t* value)
+        {
+            uint8_t highCommand = command + 1;
+            bool isDevice = (address == I2C_HDMI_ADRESS);
+            unsigned int shadowable = 0;
+            if(isDevice && GetVolatility(command) != VOLATILE_REGISTER)
+            {
+                ++shadowable;
+            }
+            if(isDevice && GetVolatility(highCommand) != VOLATILE_REGISTER)
+            {
+                ++shadowable;
+            }
+
+            {
+                // Both halves have to be shadowed, a partial hit still costs the transaction
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if(shadowable == 2 && m_shadowed[command] && m_shadowed[highCommand])
+                {
+                    m_metrics.hits += 2;
+                    *value = (uint16_t)(m_values[command] | (m_values[highCommand] << 8));
+                    return true;
+                }
+                m_metrics.misses += shadowable;
+                m_metrics.uncached += 2 - shadowable;
+            }
+
+            bool readSuccessful = m_transport->ReadWord(address, command, value);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(!readSuccessful)
+            {
+                InvalidateLocked();
+            }
+            else if(isDevice)
+            {
+                Store(command, (uint8_t)(*value & 0xFF));
+                Store(highCommand, (uint8_t)(*value >> 8));
+            }
+
+            return readSuccessful;
+        }
+
+        bool RegisterShadow::WriteWord(uint8_t address, uint8_t command, uint16_t value)
+        {
+            bool writeSuccessful = m_transport->WriteWord(address, command, value);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(!writeSuccessful || (address == I2C_HDMI_ADRESS &&
+                                    (command == I2C_LOAD_APP || command + 1 == I2C_LOAD_APP)))
+            {
+                InvalidateLocked();
+            }
+            else if(address == I2C_HDMI_ADRESS)
+            {
+                uint8_t bytes[2] = {(uint8_t)(value & 0xFF), (uint8_t)(value >> 8)};
+                for(uint8_t offset = 0; offset < 2; ++offset)
+                {
+                    uint8_t writtenCommand = command + offset;
+                    if(GetVolatility(writtenCommand) == EEPROM_REGISTER)
+                    {
+                        m_shadowed[writtenCommand] = true;
+                        m_values[writtenCommand] = bytes[offset];
+                    }
+                }
+            }
+
+            return writeSuccessful;
+        }
+
+        void RegisterShadow::Invalidate()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            InvalidateLocked();
+        }
+
+        void RegisterShadow::GetMetrics(RegisterShadowMetrics* metrics)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            *metrics = m_metrics;
+        }
+
+        void RegisterShadow::ResetMetrics()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_metrics.hits = 0;
+            m_metrics.misses = 0;
+            m_metrics.uncached = 0;
+            m_metrics.invalidations = 0;
+        }
+
+        bool RegisterShadow::LookUp(uint8_t address, uint8_t command, uint8_t* value)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(address != I2C_HDMI_ADRESS || GetVolatility(command) == VOLATILE_REGISTER)
+            {
+                ++m_metrics.uncached;
+                return false;
+            }
+
+            if(!m_shadowed[command])
+            {
+                ++m_metrics.misses;
+                return false;
+            }
+
+            ++m_metrics.hits;
+            *value = m_values[command];
+            return true;
+        }
+
+        void RegisterShadow::Store(uint8_t command, uint8_t value)
+        {
+            if(command == I2C_BOOT_MODE)
+            {
+                // Rebooted since the registers were shadowed
+                if(m_bootModeKnown && value != m_bootMode)
+                {
+                    InvalidateLocked();
+                }
+                m_bootModeKnown = true;
+                m_bootMode = value;
+            }
+            else if(GetVolatility(command) != VOLATILE_REGISTER)
+            {
+                m_shadowed[command] = true;
+                m_values[command] = value;
+            }
+        }
+
+        void RegisterShadow::InvalidateLocked()
+        {
+            for(unsigned int command = 0; command < 256; ++command)
+            {
+                m_shadowed[command] = false;
+            }
+            m_bootModeKnown = false;
+            ++m_metrics.invalidations;
+        }
+    } // XboxHDMI
+} // Conflux
@@ -0,0 +1,124 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef REGISTERSHADOW_H
+#define REGISTERSHADOW_H
+
+#include "SmBusTransport.h"
+#include "XboxHdmiRegisters.h"
+#include <stdint.h>
+#include <mutex>
+
+namespace Conflux
+{
+    namespace XboxHDMI
+    {
+        /**
+         * @brief Traffic served by a RegisterShadow.
+         * 
+         */
+        struct RegisterShadowMetrics
+        {
+            unsigned long long hits;            // Register reads answered from the shadow
+            unsigned long long misses;          // Shadowed registers that had to be read from the device
+            unsigned long long uncached;        // Volatile register reads, always on the bus
+            unsigned long long invalidations;   // Times the whole shadow was dropped
+        };
+
+        /**
+         * @brief Write-through cache of the XboxHDMI registers that
+         * can't change behind the library's back, placed in front of
+         * the SMBus transport. Everything is dropped when the device
+         * is told to reboot, when it is seen in a different boot mode,
+         * and when a transaction fails, since a resetting device drops
+         * off the bus.
+         * 
+         * Word transactions are assumed to cover two consecutive
+         * registers, so they should only be used once the device is
+         * known to step its register pointer.
+         * 
+         */
+        class RegisterShadow : public SmBusTransport
+        {
+        public:
+            /**
+             * @brief Construct a new RegisterShadow object.
+             * 
+             * @param transport transport the device is reached through.
+             */
+            RegisterShadow(SmBusTransport* transport);
+
+            bool ReadByte(uint8_t address, uint8_t command, uint8_t* value);
+            bool WriteByte(uint8_t address, uint8_t command, uint8_t value);
+            bool SupportsWordTransfers();
+            bool ReadWord(uint8_t address, uint8_t command, uint16_t* value);
+            bool WriteWord(uint8_t address, uint8_t command, uint16_t value);
+            SmBusError GetLastBusError();
+
+            /**
+             * @brief Gets the transport behind the shadow, for traffic
+             * that must not be cached.
+             * 
+             * @return SmBusTransport* transport given at construction.
+             */
+            SmBusTransport* GetTransport() {return m_transport;}
+
+            /**
+             * @brief Gets how long a register can be shadowed.
+             * 
+             * @param command XboxHDMI register.
+             * @return RegisterVolatility volatility of the register.
+             */
+            static RegisterVolatility GetVolatility(uint8_t command);
+
+            /**
+             * @brief Drops every shadowed register, for when the device
+             * may have changed without the shadow seeing it, such as
+             * booting into newly flashed firmware.
+             * 
+             */
+            void Invalidate();
+
+            /**
+             * @brief Gets the traffic served so far.
+             * 
+             * @param metrics filled out with the shadow metrics.
+             */
+            void GetMetrics(RegisterShadowMetrics* metrics);
+
+            /**
+             * @brief Clears the shadow metrics.
+             * 
+             */
+            void ResetMetrics();
+
+        private:
+            SmBusTransport* m_transport;
+            std::mutex m_mutex;
+            bool m_shadowed[256];
+            uint8_t m_values[256];
+            bool m_bootModeKnown;
+            uint8_t m_bootMode;
+            RegisterShadowMetrics m_metrics;
+
+            bool LookUp(uint8_t address, uint8_t command, uint8_t* value);
+            void Store(uint8_t command, uint8_t value);
+            void InvalidateLocked();
+        };
+    } // XboxHDMI
+} // Conflux
+
+#endif // REGISTERSHADOW_H
@@ -0,0 +1,343 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "SimulatedXboxHdmi.h"
+#include "Crc32.h"
+#include <string.h>
+
+namespace Conflux
+{
+    namespace XboxHDMI
+    {
+        SimulatedXboxHdmi::SimulatedXboxHdmi()
+        {
+            m_present = true;
+            m_lastError = SMBUS_OK;
+            m_faultError = SMBUS_OK;
+            m_faultInterval = 0;
+            m_faultCountdown = 0;
+            m_autoIncrement = true;
+            m_transactionLatencyUs = 0;
+            m_pageProgramLatencyMs = 0;
+            m_transactionCount = 0;
+            m_busyUntil = std::chrono::steady_clock::now();
+
+            memset(m_registers, 0, sizeof(m_registers));
+            memset(m_pageBuffer, 0, sizeof(m_pageBuffer));
+            memset(m_flash, 0xFF, sizeof(m_flash));
+            m_pagePosition = 0;
+            for(uint32_t pageIndex = 0; pageIndex < PROGRAMMABLE_PAGES; ++pageIndex)
+            {
+                m_pageFlashed[pageIndex] = false;
+            }
+
+            m_registers[I2C_BOOT_MODE] = BOOT_HDMI_FIRMWARE;
+            m_registers[I2C_FIRMWARE_VERSION + 0] = 1;
+        }
+
+        bool SimulatedXboxHdmi::ReadByte(uint8_t address, uint8_t command, uint8_t* value)
+        {
+            WaitTransactionLatency();
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(!BeginTransaction(address))
+            {
+                return false;
+            }
+
+            *value = ReadRegister(command);
+            ++m_transactionCount;
+            return true;
+        }
+
+        bool SimulatedXboxHdmi::WriteByte(uint8_t address, uint8_t command, uint8_t value)
+        {
+            WaitTransactionLatency();
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(!BeginTransaction(address))
+            {
+                return false;
+            }
+
+            if(!WriteRegister(command, value))
+            {
+                m_lastError = SMBUS_INVALID_REQUEST;
+                return false;
+            }
+
+            ++m_transactionCount;
+            return true;
+        }
+
+        bool SimulatedXboxHdmi::ReadWord(uint8_t address, uint8_t command, uint16_t* value)
+        {
+            WaitTransactionLatency();
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(!BeginTransaction(address))
+            {
+                return false;
+            }
+
+            uint8_t lowByte = ReadRegister(command);
+            uint8_t highByte = ReadRegister(m_autoIncrement ? (uint8_t)(command + 1) : command);
+            *value = (uint16_t)(lowByte | (highByte << 8));
+            ++m_transactionCount;
+            return true;
+        }
+
+        bool SimulatedXboxHdmi::WriteWord(uint8_t address, uint8_t command, uint16_t value)
+        {
+            WaitTransactionLatency();
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(!BeginTransaction(address))
+            {
+                return false;
+            }
+
+            if(!WriteRegister(command, (uint8_t)(value & 0xFF)) ||
+               !WriteRegister(m_autoIncrement ? (uint8_t)(command + 1) : command, (uint8_t)(value >> 8)))
+            {
+                m_lastError = SMBUS_INVALID_REQUEST;
+                return false;
+            }
+
+            ++m_transactionCount;
+            return true;
+        }
+
+        SmBusError SimulatedXboxHdmi::GetLastBusError()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_lastError;
+        }
+
+        void SimulatedXboxHdmi::SetRegisterAutoIncrement(bool autoIncrement)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_autoIncrement = autoIncrement;
+        }
+
+        void SimulatedXboxHdmi::SetPresent(bool present)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_present = present;
+        }
+
+        void SimulatedXboxHdmi::SetFaultInjection(SmBusError error, unsigned int interval)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_faultError = error;
+            m_faultInterval = interval;
+            m_faultCountdown = interval;
+        }
+
+        void SimulatedXboxHdmi::SetFirmwareVersion(uint8_t major, uint8_t minor, uint8_t patch)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_registers[I2C_FIRMWARE_VERSION + 0] = major;
+            m_registers[I2C_FIRMWARE_VERSION + 1] = minor;
+            m_registers[I2C_FIRMWARE_VERSION + 2] = patch;
+        }
+
+        void SimulatedXboxHdmi::SetTransactionLatencyUs(uint32_t latencyUs)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_transactionLatencyUs = latencyUs;
+        }
+
+        void SimulatedXboxHdmi::SetPageProgramLatencyMs(uint32_t latencyMs)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pageProgramLatencyMs = latencyMs;
+        }
+
+        bool SimulatedXboxHdmi::GetFlashedPage(uint32_t pageIndex, uint8_t* pageData)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(pageIndex >= PROGRAMMABLE_PAGES || !m_pageFlashed[pageIndex])
+            {
+                return false;
+            }
+
+            memcpy(pageData, m_flash + (pageIndex * XBOX_HDMI_PAGE_SIZE), XBOX_HDMI_PAGE_SIZE);
+            return true;
+        }
+
+        unsigned long long SimulatedXboxHdmi::GetTransactionCount()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_transactionCount;
+        }
+
+        void SimulatedXboxHdmi::WaitTransactionLatency()
+        {
+            uint32_t latencyUs;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                latencyUs = m_transactionLatencyUs;
+            }
+
+            // Spun rather than slept, sleeps are far coarser than a bus transaction
+            std::chrono::steady_clock::time_point until = std::chrono::steady_clock::now() +
+                                                          std::chrono::microseconds(latencyUs);
+            while(latencyUs > 0 && std::chrono::steady_clock::now() < until)
+            {
+            }
+        }
+
+        bool SimulatedXboxHdmi::BeginTransaction(uint8_t address)
+        {
+            if(!m_present || address != I2C_HDMI_ADRESS)
+            {
+                m_lastError = SMBUS_NAK;
+                return false;
+            }
+
+            if(m_faultInterval > 0 && --m_faultCountdown == 0)
+            {
+                m_faultCountdown = m_faultInterval;
+                m_lastError = m_faultError;
+                return false;
+            }
+
+            m_lastError = SMBUS_OK;
+            return true;
+        }
+
+        uint8_t SimulatedXboxHdmi::ReadRegister(uint8_t command)
+        {
+            switch(command)
+            {
+                case I2C_PROG_POS:
+                    return (uint8_t)(m_pagePosition & 0xFF);
+                case I2C_PROG_BUSY:
+                    return IsBusy() ? 1 : 0;
+                case I2C_PROG_FULL:
+                    // Pages are consumed as soon as they are complete
+                    return 0;
+                default:
+                    return m_registers[command];
+            }
+        }
+
+        bool SimulatedXboxHdmi::WriteRegister(uint8_t command, uint8_t value)
+        {
+            bool inBootRom = (m_registers[I2C_BOOT_MODE] == BOOT_HDMI_BOOTROM);
+            switch(command)
+            {
+                case I2C_LOAD_APP:
+                    LoadApp(value);
+                    return true;
+                case I2C_PROG_PAGE:
+                    if(!inBootRom)
+                    {
+                        return false;
+                    }
+                    m_registers[I2C_PROG_PAGE] = value;
+                    m_pagePosition = 0;
+                    return true;
+                case I2C_PROG_CRC0:
+                case I2C_PROG_CRC1:
+                case I2C_PROG_CRC2:
+                case I2C_PROG_CRC3:
+                    if(!inBootRom)
+                    {
+                        return false;
+                    }
+                    m_registers[command] = value;
+                    m_busyUntil = std::chrono::steady_clock::now() +
+                                  std::chrono::milliseconds(m_pageProgramLatencyMs);
+                    return true;
+                case I2C_PROG_DATA:
+                    if(!inBootRom)
+                    {
+                        return false;
+                    }
+                    m_pageBuffer[m_pagePosition++] = value;
+                    if(m_pagePosition == XBOX_HDMI_PAGE_SIZE)
+                    {
+                        CommitPage();
+                    }
+                    return true;
+                case I2C_EEPROM_SAVE:
+                case I2C_EEPROM_WIDESCREEN:
+                case I2C_EEPROM_MODE_OUT:
+                case I2C_EEPROM_ADJUST_LUMA:
+                case I2C_EEPROM_ADJUST_CB:
+                case I2C_EEPROM_ADJUST_CR:
+                    m_registers[command] = value;
+                    return true;
+                default:
+                    // Status and identification registers are read only
+                    return false;
+            }
+        }
+
+        void SimulatedXboxHdmi::LoadApp(uint8_t bootMode)
+        {
+            if(bootMode == BOOT_HDMI_PROGRAM || bootMode == BOOT_HDMI_BOOTROM)
+            {
+                // Resets into the boot rom, ready for page 0
+                m_registers[I2C_BOOT_MODE] = BOOT_HDMI_BOOTROM;
+                m_registers[I2C_PROG_PAGE] = 0;
+                m_registers[I2C_PROG_ERROR] = I2C_PROG_ERROR_NONE;
+                m_pagePosition = 0;
+            }
+            else
+            {
+                m_registers[I2C_BOOT_MODE] = BOOT_HDMI_FIRMWARE;
+            }
+        }
+
+        void SimulatedXboxHdmi::CommitPage()
+        {
+            uint32_t pageIndex = m_registers[I2C_PROG_PAGE];
+            uint32_t expectedCrc = ((uint32_t)m_registers[I2C_PROG_CRC3] << 24) |
+                                   ((uint32_t)m_registers[I2C_PROG_CRC2] << 16) |
+                                   ((uint32_t)m_registers[I2C_PROG_CRC1] << 8) |
+                                   ((uint32_t)m_registers[I2C_PROG_CRC0]);
+
+            m_pagePosition = 0;
+            m_busyUntil = std::chrono::steady_clock::now() +
+                          std::chrono::milliseconds(m_pageProgramLatencyMs);
+
+            if(pageIndex >= PROGRAMMABLE_PAGES)
+            {
+                m_registers[I2C_PROG_ERROR] = I2C_PROG_ERROR_WRITE;
+                return;
+            }
+
+            if(Crc32::Compute(m_pageBuffer, XBOX_HDMI_PAGE_SIZE) != expectedCrc)
+            {
+                m_registers[I2C_PROG_ERROR] = I2C_PROG_ERROR_CRC;
+                return;
+            }
+
+            memcpy(m_flash + (pageIndex * XBOX_HDMI_PAGE_SIZE), m_pageBuffer, XBOX_HDMI_PAGE_SIZE);
+            m_pageFlashed[pageIndex] = true;
+            m_registers[I2C_PROG_ERROR] = I2C_PROG_ERROR_NONE;
+            m_registers[I2C_PROG_PAGE] = (uint8_t)(pageIndex + 1);
+        }
+
+        bool SimulatedXboxHdmi::IsBusy()
+        {
+            return std::chrono::steady_clock::now() < m_busyUntil;
+        }
+    } // XboxHDMI
+} // Conflux
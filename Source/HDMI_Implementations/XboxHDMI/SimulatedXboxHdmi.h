@@ -0,0 +1,155 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef SIMULATEDXBOXHDMI_H
+#define SIMULATEDXBOXHDMI_H
+
+#include "SmBusTransport.h"
+#include "XboxHDMI_Config.h"
+#include <stdint.h>
+#include <chrono>
+#include <mutex>
+
+namespace Conflux
+{
+    namespace XboxHDMI
+    {
+        /**
+         * @brief In-process model of the XboxHDMI register file, used
+         * as the SMBus transport when the library runs on a development
+         * machine. It follows the boot modes, takes firmware pages
+         * through the programming registers, checks each page against
+         * the CRC written ahead of it, and keeps the settings registers.
+         * 
+         * Word transactions are understood. Transactions to any other
+         * address are not acknowledged, like an absent device, and
+         * writes the device would reject are refused outright.
+         * 
+         */
+        class SimulatedXboxHdmi : public SmBusTransport
+        {
+        public:
+            SimulatedXboxHdmi();
+
+            bool ReadByte(uint8_t address, uint8_t command, uint8_t* value);
+            bool WriteByte(uint8_t address, uint8_t command, uint8_t value);
+            bool SupportsWordTransfers() {return true;}
+            bool ReadWord(uint8_t address, uint8_t command, uint16_t* value);
+            bool WriteWord(uint8_t address, uint8_t command, uint16_t value);
+            SmBusError GetLastBusError();
+
+            /**
+             * @brief Sets whether the register pointer moves on within
+             * a word transaction. Without it, both bytes of a word land
+             * on the same register, like firmware that only expects
+             * byte transactions.
+             * 
+             * @param autoIncrement true by default.
+             */
+            void SetRegisterAutoIncrement(bool autoIncrement);
+
+            /**
+             * @brief Takes the device off the bus, or puts it back.
+             * 
+             * @param present false to fail every transaction.
+             */
+            void SetPresent(bool present);
+
+            /**
+             * @brief Fails every so many transactions before they reach
+             * the registers, to stand in for a noisy bus.
+             * 
+             * @param error why the transactions fail.
+             * @param interval one in this many transactions fails, 0 to
+             * stop injecting faults.
+             */
+            void SetFaultInjection(SmBusError error, unsigned int interval);
+
+            /**
+             * @brief Sets the version reported by the running firmware.
+             * 
+             * @param major major version.
+             * @param minor minor version.
+             * @param patch patch version.
+             */
+            void SetFirmwareVersion(uint8_t major, uint8_t minor, uint8_t patch);
+
+            /**
+             * @brief Makes every transaction take at least this long,
+             * to stand in for the speed of the real bus.
+             * 
+             * @param latencyUs time per transaction, 0 by default.
+             */
+            void SetTransactionLatencyUs(uint32_t latencyUs);
+
+            /**
+             * @brief Sets how long the device reports busy after a page
+             * CRC is written and after a page is committed.
+             * 
+             * @param latencyMs busy time, 0 by default.
+             */
+            void SetPageProgramLatencyMs(uint32_t latencyMs);
+
+            /**
+             * @brief Gets the contents of a page programmed into flash.
+             * 
+             * @param pageIndex page index, less than PROGRAMMABLE_PAGES.
+             * @param pageData XBOX_HDMI_PAGE_SIZE bytes filled out with
+             * the page.
+             * @return true if the page has been programmed.
+             * @return false otherwise.
+             */
+            bool GetFlashedPage(uint32_t pageIndex, uint8_t* pageData);
+
+            /**
+             * @brief Gets the number of transactions the device has
+             * acknowledged.
+             * 
+             * @return unsigned long long transaction count.
+             */
+            unsigned long long GetTransactionCount();
+
+        private:
+            std::mutex m_mutex;
+            bool m_present;
+            SmBusError m_lastError;
+            SmBusError m_faultError;
+            unsigned int m_faultInterval;
+            unsigned int m_faultCountdown;
+            bool m_autoIncrement;
+            uint32_t m_transactionLatencyUs;
+            uint32_t m_pageProgramLatencyMs;
+            unsigned long long m_transactionCount;
+            std::chrono::steady_clock::time_point m_busyUntil;
+
+            uint8_t m_registers[256];
+            uint8_t m_pageBuffer[XBOX_HDMI_PAGE_SIZE];
+            uint32_t m_pagePosition;
+            uint8_t m_flash[PROGRAMMABLE_PAGES * XBOX_HDMI_PAGE_SIZE];
+            bool m_pageFlashed[PROGRAMMABLE_PAGES];
+
+            void WaitTransactionLatency();
+            bool BeginTransaction(uint8_t address);
+            uint8_t ReadRegister(uint8_t command);
+            bool WriteRegister(uint8_t command, uint8_t value);
+            void LoadApp(uint8_t bootMode);
+            void CommitPage();
+            bool IsBusy();
+        };
+    } // XboxHDMI
+} // Conflux
+
+#endif // SIMULATEDXBOXHDMI_H
@@ -0,0 +1,196 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+#include "SmBusWorker.h"
+#include "XboxHDMI_Config.h"
+
+namespace Conflux
+{
+    namespace XboxHDMI
+    {
+        SmBusWorker::SmBusWorker()
+        {
+            m_stopWorker = false;
+            m_programming = false;
+            m_metrics.queueDepth = 0;
+            ResetMetrics();
+
+            m_workerThread = std::thread(&SmBusWorker::WorkerLoop, this);
+        }
+
+        SmBusWorker::~SmBusWorker()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stopWorker = true;
+            }
+            m_jobQueued.notify_all();
+            m_workerThread.join();
+        }
+
+        BusJobStatus SmBusWorker::Run(BusJobPriority priority, bool readOnly, const Job& job)
+        {
+            // Already on the bus, queueing would wait on ourselves
+            if(std::this_thread::get_id() == m_workerThread.get_id())
+            {
+                return job() ? JOB_COMPLETED : JOB_FAILED;
+            }
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+
+            if(m_stopWorker)
+            {
+                return JOB_WORKER_STOPPED;
+            }
+
+            if(m_programming && !readOnly && priority != FLASH_JOB)
+            {
+                ++m_metrics.jobsRejected;
+                return JOB_REJECTED_WHILE_PROGRAMMING;
+            }
+
+            PendingJob pendingJob;
+            pendingJob.job = &job;
+            pendingJob.priority = priority;
+            pendingJob.readOnly = readOnly;
+            pendingJob.submitted = std::chrono::steady_clock::now();
+            pendingJob.latencyTarget = pendingJob.submitted + std::chrono::milliseconds(SMBUS_QUERY_LATENCY_TARGET_MS);
+            pendingJob.status = JOB_WORKER_STOPPED;
+            pendingJob.done = false;
+
+            m_queues[priority].push_back(&pendingJob);
+            if(++m_metrics.queueDepth > m_metrics.maxQueueDepth)
+            {
+                m_metrics.maxQueueDepth = m_metrics.queueDepth;
+            }
+            m_jobQueued.notify_one();
+
+            m_jobDone.wait(lock, [&pendingJob]() {return pendingJob.done;});
+            return pendingJob.status;
+        }
+
+        void SmBusWorker::SetProgramming(bool programming)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_programming = programming;
+        }
+
+        void SmBusWorker::GetMetrics(SmBusWorkerMetrics* metrics)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            *metrics = m_metrics;
+        }
+
+        void SmBusWorker::ResetMetrics()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_metrics.maxQueueDepth = m_metrics.queueDepth;
+            m_metrics.jobsRejected = 0;
+            m_metrics.latencyTargetMisses = 0;
+            for(int priority = 0; priority < BUS_JOB_PRIORITY_COUNT; ++priority)
+            {
+                m_metrics.jobsRun[priority] = 0;
+                m_metrics.totalWaitUs[priority] = 0;
+                m_metrics.maxWaitUs[priority] = 0;
+            }
+        }
+
+        SmBusWorker::PendingJob* SmBusWorker::TakeNextJob()
+        {
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            int nextQueue = -1;
+
+            // Queues are in submission order, so only the oldest query
+            // of each priority can be the first to miss its target
+            for(int priority = FLASH_JOB + 1; priority < BUS_JOB_PRIORITY_COUNT && nextQueue == -1; ++priority)
+            {
+                if(!m_queues[priority].empty() && m_queues[priority].front()->readOnly &&
+                   m_queues[priority].front()->latencyTarget <= now)
+                {
+                    nextQueue = priority;
+                }
+            }
+
+            for(int priority = 0; priority < BUS_JOB_PRIORITY_COUNT && nextQueue == -1; ++priority)
+            {
+                if(!m_queues[priority].empty())
+                {
+                    nextQueue = priority;
+                }
+            }
+
+            if(nextQueue == -1)
+            {
+                return nullptr;
+            }
+
+            PendingJob* pendingJob = m_queues[nextQueue].front();
+            m_queues[nextQueue].pop_front();
+            --m_metrics.queueDepth;
+
+            uint64_t waitUs = std::chrono::duration_cast<std::chrono::microseconds>(now - pendingJob->submitted).count();
+            ++m_metrics.jobsRun[nextQueue];
+            m_metrics.totalWaitUs[nextQueue] += waitUs;
+            if(waitUs > m_metrics.maxWaitUs[nextQueue])
+            {
+                m_metrics.maxWaitUs[nextQueue] = waitUs;
+            }
+            if(pendingJob->readOnly && pendingJob->priority != FLASH_JOB && pendingJob->latencyTarget < now)
+            {
+                ++m_metrics.latencyTargetMisses;
+            }
+
+            return pendingJob;
+        }
+
+        void SmBusWorker::WorkerLoop()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+
+            while(true)
+            {
+                PendingJob* pendingJob = TakeNextJob();
+                if(pendingJob == nullptr)
+                {
+                    if(m_stopWorker)
+                    {
+                        break;
+                    }
+
+                    m_jobQueued.wait(lock);
+                    continue;
+                }
+
+                // A write queued just before programming started is as unsafe as one queued after
+                if(m_programming && !pendingJob->readOnly && pendingJob->priority != FLASH_JOB)
+                {
+                    ++m_metrics.jobsRejected;
+                    pendingJob->status = JOB_REJECTED_WHILE_PROGRAMMING;
+                }
+                else
+                {
+                    lock.unlock();
+                    bool jobSucceeded = (*pendingJob->job)();
+                    lock.lock();
+
+                    pendingJob->status = jobSucceeded ? JOB_COMPLETED : JOB_FAILED;
+                }
+
+                pendingJob->done = true;
+                m_jobDone.notify_all();
+            }
+        }
+    } // XboxHDMI
+} // Conflux
@@ -0,0 +1,155 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+#ifndef SMBUSWORKER_H
+#define SMBUSWORKER_H
+
+#include <stdint.h>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace Conflux
+{
+    namespace XboxHDMI
+    {
+        /**
+         * @brief Classes of bus work, served in this order.
+         * 
+         */
+        enum BusJobPriority
+        {
+            FLASH_JOB,          // Firmware update traffic
+            INTERACTIVE_JOB,    // Requests made by the application
+            BACKGROUND_JOB,     // Periodic status polls
+            BUS_JOB_PRIORITY_COUNT,
+        };
+
+        /**
+         * @brief Outcome of a job handed to the SmBusWorker.
+         * 
+         */
+        enum BusJobStatus
+        {
+            JOB_COMPLETED,                  // The job ran and succeeded
+            JOB_FAILED,                     // The job ran and reported a bus error
+            JOB_REJECTED_WHILE_PROGRAMMING, // Writes can't be made while the device is being flashed
+            JOB_WORKER_STOPPED,             // The worker is shutting down
+        };
+
+        /**
+         * @brief Counters describing the SmBusWorker queue. Wait times
+         * are measured from submission until the job starts running.
+         * 
+         */
+        struct SmBusWorkerMetrics
+        {
+            unsigned int queueDepth;        // Jobs waiting right now
+            unsigned int maxQueueDepth;
+            unsigned int jobsRejected;
+            unsigned int latencyTargetMisses;   // Read-only queries that started after their target
+            unsigned int jobsRun[BUS_JOB_PRIORITY_COUNT];
+            uint64_t totalWaitUs[BUS_JOB_PRIORITY_COUNT];
+            uint64_t maxWaitUs[BUS_JOB_PRIORITY_COUNT];
+        };
+
+        /**
+         * @brief Owns the SMBus. Every transaction with the device is
+         * wrapped in a job and run on the worker thread, one job at a
+         * time, so the firmware update thread and the application can
+         * no longer interleave transactions.
+         * 
+         * Jobs are served by priority, oldest first within a priority.
+         * Read-only queries carry a latency target, once it has passed
+         * they are served ahead of everything else. While the device
+         * is being programmed only flash jobs may write.
+         * 
+         */
+        class SmBusWorker
+        {
+        public:
+            /**
+             * @brief Bus work, returns false on a bus error.
+             * 
+             */
+            typedef std::function<bool()> Job;
+
+            SmBusWorker();
+            ~SmBusWorker();
+
+            /**
+             * @brief Runs a job on the worker thread and waits for it.
+             * Jobs run from inside another job are run straight away.
+             * 
+             * @param priority class of the job.
+             * @param readOnly true if the job only reads registers.
+             * @param job bus work to run.
+             * @return BusJobStatus outcome of the job.
+             */
+            BusJobStatus Run(BusJobPriority priority, bool readOnly, const Job& job);
+
+            /**
+             * @brief Marks the device as being programmed, or not.
+             * Writes that aren't flash jobs are rejected in between.
+             * 
+             * @param programming true once the device is switched to
+             * its bootloader for flashing, false when the update ends.
+             */
+            void SetProgramming(bool programming);
+
+            /**
+             * @brief Gets the queue metrics.
+             * 
+             * @param metrics filled out with the current metrics.
+             */
+            void GetMetrics(SmBusWorkerMetrics* metrics);
+
+            /**
+             * @brief Clears the counters, the current queue depth is kept.
+             * 
+             */
+            void ResetMetrics();
+
+        private:
+            struct PendingJob
+            {
+                const Job* job;
+                BusJobPriority priority;
+                bool readOnly;
+                std::chrono::steady_clock::time_point submitted;
+                std::chrono::steady_clock::time_point latencyTarget;
+                BusJobStatus status;
+                bool done;
+            };
+
+            std::thread m_workerThread;
+            std::mutex m_mutex;
+            std::condition_variable m_jobQueued;
+            std::condition_variable m_jobDone;
+            std::deque<PendingJob*> m_queues[BUS_JOB_PRIORITY_COUNT];
+            bool m_stopWorker;
+            bool m_programming;
+            SmBusWorkerMetrics m_metrics;
+
+            void WorkerLoop();
+            PendingJob* TakeNextJob();
+        };
+    } // XboxHDMI
+} // Conflux
+
+#endif // SMBUSWORKER_H
@@ -17,17 +17,65 @@ Copyright 2021 Chase Cobb
 #include "XboxHdmi.h"
 #include <chrono>
 #include <stdint.h>
-#include <xboxkrnl/xboxkrnl.h>
 #include "XboxHDMI_Config.h"
+#include "XboxHdmiRegisters.h"
 #include "VersionCode.h"
 #include "Strings.h"
+#include "Crc32.h"
+#include "FirmwareHeader.h"
+#include "FileSystem.h"
+
+#ifdef _XBOX
+#include <nxdk/mount.h>
+#endif
 
 namespace Conflux
 {
     namespace XboxHDMI
     {
-        XboxHdmi::XboxHdmi()
+        // An application only polling once the update is over still sees every event
+        static_assert(ProgressChannel::EVENT_QUEUE_CAPACITY >= FIRMWARE_UPDATE_EVENT_BUDGET,
+                      "a full firmware update doesn't fit in the event queue");
+
+        namespace
+        {
+            bool MountDrive(char driveLetter, const char* devicePath)
+            {
+#ifdef _XBOX
+                return nxIsDriveMounted(driveLetter) || nxMountDrive(driveLetter, devicePath);
+#else
+                // Drive letters only exist on the console
+                return false;
+#endif
+            }
+
+            bool MountHardDrive()
+            {
+                return MountDrive(HDD_DRIVE_LETTER, HDD_DRIVE_DEVICE_PATH);
+            }
+
+            bool MountDvdDrive()
+            {
+                return MountDrive(DVD_DRIVE_LETTER, DVD_DRIVE_DEVICE_PATH);
+            }
+
+            unsigned long long MicrosecondsSince(std::chrono::steady_clock::time_point start)
+            {
+                return std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::steady_clock::now() - start).count();
+            }
+        }
+
+        XboxHdmi::XboxHdmi(SmBusTransport* smBus)
+#ifdef CONFLUX_SMBUS_TRACE
+            : m_smBusTracer(smBus),
+              m_busPolicy(&m_smBusTracer),
+#else
+            : m_busPolicy(smBus),
+#endif
+              m_registerShadow(&m_busPolicy)
         {
+            m_smBus = &m_registerShadow;
             m_supportedFeatures = SupportedFeatures::CB_ADJUST | 
                                 SupportedFeatures::CR_ADJUST |
                                 SupportedFeatures::LUMA_ADJUST |
@@ -35,16 +83,41 @@ namespace Conflux
                                 SupportedFeatures::VIDEO_MODE_ADJUST;
             SetHardwareId(HdmiHardwareId::XBOXHDMI);
 
-            m_loadedFirmware = nullptr;
+            m_programmingWaitMode = ProgrammingWaitMode::ADAPTIVE;
+            m_busyStateReported = false;
+            m_learnedReadyLatencyMs[ProgrammingWaitPoint::AFTER_PAGE_CRC] = 0;
+            m_learnedReadyLatencyMs[ProgrammingWaitPoint::AFTER_PAGE_DATA] = 0;
+
+            m_firmwareUpdateRunning = false;
+            m_cancelRequested = false;
+            m_pauseRequested = false;
+
+            m_transferWidth = BYTE_TRANSFERS;
+            m_transferWidthKnown = false;
 
-            m_currentUpdateProcess = nullptr;
-            m_currentPercentComplete = nullptr;
-            m_currentErrorMessage = nullptr;
-            m_updateComplete = nullptr;
+            m_firmwareCatalog.AddSearchPath(UpdateSource::WORKING_DIRECTORY, DEFAULT_FIRMWARE_CONTAINER_WORKING_DIRECTORY);
+            m_firmwareCatalog.AddSearchPath(UpdateSource::WORKING_DIRECTORY, DEFAULT_FIRMWARE_WORKING_DIRECTORY);
+            for(const char* directory : DEFAULT_FIRMWARE_HDD_DIRECTORIES)
+            {
+                m_firmwareCatalog.AddSearchDirectory(UpdateSource::HDD, directory);
+            }
+            for(const char* directory : DEFAULT_FIRMWARE_DVD_DIRECTORIES)
+            {
+                m_firmwareCatalog.AddSearchDirectory(UpdateSource::DVD, directory);
+            }
+            m_firmwareCatalog.SetSourcePreparation(UpdateSource::HDD, MountHardDrive);
+            m_firmwareCatalog.SetSourcePreparation(UpdateSource::DVD, MountDvdDrive);
         }
 
         XboxHdmi::~XboxHdmi()
         {
+            // Stop at the next page rather than outlive the object
+            CancelFirmwareUpdate();
+            if(m_firmwareUpdateThread.joinable())
+            {
+                m_firmwareUpdateThread.join();
+            }
+
             ClearFeatureMap();
         }
 
@@ -52,16 +125,19 @@ namespace Conflux
         {            
             bool firmwareWasFound = false;
 
+            if(firmwareFilePath == nullptr)
+            {
+                firmwareFilePath = "";
+            }
+
             switch (updateSource)
             {
                 case UpdateSource::HDD:
-                {
-                    // TODO
-                    break;
-                }
                 case UpdateSource::DVD:
+                case UpdateSource::WORKING_DIRECTORY:
                 {
-                    // TODO
+                    // Answered from memory, files are only checked once the catalog expires
+                    firmwareWasFound = m_firmwareCatalog.IsUpdateAvailable(updateSource, firmwareFilePath);
                     break;
                 }
                 case UpdateSource::INTERNET:
@@ -69,18 +145,6 @@ namespace Conflux
                     // TODO
                     break;
                 }
-                case UpdateSource::WORKING_DIRECTORY:
-                {
-                    FILE* firmwareFile= fopen(DEFAULT_FIRMWARE_WORKING_DIRECTORY,
-                                              DEFAULT_FIRMWARE_WORKING_DIRECTORY_OPEN_MODE);
-
-                    if(firmwareFile)
-                    {
-                        fclose(firmwareFile);
-                        firmwareWasFound = true;
-                    }
-                    break;
-                }
                 default:
                     break;
             }
@@ -88,27 +152,84 @@ namespace Conflux
             return firmwareWasFound;
         }
 
+        void XboxHdmi::RefreshFirmwareSources()
+        {
+            m_firmwareCatalog.Refresh();
+        }
+
+        void XboxHdmi::AddFirmwareSearchDirectory(UpdateSource updateSource, const char* directoryPath)
+        {
+            m_firmwareCatalog.AddSearchDirectory(updateSource, directoryPath);
+        }
+
         bool XboxHdmi::UpdateFirmware(UpdateSource updateSource, void (*currentProcess)(const char* currentProcess)
                                                                , void (*percentComplete)(int percentageComplete)
                                                                , void (*errorMessage)(const char* errorMessage)
                                                                , void (*updateComplete)(bool flashSuccessful)
                                                                , const char* pathToFirmware)
         {
-            m_currentUpdateProcess = currentProcess;
-            m_currentPercentComplete = percentComplete;
-            m_currentErrorMessage = errorMessage;
-            m_updateComplete = updateComplete;
+            // Never block the caller behind a flash that is still running
+            if(m_firmwareUpdateRunning)
+            {
+                return false;
+            }
+
+            // The update thread can't join itself, so callbacks can't start an update
+            if(m_firmwareUpdateThread.get_id() == std::this_thread::get_id())
+            {
+                return false;
+            }
 
+            // A finished update thread only has to return
             if(m_firmwareUpdateThread.joinable())
             {
                 m_firmwareUpdateThread.join();
             }
 
+            {
+                std::lock_guard<std::mutex> lock(m_updateControlMutex);
+                m_cancelRequested = false;
+                m_pauseRequested = false;
+            }
+            m_firmwareUpdateRunning = true;
+            m_updateOptions = m_firmwareUpdateOptions;
+
+            m_firmwareUpdateProgress.Begin(currentProcess, percentComplete, errorMessage, updateComplete,
+                                           m_updateOptions.maxProgressCallbacksPerSecond);
+
+            m_pathToFirmware = (pathToFirmware != nullptr) ? pathToFirmware : "";
+
             m_firmwareUpdateThread = std::thread(&XboxHdmi::StartFirmwareUpdateProcess, this, updateSource);
 
             return m_firmwareUpdateThread.joinable();
         }
 
+        bool XboxHdmi::CancelFirmwareUpdate()
+        {
+            std::lock_guard<std::mutex> lock(m_updateControlMutex);
+            m_cancelRequested = true;
+            m_updateControlCondition.notify_all();
+
+            return m_firmwareUpdateRunning;
+        }
+
+        bool XboxHdmi::PauseFirmwareUpdate()
+        {
+            std::lock_guard<std::mutex> lock(m_updateControlMutex);
+            m_pauseRequested = true;
+
+            return m_firmwareUpdateRunning;
+        }
+
+        bool XboxHdmi::ResumeFirmwareUpdate()
+        {
+            std::lock_guard<std::mutex> lock(m_updateControlMutex);
+            m_pauseRequested = false;
+            m_updateControlCondition.notify_all();
+
+            return m_firmwareUpdateRunning;
+        }
+
         bool XboxHdmi::IsFeatureSupported(SupportedFeatures feature)
         {
             return ((m_supportedFeatures & feature) != 0);
@@ -116,16 +237,16 @@ namespace Conflux
 
         bool XboxHdmi::GetFirmwareVersion(VersionCode* versionCode)
         {
-            ULONG smbusRead;
+            uint32_t smbusRead = 0;
             uint8_t major, minor, patch;
 
-            if(HalReadSMBusValue(I2C_HDMI_ADRESS, I2C_FIRMWARE_VERSION + 0, false, &smbusRead) == 0) {
-                major = (uint8_t)smbusRead;
+            bool readSuccessful = RunBusJob(INTERACTIVE_JOB, true, [this, &smbusRead]() {
+                return ReadRegister<FirmwareVersionRegister>(m_smBus, &smbusRead, GetTransferWidth());
+            });
 
-                HalReadSMBusValue(I2C_HDMI_ADRESS, I2C_FIRMWARE_VERSION + 1, false, &smbusRead);
-                minor = (uint8_t)smbusRead;
-
-                HalReadSMBusValue(I2C_HDMI_ADRESS, I2C_FIRMWARE_VERSION + 2, false, &smbusRead);
+            if(readSuccessful) {
+                major = (uint8_t)(smbusRead >> 16);
+                minor = (uint8_t)(smbusRead >> 8);
                 patch = (uint8_t)smbusRead;
 
                 // Firmware 1.0.0 will incorrectly report 0.0.0, so let's fix that.
@@ -146,60 +267,31 @@ namespace Conflux
 
         bool XboxHdmi::LoadConfig()
         {
-            ULONG widescreenMode;
-            ULONG videoOutMode;
-            ULONG lumaSetting = 0;
-            ULONG cbSetting = 0;
-            ULONG crSetting = 0;
-
-            // If one read fails it will cause all to fail
-            bool readSuccessful = true;
+            // Widescreen, video out, luma, Cb and Cr, in register order
+            uint8_t settings[EepromSettingsRegisters::width] = {0, 0, 0, 0, 0};
 
-            readSuccessful = (HalReadSMBusValue(I2C_HDMI_ADRESS, I2C_EEPROM_WIDESCREEN, false,
-                                &widescreenMode) == 0);
-
-            if(readSuccessful)
-            {
-            readSuccessful = (HalReadSMBusValue(I2C_HDMI_ADRESS, I2C_EEPROM_MODE_OUT, false,
-                                &videoOutMode) == 0);
-            }
-
-            if(readSuccessful)
-            {
-            readSuccessful = (HalReadSMBusValue(I2C_HDMI_ADRESS, I2C_EEPROM_ADJUST_LUMA, false,
-                                &lumaSetting) == 0);
-            }
-            
-            if(readSuccessful)
-            {
-            readSuccessful = (HalReadSMBusValue(I2C_HDMI_ADRESS, I2C_EEPROM_ADJUST_CB, false,
-                                &cbSetting) == 0);
-            }
-            
-            if(readSuccessful)
-            {
-            readSuccessful = (HalReadSMBusValue(I2C_HDMI_ADRESS, I2C_EEPROM_ADJUST_CR, false,
-                                &crSetting) == 0);
-            }
+            bool readSuccessful = RunBusJob(INTERACTIVE_JOB, true, [this, &settings]() {
+                return ReadRegisterBytes<EepromSettingsRegisters>(m_smBus, settings, GetTransferWidth());
+            });
 
             if(readSuccessful)
             {
                 //Don't  allocate new RangedIntValue if they already exist in the map!!
                 ClearFeatureMap();
 
-                RangedIntValue* widescreenValue = new RangedIntValue((int8_t)widescreenMode, 0, 2, FEATURE_WIDESCREEN_ADJUST);
+                RangedIntValue* widescreenValue = new RangedIntValue((int8_t)settings[0], 0, 2, FEATURE_WIDESCREEN_ADJUST);
                 m_featureValues[SupportedFeatures::WIDESCREEN_ADJUST] = widescreenValue;
                 
-                RangedIntValue* videoOutValue = new RangedIntValue((int8_t)videoOutMode, 0, 1, FEATURE_VIDEO_MODE_ADJUST);
+                RangedIntValue* videoOutValue = new RangedIntValue((int8_t)settings[1], 0, 1, FEATURE_VIDEO_MODE_ADJUST);
                 m_featureValues[SupportedFeatures::VIDEO_MODE_ADJUST] = videoOutValue;
                 
-                RangedIntValue* lumaValue = new RangedIntValue((int8_t)lumaSetting, -12, 12, FEATURE_LUMA_ADJUST);
+                RangedIntValue* lumaValue = new RangedIntValue((int8_t)settings[2], -12, 12, FEATURE_LUMA_ADJUST);
                 m_featureValues[SupportedFeatures::LUMA_ADJUST] = lumaValue;
                 
-                RangedIntValue* cbValue = new RangedIntValue((int8_t)cbSetting, -12, 12, FEATURE_CB_ADJUST);
+                RangedIntValue* cbValue = new RangedIntValue((int8_t)settings[3], -12, 12, FEATURE_CB_ADJUST);
                 m_featureValues[SupportedFeatures::CB_ADJUST] = cbValue;
                 
-                RangedIntValue* crValue = new RangedIntValue((int8_t)crSetting, -12, 12, FEATURE_CR_ADJUST);
+                RangedIntValue* crValue = new RangedIntValue((int8_t)settings[4], -12, 12, FEATURE_CR_ADJUST);
                 m_featureValues[SupportedFeatures::CR_ADJUST] = crValue;
             }
 
@@ -208,72 +300,117 @@ namespace Conflux
 
         bool XboxHdmi::UpdateConfigValues()
         {
-            bool writeSuccessful = true;
+            // Taken on the calling thread, the job only touches the bus
+            uint8_t settings[EepromSettingsRegisters::width];
+            settings[0] = (uint8_t)m_featureValues[SupportedFeatures::WIDESCREEN_ADJUST]->GetValue();
+            settings[1] = (uint8_t)m_featureValues[SupportedFeatures::VIDEO_MODE_ADJUST]->GetValue();
+            settings[2] = (uint8_t)m_featureValues[SupportedFeatures::LUMA_ADJUST]->GetValue();
+            settings[3] = (uint8_t)m_featureValues[SupportedFeatures::CB_ADJUST]->GetValue();
+            settings[4] = (uint8_t)m_featureValues[SupportedFeatures::CR_ADJUST]->GetValue();
+
+            // Rejected while the device is being programmed
+            return RunBusJob(INTERACTIVE_JOB, false, [this, &settings]() {
+                return WriteRegisterBytes<EepromSettingsRegisters>(m_smBus, settings, GetTransferWidth());
+            });
+        }
 
-            writeSuccessful = (HalWriteSMBusValue(I2C_HDMI_ADRESS, I2C_EEPROM_WIDESCREEN, 0,
-                        (ULONG)m_featureValues[SupportedFeatures::WIDESCREEN_ADJUST]->GetValue()) == 0);
+        bool XboxHdmi::SaveConfig()
+        {
+            return RunBusJob(INTERACTIVE_JOB, false, [this]() {
+                return WriteRegister<EepromSaveRegister>(m_smBus, 0xFF);
+            });
+        }
 
-            if(writeSuccessful)
-            {
-                writeSuccessful = (HalWriteSMBusValue(I2C_HDMI_ADRESS, I2C_EEPROM_MODE_OUT, 0,
-                        (ULONG)m_featureValues[SupportedFeatures::VIDEO_MODE_ADJUST]->GetValue()) == 0);
-            }
-            if(writeSuccessful)
-            {
-                writeSuccessful = (HalWriteSMBusValue(I2C_HDMI_ADRESS, I2C_EEPROM_ADJUST_LUMA, 0,
-                        (ULONG)m_featureValues[SupportedFeatures::LUMA_ADJUST]->GetValue()) == 0);
-            }
-            if(writeSuccessful)
-            {
-                writeSuccessful = (HalWriteSMBusValue(I2C_HDMI_ADRESS, I2C_EEPROM_ADJUST_CB, 0,
-                        (ULONG)m_featureValues[SupportedFeatures::CB_ADJUST]->GetValue()) == 0);
-            }
-            if(writeSuccessful)
-            {
-                writeSuccessful = (HalWriteSMBusValue(I2C_HDMI_ADRESS, I2C_EEPROM_ADJUST_CR, 0,
-                        (ULONG)m_featureValues[SupportedFeatures::CR_ADJUST]->GetValue()) == 0);
-            }
+        void XboxHdmi::GetBusMetrics(SmBusWorkerMetrics* metrics)
+        {
+            m_smBusWorker.GetMetrics(metrics);
+        }
 
-            return writeSuccessful;
+        void XboxHdmi::GetRegisterShadowMetrics(RegisterShadowMetrics* metrics)
+        {
+            m_registerShadow.GetMetrics(metrics);
         }
 
-        bool XboxHdmi::SaveConfig()
+        void XboxHdmi::GetBusErrorCounters(BusErrorCounters* counters)
         {
-            return HalWriteSMBusValue(I2C_HDMI_ADRESS, I2C_EEPROM_SAVE, 0, (ULONG)0xFF) == 0;
+            m_busPolicy.GetErrorTotals(counters);
         }
 
-        bool XboxHdmi::GetFirmwareCompileTime(time_t* compileTime)
+        void XboxHdmi::GetRegisterErrorCounters(uint8_t command, BusErrorCounters* counters)
+        {
+            m_busPolicy.GetErrorCounters(command, counters);
+        }
+
+        bool XboxHdmi::DumpBusTrace(const char* path)
         {
-            bool readSuccessful = true;
-            ULONG compileTimeRaw[4];
+#ifdef CONFLUX_SMBUS_TRACE
+            return m_smBusTracer.Dump(path);
+#else
+            (void)path;
+            return false;
+#endif
+        }
 
-            readSuccessful = HalReadSMBusValue(I2C_HDMI_ADRESS, I2C_COMPILE_TIME0, false,
-                        &compileTimeRaw[0]) == 0;
+        bool XboxHdmi::RunBusJob(BusJobPriority priority, bool readOnly, const SmBusWorker::Job& job)
+        {
+            return m_smBusWorker.Run(priority, readOnly, job) == JOB_COMPLETED;
+        }
 
-            if(readSuccessful)
+        SmBusTransferWidth XboxHdmi::GetTransferWidth()
+        {
+            if(m_transferWidthKnown)
             {
-            readSuccessful = HalReadSMBusValue(I2C_HDMI_ADRESS, I2C_COMPILE_TIME1, false,
-                                &compileTimeRaw[1]) == 0;
+                return m_transferWidth;
             }
-            
-            if(readSuccessful)
+
+            // Straight to the device, a failed probe must not leave guesses in the shadow
+            SmBusTransport* transport = m_registerShadow.GetTransport();
+            m_transferWidth = BYTE_TRANSFERS;
+            if(!transport->SupportsWordTransfers())
             {
-            readSuccessful = HalReadSMBusValue(I2C_HDMI_ADRESS, I2C_COMPILE_TIME2, false,
-                                &compileTimeRaw[2]) == 0;
+                m_transferWidthKnown = true;
+                return m_transferWidth;
             }
 
-            if(readSuccessful)
+            // The version registers overlap by one between these two words. A device
+            // that doesn't step its register pointer can only pass when the registers
+            // hold the same value, or the filler a non-incrementing device sends.
+            uint16_t firstWord;
+            uint16_t secondWord;
+            if(transport->ReadWord(I2C_HDMI_ADRESS, I2C_FIRMWARE_VERSION, &firstWord) &&
+               transport->ReadWord(I2C_HDMI_ADRESS, I2C_FIRMWARE_VERSION + 1, &secondWord))
+            {
+                uint8_t sharedRegister = (uint8_t)(secondWord & 0xFF);
+                if((firstWord >> 8) == sharedRegister && (firstWord & 0xFF) != sharedRegister &&
+                   sharedRegister != 0x00 && sharedRegister != 0xFF)
+                {
+                    m_transferWidth = WORD_TRANSFERS;
+                }
+
+                // Inconclusive settles on bytes too
+                m_transferWidthKnown = true;
+            }
+            else
             {
-            readSuccessful = HalReadSMBusValue(I2C_HDMI_ADRESS, I2C_COMPILE_TIME3, false,
-                                &compileTimeRaw[3]) == 0;
+                // Refused words if it still answers bytes, otherwise it is resetting and is asked again
+                uint8_t bootMode;
+                m_transferWidthKnown = transport->ReadByte(I2C_HDMI_ADRESS, I2C_BOOT_MODE, &bootMode);
             }
 
+            return m_transferWidth;
+        }
+
+        bool XboxHdmi::GetFirmwareCompileTime(time_t* compileTime)
+        {
+            uint32_t compileTimeRaw;
+
+            bool readSuccessful = RunBusJob(FLASH_JOB, true, [this, &compileTimeRaw]() {
+                return ReadRegister<CompileTimeRegister>(m_smBus, &compileTimeRaw, GetTransferWidth());
+            });
+
             if(readSuccessful)
             {
-                *compileTime = (compileTimeRaw[0] << 24) +
-                               (compileTimeRaw[1] << 16) +
-                               (compileTimeRaw[2] << 8) + 
-                               (compileTimeRaw[3]);
+                *compileTime = (time_t)compileTimeRaw;
             }
 
             return readSuccessful;
@@ -281,10 +418,11 @@ namespace Conflux
 
         bool XboxHdmi::GetBootMode(BootMode* mode)
         {
-            ULONG currentBootMode;
+            uint8_t currentBootMode;
             bool readSuccessful;
-            readSuccessful = HalReadSMBusValue(I2C_HDMI_ADRESS, I2C_BOOT_MODE, 
-                                               false, &currentBootMode) == 0;
+            readSuccessful = RunBusJob(FLASH_JOB, true, [this, &currentBootMode]() {
+                return ReadRegister<BootModeRegister>(m_smBus, &currentBootMode);
+            });
 
             if(readSuccessful)
             {
@@ -309,48 +447,147 @@ namespace Conflux
             return readSuccessful;
         }
 
+        bool XboxHdmi::WaitForBootMode(BootMode targetMode, std::chrono::steady_clock::time_point deadline)
+        {
+            while(true)
+            {
+                BootMode currentMode;
+                if(GetBootMode(&currentMode) && currentMode == targetMode)
+                {
+                    return true;
+                }
+
+                // The device drops off the bus while it resets, so
+                // failed reads are retried until the deadline
+                if(std::chrono::steady_clock::now() >= deadline)
+                {
+                    return false;
+                }
+
+                std::this_thread::sleep_for(std::chrono::milliseconds(BOOT_MODE_POLL_INTERVAL_MS));
+            }
+        }
+
         void XboxHdmi::StartFirmwareUpdateProcess(UpdateSource updateSource)
         {
             BootMode bootMode;
-            ULONG errorStatus;
-            uint8_t* loadedFirmware = nullptr;
-            long firmwareFileSize;
-            int sleepBetweenOpsInSeconds = 2;
-            bool flashWasSuccessful = true;
 
-            m_currentErrorMessage("None");
+            m_firmwareUpdateReport.Reset(PROGRAMMABLE_PAGES);
 
             // Load Firmware
-            m_currentUpdateProcess(PROG_PROCESS_LOADING_FIRMWARE);
-            if(!LoadFirmwareImage(updateSource, loadedFirmware, &firmwareFileSize))
+            m_firmwareUpdateProgress.SetPhase(PROG_PROCESS_LOADING_FIRMWARE);
+            if(!OpenFirmwareImage(updateSource, m_pathToFirmware.c_str()))
             {
-                m_currentErrorMessage(PROG_ERROR_FAILED_TO_LOAD_FIRMWARE);
-                m_updateComplete(false); // Early out
+                m_firmwareUpdateProgress.ReportError(PROG_ERROR_FAILED_TO_LOAD_FIRMWARE);
+                FinishFirmwareUpdate(false); // Early out
+                return;
+            }
+
+            if(m_firmwareImage.IsContainer() &&
+               m_firmwareImage.GetHeader().GetHardwareId() != HdmiHardwareId::XBOXHDMI)
+            {
+                m_firmwareImage.Close();
+                m_firmwareUpdateProgress.ReportError(PROG_ERROR_FIRMWARE_WRONG_HARDWARE);
+                FinishFirmwareUpdate(false); // Early out
+                return;
+            }
+
+            // Reject images that can't fit before reading any of them
+            uint32_t firmwareFileSize = m_firmwareImage.GetImageSize();
+            if(firmwareFileSize == 0 || firmwareFileSize > PROGRAMMABLE_PAGES * XBOX_HDMI_PAGE_SIZE)
+            {
+                m_firmwareImage.Close();
+                m_firmwareUpdateProgress.ReportError(PROG_ERROR_FIRMWARE_IMAGE_SIZE);
+                FinishFirmwareUpdate(false); // Early out
+                return;
+            }
+
+            // Page CRCs are computed once here so the flash loop only does bus I/O
+            m_firmwareUpdateProgress.SetPhase(PROG_PROCESS_BUILDING_FLASH_PLAN);
+            if(!LoadFlashPlan(firmwareFileSize))
+            {
+                m_firmwareImage.Close();
+                m_firmwareUpdateProgress.ReportError(m_firmwareImage.IsContainer() ? PROG_ERROR_FIRMWARE_CORRUPT :
+                                                                                     PROG_ERROR_FAILED_TO_BUILD_FLASH_PLAN);
+                FinishFirmwareUpdate(false); // Early out
+                return;
             }
-            std::this_thread::sleep_for (std::chrono::seconds(sleepBetweenOpsInSeconds));
 
             // Output the firmware file size
             std::string firmwareSizeToString = PROG_PROCESS_FIRMWARE_FILE_SIZE;
             firmwareSizeToString.append(std::to_string(firmwareFileSize));
-            m_currentUpdateProcess(firmwareSizeToString.c_str());
-            std::this_thread::sleep_for (std::chrono::seconds(sleepBetweenOpsInSeconds));
+            m_firmwareUpdateProgress.SetPhase(firmwareSizeToString.c_str());
 
             // Output firmware loaded!
-            m_currentUpdateProcess(PROG_PROCESS_LOADED_FIRMWARE);
-            std::this_thread::sleep_for (std::chrono::seconds(sleepBetweenOpsInSeconds));
+            m_firmwareUpdateProgress.SetPhase(PROG_PROCESS_LOADED_FIRMWARE);
+
+            // Work out which pages differ from what is already on the device
+            bool pagesToFlash[PROGRAMMABLE_PAGES];
+            uint32_t pagesToWrite = SelectPagesToFlash(pagesToFlash);
+
+            // Pages an interrupted update of this image already verified are not written again
+            if(!m_updateOptions.resumeFromCheckpoint)
+            {
+                m_flashCheckpoint.Clear();
+            }
+            if(m_updateOptions.recoverFromJournal)
+            {
+                RestoreCheckpointFromJournal();
+            }
+            uint32_t planIdentity = m_flashPlan.GetIdentity();
+            uint32_t resumePage = m_flashCheckpoint.GetResumePage(planIdentity);
+            m_flashCheckpoint.Begin(planIdentity);
+            for(uint32_t pageIndex = 0; pageIndex < resumePage; ++pageIndex)
+            {
+                if(pagesToFlash[pageIndex])
+                {
+                    pagesToFlash[pageIndex] = false;
+                    --pagesToWrite;
+                }
+            }
+            m_firmwareUpdateReport.resumedFromPage = resumePage;
+            if(resumePage > 0)
+            {
+                std::string resumeMessage = PROG_RESUMING_FROM_CHECKPOINT;
+                resumeMessage.append(std::to_string(resumePage));
+                m_firmwareUpdateProgress.SetPhase(resumeMessage.c_str());
+            }
+
+            bool isIncrementalFlash = pagesToWrite < PROGRAMMABLE_PAGES;
+            m_firmwareUpdateReport.pagesSkipped = PROGRAMMABLE_PAGES - pagesToWrite;
+            if(pagesToWrite == 0)
+            {
+                m_firmwareImage.Close();
+                m_firmwareUpdateReport.updateSuccessful = true;
+                m_firmwareUpdateProgress.SetPhase(PROG_FIRMWARE_ALREADY_CURRENT);
+                FinishFirmwareUpdate(true); // Early out
+                return;
+            }
             
+            // Last chance to stop before the device is touched
+            if(!WaitAtPageBoundary())
+            {
+                m_firmwareImage.Close();
+                m_firmwareUpdateReport.updateCancelled = true;
+                m_firmwareUpdateProgress.ReportError(PROG_ERROR_UPDATE_CANCELLED);
+                FinishFirmwareUpdate(false); // Early out
+                return;
+            }
+
             // Switch to bootloader
-            m_currentUpdateProcess(PROG_CHECKING_BOOT_MODE);
+            m_firmwareUpdateProgress.SetPhase(PROG_CHECKING_BOOT_MODE);
             if(!GetBootMode(&bootMode))
             {
-                m_currentErrorMessage(PROG_ERROR_UNABLE_TO_GET_BOOT_MODE);
-                m_updateComplete(false); // Early out
+                m_firmwareImage.Close();
+                m_firmwareUpdateProgress.ReportError(PROG_ERROR_UNABLE_TO_GET_BOOT_MODE);
+                FinishFirmwareUpdate(false); // Early out
+                return;
             }
             else
             {
                 if(bootMode == BootMode::HDMI_PROGRAM)
                 {
-                    m_currentUpdateProcess(BOOT_MODE_HDMI_PROGRAM);
+                    m_firmwareUpdateProgress.SetPhase(BOOT_MODE_HDMI_PROGRAM);
                 }
                 else if(bootMode == BootMode::BOOTROM)
                 {
@@ -359,312 +596,772 @@ namespace Conflux
                     // because the bootrom is loaded by swapping to the
                     // HDMI_PROGRAM boot mode to make sure the full order of
                     // operations is followed
-                    m_currentUpdateProcess(BOOT_MODE_HDMI_BOOTROM);
+                    m_firmwareUpdateProgress.SetPhase(BOOT_MODE_HDMI_BOOTROM);
                 }
                 else if(bootMode == BootMode::HDMI_FIRMWARE)
                 {
-                    m_currentUpdateProcess(BOOT_MODE_HDMI_FIRMWARE);
+                    m_firmwareUpdateProgress.SetPhase(BOOT_MODE_HDMI_FIRMWARE);
                 }
                 else if(bootMode == BootMode::INVALID)
                 {
-                    m_currentUpdateProcess(BOOT_MODE_HDMI_INVALID);
+                    m_firmwareUpdateProgress.SetPhase(BOOT_MODE_HDMI_INVALID);
                 }
             }
-            std::this_thread::sleep_for (std::chrono::seconds(sleepBetweenOpsInSeconds));
-            
+
+            // Only flash traffic may write to the device from here on
+            m_smBusWorker.SetProgramming(true);
+
             // XboxHDMI actually expects this to switch to bootrom
             // and not to switch to the bootrom directly
             if(!SwitchBootMode(BootMode::HDMI_PROGRAM))
             {
-                m_currentErrorMessage(PROG_ERROR_UNABLE_TO_SIGNAL_BOOT_MODE);
-                m_updateComplete(false); // Early out
+                m_firmwareImage.Close();
+                m_firmwareUpdateProgress.ReportError(PROG_ERROR_UNABLE_TO_SIGNAL_BOOT_MODE);
+                FinishFirmwareUpdate(false); // Early out
+                return;
             }
+
             // Waiting for boot rom
-            m_currentUpdateProcess(PROG_WAITING_FOR_BOOTROM);
-            std::this_thread::sleep_for (std::chrono::seconds(sleepBetweenOpsInSeconds));
+            m_firmwareUpdateProgress.SetPhase(PROG_WAITING_FOR_BOOTROM);
+            if(bootMode == BootMode::BOOTROM)
+            {
+                // Already reporting bootrom, give the reset time to start
+                // so the poll below doesn't see the pre-reset state
+                std::this_thread::sleep_for(std::chrono::milliseconds(BOOT_MODE_RESET_SETTLE_MS));
+            }
+            std::chrono::steady_clock::time_point bootModeDeadline = std::chrono::steady_clock::now() +
+                                                                     std::chrono::milliseconds(BOOT_MODE_SWITCH_DEADLINE_MS);
+            if(!WaitForBootMode(BootMode::BOOTROM, bootModeDeadline))
+            {
+                m_firmwareImage.Close();
+                m_firmwareUpdateProgress.ReportError(PROG_ERROR_UNABLE_TO_SWAP_TO_BOOTROM);
+                FinishFirmwareUpdate(false); // Early out
+                return;
+            }
+            m_firmwareUpdateProgress.SetPhase(PROG_SWAPPED_TO_BOOTROM);
+
+            const FirmwareRetryPolicy& retryPolicy = m_updateOptions.retryPolicy;
+            int totalBytesToWrite = pagesToWrite * XBOX_HDMI_PAGE_SIZE;
+            uint32_t pagesWritten = 0;
+            uint32_t pagesFailingVerify = 0;
+            bool flashWasSuccessful = true;
+
+            // Older firmware can't report busy state, fixed delays are used until it shows
+            m_busyStateReported = false;
 
-            // Verifying current boot mode
-            m_currentUpdateProcess(PROG_CHECKING_BOOT_MODE);
-            if(GetBootMode(&bootMode))
+            // Written ahead of every page so a power loss can be recovered from
+            BeginFlashJournal(resumePage);
+
+            // Whatever the manifest vouched for stops being true with the first page
+            m_flashManifest.Discard(DEFAULT_FLASH_MANIFEST_PATH);
+
+            // Flashing firmware
+            m_firmwareUpdateProgress.SetWorkload(pagesToWrite, totalBytesToWrite);
+            m_firmwareUpdateProgress.SetPhase(PROG_FLASHING_FIRMWARE);
+            for(uint32_t pageIndex = 0; pageIndex < PROGRAMMABLE_PAGES; )
             {
-                if(bootMode == BootMode::BOOTROM)
+                if(!pagesToFlash[pageIndex])
                 {
-                    m_currentUpdateProcess(PROG_SWAPPED_TO_BOOTROM);
+                    ++pageIndex;
+                    continue;
                 }
-                else
+
+                if(!WaitAtPageBoundary())
                 {
-                    m_currentErrorMessage(PROG_ERROR_UNABLE_TO_SWAP_TO_BOOTROM);
+                    m_firmwareUpdateReport.updateCancelled = true;
+                    m_firmwareUpdateProgress.ReportError(PROG_ERROR_UPDATE_CANCELLED);
+                    flashWasSuccessful = false;
+                    break;
                 }
-                
+
+                m_firmwareUpdateProgress.SetPage(pageIndex);
+                if(ProgramPage(pageIndex, isIncrementalFlash, pagesWritten * XBOX_HDMI_PAGE_SIZE))
+                {
+                    // Pages failing verification are flashed again once the rest are written
+                    if(m_updateOptions.verifyAfterFlash && !VerifyPage(pageIndex))
+                    {
+                        m_firmwareUpdateReport.pageVerifyFailed[pageIndex] = true;
+                        ++pagesFailingVerify;
+                    }
+                    else if(pagesFailingVerify == 0)
+                    {
+                        // The checkpoint can't move past a page that still needs flashing
+                        m_flashCheckpoint.MarkVerified(pageIndex);
+                        m_flashJournal.Record(pageIndex + 1);
+                    }
+                    m_firmwareUpdateProgress.PageDone(pageIndex);
+                    ++pageIndex;
+                    ++pagesWritten;
+                    continue;
+                }
+
+                // Only the failing page is re-driven, starting from its CRC
+                unsigned int& pageRetries = m_firmwareUpdateReport.pageRetries[pageIndex];
+                if(pageRetries >= retryPolicy.maxRetriesPerPage ||
+                   m_firmwareUpdateReport.totalRetries >= retryPolicy.maxTotalRetries)
+                {
+                    m_firmwareUpdateProgress.ReportError(PROG_ERROR_RETRY_LIMIT_REACHED);
+                    flashWasSuccessful = false;
+                    break;
+                }
+
+                uint32_t backoffMs = retryPolicy.initialBackoffMs;
+                for(unsigned int retry = 0; retry < pageRetries && backoffMs < retryPolicy.maxBackoffMs; ++retry)
+                {
+                    backoffMs *= 2;
+                }
+                if(backoffMs > retryPolicy.maxBackoffMs)
+                {
+                    backoffMs = retryPolicy.maxBackoffMs;
+                }
+
+                ++pageRetries;
+                ++m_firmwareUpdateReport.totalRetries;
+
+                // Cancelling cuts the back off short
+                std::unique_lock<std::mutex> lock(m_updateControlMutex);
+                m_updateControlCondition.wait_for(lock, std::chrono::milliseconds(backoffMs),
+                                                  [this]() {return m_cancelRequested;});
             }
-            std::this_thread::sleep_for (std::chrono::seconds(sleepBetweenOpsInSeconds));
+            m_firmwareUpdateReport.pagesWritten = pagesWritten;
+            m_firmwareUpdateReport.verifyPerformed = m_updateOptions.verifyAfterFlash;
 
-            int totalBytesToWrite = PROGRAMMABLE_PAGES * XBOX_HDMI_PAGE_SIZE;
+            if(flashWasSuccessful && m_updateOptions.verifyAfterFlash && pagesFailingVerify > 0)
+            {
+                flashWasSuccessful = ReflashFailedPages();
+            }
 
-            // Flashing firmware
-            m_currentUpdateProcess(PROG_FLASHING_FIRMWARE);
-            for(uint32_t pageIndex = 0; pageIndex < PROGRAMMABLE_PAGES; )
+            m_firmwareUpdateReport.stageTimings.prepareUs = m_firmwareImage.GetPreparationUs();
+
+            if(flashWasSuccessful)
             {
-                uint32_t pageOffset = pageIndex * XBOX_HDMI_PAGE_SIZE;
-                uint32_t crcValue = CRC_INIT;
-                uint32_t firmwareOffset = 0;
+                m_flashCheckpoint.Clear();
+                m_flashJournal.Discard(DEFAULT_FLASH_JOURNAL_PATH);
 
-                m_currentUpdateProcess(PROG_WRITING_PAGE_CRC);
-                // Generate CRC and write it for this page
-                for(uint32_t index = 0; index < XBOX_HDMI_PAGE_SIZE; ++index)
-                {
-                    firmwareOffset = index + pageOffset;
+                // Remember what was flashed so the next update can skip unchanged pages
+                RecordFlashManifest();
+            }
+            else
+            {
+                // Kept on disk for the next attempt
+                m_flashJournal.Close();
+            }
+
+            // Release the firmware file and the prepared pages
+            m_firmwareImage.Close();
 
-                    // Generate page CRC
-                    GeneratePageCrc(&crcValue, loadedFirmware, firmwareOffset, firmwareFileSize);
+            // Inform the client application that the update is complete.
+            m_firmwareUpdateReport.updateSuccessful = flashWasSuccessful;
+            FinishFirmwareUpdate(flashWasSuccessful);
+        }
+
+        void XboxHdmi::FinishFirmwareUpdate(bool updateSuccessful)
+        {
+            // Whatever was read from the boot rom is gone once the device boots
+            m_registerShadow.Invalidate();
+
+#ifdef CONFLUX_SMBUS_TRACE
+            // Keep the traffic that led up to the failure for the decoder
+            if(!updateSuccessful && MountHardDrive() && MakeDirectory(DEFAULT_FLASH_JOURNAL_DIRECTORY))
+            {
+                DumpBusTrace(DEFAULT_SMBUS_TRACE_PATH);
+            }
+#endif
+
+            // Cleared first so an application polling for the completion event can start another update
+            m_smBusWorker.SetProgramming(false);
+            m_firmwareUpdateRunning = false;
+            m_firmwareUpdateProgress.Complete(updateSuccessful);
+        }
+
+        bool XboxHdmi::WaitAtPageBoundary()
+        {
+            std::unique_lock<std::mutex> lock(m_updateControlMutex);
+            if(!m_pauseRequested || m_cancelRequested)
+            {
+                return !m_cancelRequested;
+            }
+
+            lock.unlock();
+            m_firmwareUpdateProgress.SetPhase(PROG_UPDATE_PAUSED);
+            lock.lock();
+
+            m_updateControlCondition.wait(lock, [this]() {return !m_pauseRequested || m_cancelRequested;});
+            bool updateCancelled = m_cancelRequested;
+            lock.unlock();
+
+            if(!updateCancelled)
+            {
+                m_firmwareUpdateProgress.SetPhase(PROG_FLASHING_FIRMWARE);
+            }
+            return !updateCancelled;
+        }
+
+        bool XboxHdmi::ProgramPage(uint32_t pageIndex, bool selectPage, uint32_t bytesAlreadyWritten)
+        {
+            uint8_t errorStatus;
+            uint32_t preparedCrc;
+            FirmwareStageTimings& stageTimings = m_firmwareUpdateReport.stageTimings;
+
+            // Read, padded and CRC'd when the plan was loaded, unless a retry discarded it
+            const uint8_t* pageData = m_firmwareImage.AcquirePage(pageIndex, &preparedCrc);
+            if(pageData == nullptr)
+            {
+                m_firmwareUpdateProgress.ReportError(PROG_ERROR_FAILED_TO_READ_FIRMWARE);
+                return false;
+            }
+
+            // The media returned something other than what the plan was built from,
+            // a retry reads the page from disk again
+            if(preparedCrc != m_flashPlan.GetEntry(pageIndex).crc)
+            {
+                m_firmwareImage.DiscardPage(pageIndex);
+                m_firmwareUpdateProgress.ReportError(PROG_ERROR_FIRMWARE_CORRUPT);
+                return false;
+            }
+
+            // From here on the page only costs bus transactions and device waits
+            std::chrono::steady_clock::time_point stageStart = std::chrono::steady_clock::now();
+
+            // Pages are only written in order on a full flash, so
+            // skipping pages means telling the device where we are
+            if(selectPage && !SelectProgrammingPage(pageIndex))
+            {
+                m_firmwareUpdateProgress.ReportError(PROG_ERROR_UNABLE_TO_SELECT_PAGE);
+                return false;
+            }
+
+            m_firmwareUpdateProgress.SetPhase(PROG_WRITING_PAGE_CRC);
+            if(!WritePageCrc(preparedCrc))
+            {
+                m_firmwareUpdateProgress.ReportError(PROG_ERROR_UNABLE_TO_WRITE_CRC_DATA);
+                return false;
+            }
+            stageTimings.busUs += MicrosecondsSince(stageStart);
+
+            // Waiting here is required to avoid CRC verification errors.
+            stageStart = std::chrono::steady_clock::now();
+            if(!WaitForProgrammingReady(ProgrammingWaitPoint::AFTER_PAGE_CRC))
+            {
+                m_firmwareUpdateProgress.ReportError(PROG_ERROR_DEVICE_READY_TIMEOUT);
+                return false;
+            }
+            stageTimings.deviceWaitUs += MicrosecondsSince(stageStart);
+            
+            stageStart = std::chrono::steady_clock::now();
+            m_firmwareUpdateProgress.SetPhase(PROG_WRITING_PAGE_DATA);
+            for(uint32_t offset = 0; offset < XBOX_HDMI_PAGE_SIZE; offset += SMBUS_PAGE_DATA_BYTES_PER_JOB)
+            {
+                // Written in slices so application requests can get on the bus in between
+                uint32_t sliceLength = XBOX_HDMI_PAGE_SIZE - offset;
+                if(sliceLength > SMBUS_PAGE_DATA_BYTES_PER_JOB)
+                {
+                    sliceLength = SMBUS_PAGE_DATA_BYTES_PER_JOB;
                 }
 
-                crcValue = CrcResult(crcValue);
-                if(!WritePageCrc(crcValue))
+                if(!WritePageData(pageData + offset, sliceLength))
                 {
-                    m_currentErrorMessage(PROG_ERROR_UNABLE_TO_WRITE_CRC_DATA);
+                    // The rest of the page would land at the wrong offsets
+                    m_firmwareUpdateProgress.ReportError(PROG_ERROR_UNABLE_TO_WRITE_PAGE_DATA);
+                    return false;
                 }
 
-                // Sleeping here is required to avoid CRC verification errors.
-                std::this_thread::sleep_for (std::chrono::milliseconds(750));
-                
-                m_currentUpdateProcess(PROG_WRITING_PAGE_DATA);
-                for(uint32_t index = 0; index < XBOX_HDMI_PAGE_SIZE; ++index)
-                {
-                    firmwareOffset = index + pageOffset;
-                    
-                    // Write page data
-                    m_currentUpdateProcess(PROG_WRITING_PAGE_DATA);
-                    if(!WritePageData(loadedFirmware, firmwareOffset, firmwareFileSize))
-                    {
-                        m_currentErrorMessage(PROG_ERROR_UNABLE_TO_WRITE_PAGE_DATA);
-                    }
+                // Only reaches the application when the whole percentage changes
+                m_firmwareUpdateProgress.SetBytesWritten(bytesAlreadyWritten + offset + sliceLength);
+            }
+            stageTimings.busUs += MicrosecondsSince(stageStart);
 
-                    // Attempt to yield to other threads
-                    std::this_thread::yield();
+            // Waiting here is required to avoid "failed to erase flash" errors
+            stageStart = std::chrono::steady_clock::now();
+            if(!WaitForProgrammingReady(ProgrammingWaitPoint::AFTER_PAGE_DATA))
+            {
+                m_firmwareUpdateProgress.ReportError(PROG_ERROR_DEVICE_READY_TIMEOUT);
+                return false;
+            }
+            stageTimings.deviceWaitUs += MicrosecondsSince(stageStart);
 
-                    // Update percentage complete
-                    float currentPercentage = ((float)firmwareOffset/(float)totalBytesToWrite) * 100.0f;
-                    m_currentPercentComplete((int)currentPercentage);
-                }
+            // Check program status
+            stageStart = std::chrono::steady_clock::now();
+            bool statusWasRead = CheckForProgrammingErrors(&errorStatus);
+            stageTimings.busUs += MicrosecondsSince(stageStart);
+            if(!statusWasRead)
+            {
+                m_firmwareUpdateProgress.ReportError(PROG_ERROR_UNABLE_TO_CHECK_ERROR_STATUS);
+                return false;
+            }
 
-                // Check program status
-                bool errorFound = false;
-                if(CheckForProgrammingErrors(&errorStatus))
+            switch (errorStatus)
+            {
+                case I2C_PROG_ERROR_ERASE:
                 {
-                    switch (errorStatus)
-                    {
-                        case I2C_PROG_ERROR_ERASE:
-                        {
-                            m_currentErrorMessage(I2C_PROG_ERROR_ERASE_MESSAGE);
-                            break;
-                        }
-                        case I2C_PROG_ERROR_WRITE:
-                        {
-                            m_currentErrorMessage(I2C_PROG_ERROR_WRITE_MESSAGE);
-                            break;
-                        }
-                        case I2C_PROG_ERROR_CRC:
-                        {
-                            m_currentErrorMessage(I2C_PROG_ERROR_CRC_MESSAGE);
-                            break;
-                        }
-                        default:
-                            ++pageIndex;
-                            break;
-                    }
+                    m_firmwareUpdateProgress.ReportError(I2C_PROG_ERROR_ERASE_MESSAGE);
+                    return false;
                 }
-                else
+                case I2C_PROG_ERROR_WRITE:
                 {
-                    m_currentErrorMessage(PROG_ERROR_UNABLE_TO_CHECK_ERROR_STATUS);
+                    m_firmwareUpdateProgress.ReportError(I2C_PROG_ERROR_WRITE_MESSAGE);
+                    return false;
                 }
+                case I2C_PROG_ERROR_CRC:
+                {
+                    m_firmwareUpdateProgress.ReportError(I2C_PROG_ERROR_CRC_MESSAGE);
+                    return false;
+                }
+                default:
+                    break;
+            }
+
+            return true;
+        }
 
-                // Sleeping here is required to avoid "failed to erase flash" errors
-                std::this_thread::sleep_for (std::chrono::milliseconds(750));
+        bool XboxHdmi::VerifyPage(uint32_t pageIndex)
+        {
+            uint8_t errorStatus;
+            uint16_t pageAndPosition;
+            uint32_t acceptedCrc;
+
+            // One job, so the registers all describe the same moment
+            bool readSuccessful = RunBusJob(FLASH_JOB, true, [&]() {
+                SmBusTransferWidth width = GetTransferWidth();
+                return CheckForProgrammingErrors(&errorStatus) &&
+                       ReadRegister<ProgPositionRegister>(m_smBus, &pageAndPosition, width) &&
+                       ReadRegister<ProgCrcRegister>(m_smBus, &acceptedCrc, width);
+            });
+
+            if(!readSuccessful || errorStatus != I2C_PROG_ERROR_NONE)
+            {
+                return false;
             }
 
-            // Clean up the loaded firmware
-            if(loadedFirmware != nullptr)
+            uint8_t programmingPage = (uint8_t)pageAndPosition;
+            uint8_t pagePosition = (uint8_t)(pageAndPosition >> 8);
+
+            // A committed page leaves the write position at the start of a page,
+            // with the device still on this page or already moved on to the next
+            if(pagePosition != 0 || (programmingPage != pageIndex && programmingPage != pageIndex + 1))
             {
-                delete [] loadedFirmware;
-                loadedFirmware = nullptr;
+                return false;
             }
 
-            // Inform the client application that the update is complete.
-            m_updateComplete(true);
+            // The CRC the device checked the page against has to be the one in the plan
+            return acceptedCrc == m_flashPlan.GetEntry(pageIndex).crc;
         }
 
-        bool XboxHdmi::LoadFirmwareImage(UpdateSource updateSource, uint8_t*& firmwareImage, long* fileSize, const char* firmwareFilePath)
+        bool XboxHdmi::ReflashFailedPages()
         {
-            bool imageWasLoaded = false;
+            std::vector<bool>& pageVerifyFailed = m_firmwareUpdateReport.pageVerifyFailed;
+            uint32_t pagesToReflash = 0;
 
-            switch (updateSource)
+            for(uint32_t pageIndex = 0; pageIndex < PROGRAMMABLE_PAGES; ++pageIndex)
             {
-            case UpdateSource::HDD:
-                // TODO
-                break;
-            case UpdateSource::DVD:
-                // TODO
-                break;
-            case UpdateSource::INTERNET:
-                // TODO
-                break;
-            case UpdateSource::WORKING_DIRECTORY:
+                if(pageVerifyFailed[pageIndex])
+                {
+                    ++pagesToReflash;
+                }
+            }
+
+            m_firmwareUpdateProgress.SetWorkload(pagesToReflash, pagesToReflash * XBOX_HDMI_PAGE_SIZE);
+            m_firmwareUpdateProgress.SetPhase(PROG_REFLASHING_FAILED_PAGES);
+            for(uint32_t pageIndex = 0; pageIndex < PROGRAMMABLE_PAGES; ++pageIndex)
             {
-                FILE* firmwareFile= fopen("D:\\firmware.bin", "rb");
+                if(!pageVerifyFailed[pageIndex])
+                {
+                    continue;
+                }
 
-                if(firmwareFile)
+                if(!WaitAtPageBoundary())
                 {
-                    fseek(firmwareFile, 0, SEEK_END);
-                    *fileSize = ftell(firmwareFile);
-                    rewind(firmwareFile);
+                    m_firmwareUpdateReport.updateCancelled = true;
+                    m_firmwareUpdateProgress.ReportError(PROG_ERROR_UPDATE_CANCELLED);
+                    return false;
+                }
 
-                    if(firmwareImage != nullptr)
-                    {
-                        delete [] firmwareImage;
-                        firmwareImage = nullptr;
-                    }
+                // Out of order, so the device is always told which page this is.
+                // A page failing twice is not going to be fixed by a third try.
+                m_firmwareUpdateProgress.SetPage(pageIndex);
+                if(!ProgramPage(pageIndex, true, m_firmwareUpdateReport.pagesReflashed * XBOX_HDMI_PAGE_SIZE) ||
+                   !VerifyPage(pageIndex))
+                {
+                    m_firmwareUpdateProgress.ReportError(PROG_ERROR_PAGE_VERIFY_FAILED);
+                    return false;
+                }
+
+                pageVerifyFailed[pageIndex] = false;
+                ++m_firmwareUpdateReport.pagesReflashed;
+            }
+
+            return true;
+        }
 
-                    firmwareImage = new uint8_t[*fileSize + 1];
+        bool XboxHdmi::OpenFirmwareImage(UpdateSource updateSource, const char* firmwareFilePath)
+        {
+            bool imageWasOpened = false;
 
-                    fread(firmwareImage, 1, *fileSize, firmwareFile);
-                    fclose(firmwareFile);
-                    imageWasLoaded = true;
+            switch (updateSource)
+            {
+            case UpdateSource::HDD:
+            case UpdateSource::DVD:
+            case UpdateSource::WORKING_DIRECTORY:
+            {
+                // The file may have changed since it was last polled
+                FirmwareCandidate candidate;
+                m_firmwareCatalog.Refresh(updateSource);
+                if(m_firmwareCatalog.GetBestCandidate(updateSource, &candidate, firmwareFilePath))
+                {
+                    imageWasOpened = m_firmwareImage.Open(candidate.path.c_str());
                 }
                 break;
             }
+            case UpdateSource::INTERNET:
+                // TODO
+                break;
             default:
                 break;
             }
 
-            return imageWasLoaded;
+            return imageWasOpened;
         }
 
-        bool XboxHdmi::SwitchBootMode(BootMode switchToMode)
+        bool XboxHdmi::LoadFlashPlan(uint32_t fileSize)
         {
-            BootMode currentMode;
-            bool writeSuccessful = false;
+            // Containers carry their page CRCs, the image only needs checking against them
+            if(m_firmwareImage.IsContainer())
+            {
+                return m_firmwareImage.GetHeader().ApplyToPlan(&m_flashPlan) &&
+                       VerifyFirmwareImage(m_firmwareImage.GetHeader().GetImageDigest());
+            }
 
-            if(GetBootMode(&currentMode) && currentMode != (ULONG)switchToMode)
+            // Prefer a plan produced offline by host tooling. It may have been made for
+            // another image of the same size, so it is only kept if the image matches it.
+            FILE* planFile = fopen(DEFAULT_FLASH_PLAN_WORKING_DIRECTORY,
+                                   DEFAULT_FIRMWARE_WORKING_DIRECTORY_OPEN_MODE);
+
+            if(planFile)
             {
-                if(switchToMode == BootMode::HDMI_PROGRAM)
+                uint8_t serializedPlan[FlashPlan::SERIALIZED_SIZE];
+                size_t bytesRead = fread(serializedPlan, 1, sizeof(serializedPlan), planFile);
+                fclose(planFile);
+
+                if(m_flashPlan.Deserialize(serializedPlan, (uint32_t)bytesRead) &&
+                   m_flashPlan.Validate(fileSize) &&
+                   VerifyFirmwareImage(m_flashPlan.GetImageDigest()))
                 {
-                    writeSuccessful = HalWriteSMBusValue(I2C_HDMI_ADRESS, I2C_LOAD_APP, 
-                                                        0, BOOT_HDMI_PROGRAM) == 0;
+                    return true;
                 }
-                else // BootMode::BOOTROM
+            }
+
+            // Otherwise stream the image through once to build it
+            if(!m_flashPlan.Begin(fileSize))
+            {
+                return false;
+            }
+
+            uint32_t imageCrc = Crc32::INITIAL_VALUE;
+            for(uint32_t pageIndex = 0; pageIndex < PROGRAMMABLE_PAGES; ++pageIndex)
+            {
+                uint32_t pageCrc;
+                const uint8_t* pageData = m_firmwareImage.AcquirePage(pageIndex, &pageCrc);
+                if(pageData == nullptr)
                 {
-                    writeSuccessful = HalWriteSMBusValue(I2C_HDMI_ADRESS, I2C_LOAD_APP, 
-                                                        0, BOOT_HDMI_BOOTROM) == 0;
+                    m_flashPlan.Clear();
+                    return false;
                 }
+
+                m_flashPlan.AddPageCrc(pageIndex, pageCrc);
+                imageCrc = Crc32::Update(imageCrc, pageData, m_flashPlan.GetEntry(pageIndex).dataLength);
             }
+            m_flashPlan.SetImageDigest(Crc32::Finalize(imageCrc));
 
-            return writeSuccessful;
+            return m_flashPlan.IsReady();
         }
 
-        void XboxHdmi::GeneratePageCrc(uint32_t* crcValue, uint8_t* firmwareFile, uint32_t offset, long fileSize)
+        bool XboxHdmi::VerifyFirmwareImage(uint32_t imageDigest)
         {
-            if (offset < fileSize)
+            uint32_t imageCrc = Crc32::INITIAL_VALUE;
+
+            for(uint32_t pageIndex = 0; pageIndex < PROGRAMMABLE_PAGES; ++pageIndex)
             {
-                *crcValue = CrcAddByte(*crcValue, firmwareFile[offset]);
+                uint32_t pageCrc;
+                const uint8_t* pageData = m_firmwareImage.AcquirePage(pageIndex, &pageCrc);
+                const FlashPlanEntry& entry = m_flashPlan.GetEntry(pageIndex);
+
+                if(pageData == nullptr || pageCrc != entry.crc)
+                {
+                    m_flashPlan.Clear();
+                    return false;
+                }
+
+                imageCrc = Crc32::Update(imageCrc, pageData, entry.dataLength);
             }
-            else
+
+            if(Crc32::Finalize(imageCrc) != imageDigest)
             {
-                *crcValue = CrcAddByte(*crcValue, 0x00);
+                m_flashPlan.Clear();
+                return false;
             }
 
-            return;
+            return true;
         }
 
-        bool XboxHdmi::WritePageCrc(uint32_t crcValue)
+        uint32_t XboxHdmi::SelectPagesToFlash(bool* pagesToFlash)
         {
-            bool writeWasSuccessful = false;
+            time_t compileTime;
 
-            writeWasSuccessful = HalWriteSMBusValue(I2C_HDMI_ADRESS, I2C_PROG_CRC3, 0,
-                                                    (crcValue >> 24) & 0xFF) == 0;
-            
-            if(writeWasSuccessful)
+            for(uint32_t pageIndex = 0; pageIndex < PROGRAMMABLE_PAGES; ++pageIndex)
             {
-            writeWasSuccessful = HalWriteSMBusValue(I2C_HDMI_ADRESS, I2C_PROG_CRC2, 0,
-                                                    (crcValue >> 16) & 0xFF) == 0;
+                pagesToFlash[pageIndex] = true;
             }
 
-            if(writeWasSuccessful)
+            // Anything we can't vouch for gets a full flash
+            if(!m_updateOptions.incrementalUpdate ||
+               !MountHardDrive() ||
+               !m_flashManifest.Load(DEFAULT_FLASH_MANIFEST_PATH) ||
+               !GetFirmwareCompileTime(&compileTime) ||
+               !m_flashManifest.Matches((uint32_t)compileTime))
             {
-            writeWasSuccessful = HalWriteSMBusValue(I2C_HDMI_ADRESS, I2C_PROG_CRC1, 0,
-                                                    (crcValue >> 8) & 0xFF) == 0;
+                return PROGRAMMABLE_PAGES;
             }
 
-            if(writeWasSuccessful)
+            uint32_t pagesToWrite = 0;
+            for(uint32_t pageIndex = 0; pageIndex < PROGRAMMABLE_PAGES; ++pageIndex)
             {
-            writeWasSuccessful = HalWriteSMBusValue(I2C_HDMI_ADRESS, I2C_PROG_CRC0, 0, 
-                                                    (crcValue)&0xFF) == 0;
+                pagesToFlash[pageIndex] = m_flashManifest.GetPageCrc(pageIndex) != m_flashPlan.GetEntry(pageIndex).crc;
+                if(pagesToFlash[pageIndex])
+                {
+                    ++pagesToWrite;
+                }
             }
 
-            return writeWasSuccessful;
+            return pagesToWrite;
         }
 
-        bool XboxHdmi::WritePageData(uint8_t* firmwareFile, uint32_t offset, long fileSize)
+        void XboxHdmi::RecordFlashManifest()
         {
-            if (offset < fileSize)
+            time_t compileTime;
+
+            // Kept with the journal, the working directory may be a read-only disc
+            if(!m_updateOptions.incrementalUpdate ||
+               !MountHardDrive() ||
+               !MakeDirectory(DEFAULT_FLASH_JOURNAL_DIRECTORY))
             {
-                if(HalWriteSMBusValue(I2C_HDMI_ADRESS, I2C_PROG_DATA, 0, firmwareFile[offset]) == 0)
-                {
-                    return true;
-                }
+                return;
             }
-            else
+
+            // Keyed by the compile time the new image reports, so it has to be seen running
+            m_firmwareUpdateProgress.SetPhase(PROG_WAITING_FOR_NEW_FIRMWARE);
+            std::chrono::steady_clock::time_point bootDeadline = std::chrono::steady_clock::now() +
+                                                                 std::chrono::milliseconds(NEW_FIRMWARE_BOOT_DEADLINE_MS);
+            if(!WaitForBootMode(BootMode::HDMI_FIRMWARE, bootDeadline))
             {
-                if(HalWriteSMBusValue(I2C_HDMI_ADRESS, I2C_PROG_DATA, 0, 0x00) == 0)
-                {
-                    return true;
-                }
+                return;
+            }
+
+            // Anything shadowed before the flash belongs to the old image
+            m_registerShadow.Invalidate();
+            if(!GetFirmwareCompileTime(&compileTime))
+            {
+                return;
+            }
+
+            m_flashManifest.Record(m_flashPlan);
+            if(m_flashManifest.Bind((uint32_t)compileTime))
+            {
+                m_flashManifest.Save(DEFAULT_FLASH_MANIFEST_PATH);
             }
-            return false;
         }
 
-        bool XboxHdmi::CheckForProgrammingErrors(ULONG* statusValue)
+        void XboxHdmi::RestoreCheckpointFromJournal()
         {
-            return (HalReadSMBusValue(I2C_HDMI_ADRESS, I2C_PROG_ERROR, false, statusValue) == 0);
+            BootMode bootMode;
+
+            // Progress from this session is newer than anything on disk
+            uint32_t planIdentity = m_flashPlan.GetIdentity();
+            if(m_flashCheckpoint.GetResumePage(planIdentity) > 0 ||
+               !MountHardDrive() ||
+               !m_flashJournal.Load(DEFAULT_FLASH_JOURNAL_PATH) ||
+               !m_flashJournal.Matches(m_flashPlan))
+            {
+                return;
+            }
+
+            // A flash cut short leaves the device without firmware to boot,
+            // so the journal is only trusted while the device is waiting
+            // to be programmed
+            if(!GetBootMode(&bootMode))
+            {
+                return;
+            }
+            if(bootMode != BootMode::BOOTROM && bootMode != BootMode::HDMI_PROGRAM)
+            {
+                m_flashJournal.Discard(DEFAULT_FLASH_JOURNAL_PATH);
+                return;
+            }
+
+            m_flashCheckpoint.Restore(planIdentity, m_flashJournal.GetResumePage());
         }
 
-        uint32_t XboxHdmi::CrcAddByte(uint32_t crc, uint8_t addByte)
+        void XboxHdmi::BeginFlashJournal(uint32_t resumePage)
         {
-            for (uint8_t bitPosition = 0x01; bitPosition > 0; bitPosition <<= 1)
+            // Without a hard drive the update still runs, it just can't
+            // survive a power loss
+            if(MountHardDrive() && MakeDirectory(DEFAULT_FLASH_JOURNAL_DIRECTORY))
             {
-                uint32_t mostSignificantBit = crc & 0x80000000;
-                if (addByte & bitPosition)
+                m_flashJournal.Begin(DEFAULT_FLASH_JOURNAL_PATH, m_flashPlan, resumePage);
+            }
+        }
+
+        bool XboxHdmi::SelectProgrammingPage(uint32_t pageIndex)
+        {
+            return RunBusJob(FLASH_JOB, false, [this, pageIndex]() {
+                return WriteRegister<ProgPageRegister>(m_smBus, (uint8_t)pageIndex);
+            });
+        }
+
+        bool XboxHdmi::SwitchBootMode(BootMode switchToMode)
+        {
+            // The check and the switch can't have anything else in between
+            return RunBusJob(FLASH_JOB, false, [this, switchToMode]() {
+                BootMode currentMode;
+
+                if(!GetBootMode(&currentMode))
+                {
+                    return false;
+                }
+
+                // Already there, e.g. after an earlier update was cut short
+                if(currentMode == switchToMode)
                 {
-                    mostSignificantBit ^= 0x80000000;
-                } 
+                    return true;
+                }
 
-                if (mostSignificantBit)
+                if(switchToMode == BootMode::HDMI_PROGRAM)
                 {
-                    crc = (crc << 1) ^ 0x4C11DB7;
+                    return WriteRegister<LoadAppRegister>(m_smBus, BOOT_HDMI_PROGRAM);
                 }
-                else
+                else // BootMode::BOOTROM
                 {
-                    crc = (crc << 1);
+                    return WriteRegister<LoadAppRegister>(m_smBus, BOOT_HDMI_BOOTROM);
                 }
+            });
+        }
+
+        bool XboxHdmi::WritePageCrc(uint32_t crcValue)
+        {
+            // The register map keeps these to single writes, most significant byte first.
+            // A batch goes lowest register first, which would hand the device CRC0 ahead
+            // of the others.
+            return RunBusJob(FLASH_JOB, false, [this, crcValue]() {
+                return WriteRegister<ProgCrcRegister>(m_smBus, crcValue);
+            });
+        }
+
+        bool XboxHdmi::WritePageData(const uint8_t* data, uint32_t length)
+        {
+            return RunBusJob(FLASH_JOB, false, [this, data, length]() {
+                for(uint32_t index = 0; index < length; ++index)
+                {
+                    if(!WriteRegister<ProgDataRegister>(m_smBus, data[index]))
+                    {
+                        return false;
+                    }
+                }
+
+                return true;
+            });
+        }
+
+        bool XboxHdmi::CheckForProgrammingErrors(uint8_t* statusValue)
+        {
+            return RunBusJob(FLASH_JOB, true, [this, statusValue]() {
+                return ReadRegister<ProgErrorRegister>(m_smBus, statusValue);
+            });
+        }
+
+        void XboxHdmi::SetProgrammingWaitMode(ProgrammingWaitMode waitMode)
+        {
+            m_programmingWaitMode = waitMode;
+        }
+
+        bool XboxHdmi::IsBusyStateReported()
+        {
+            // Called straight after a CRC or data write. Firmware without busy
+            // reporting reads 0 here too, so only a device seen busy is trusted.
+            if(!m_busyStateReported)
+            {
+                bool isReady = true;
+                m_busyStateReported = IsProgrammingReady(&isReady) && !isReady;
             }
-            return crc;
+
+            return m_busyStateReported;
         }
 
-        uint32_t XboxHdmi::CrcResult(uint32_t crc)
+        bool XboxHdmi::IsProgrammingReady(bool* isReady)
         {
-            return (ReverseU32(crc) ^ 0xFFFFFFFF);
+            // Full in the low byte, busy in the high byte
+            uint16_t state;
+
+            // A full page buffer means the device has not consumed the page yet
+            bool readSuccessful = RunBusJob(FLASH_JOB, true, [this, &state]() {
+                return ReadRegister<ProgStateRegister>(m_smBus, &state, GetTransferWidth());
+            });
+            if(!readSuccessful)
+            {
+                return false;
+            }
+
+            *isReady = (state == 0);
+            return true;
         }
-        
-        uint32_t XboxHdmi::ReverseU32(uint32_t dataToReverse)
+
+        bool XboxHdmi::WaitForProgrammingReady(ProgrammingWaitPoint waitPoint)
         {
-            uint32_t reversed = 0;
-            for (size_t iter = 0; iter < 32; ++iter)
+            std::chrono::steady_clock::time_point waitStart = std::chrono::steady_clock::now();
+
+            if(m_programmingWaitMode == ProgrammingWaitMode::FIXED_DELAY || !IsBusyStateReported())
             {
-                reversed <<= 1;
-                reversed |= (dataToReverse & 0x01);
-                dataToReverse >>= 1;
+                std::this_thread::sleep_for(std::chrono::milliseconds(PROG_READY_FIXED_DELAY_MS));
+                return true;
+            }
+
+            std::chrono::steady_clock::time_point deadline = waitStart + std::chrono::milliseconds(PROG_READY_DEADLINE_MS);
+            uint32_t pollInterval = PROG_READY_POLL_INITIAL_INTERVAL_MS;
+            uint32_t& learnedLatency = m_learnedReadyLatencyMs[waitPoint];
+
+            // Skip most of the latency seen on previous pages before polling
+            if(m_programmingWaitMode == ProgrammingWaitMode::ADAPTIVE && learnedLatency > 0)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds((learnedLatency * 3) / 4));
+            }
+
+            while(true)
+            {
+                bool isReady = false;
+                if(!IsProgrammingReady(&isReady))
+                {
+                    // Busy state went away mid update, finish on fixed delays
+                    m_busyStateReported = false;
+                    std::this_thread::sleep_for(std::chrono::milliseconds(PROG_READY_FIXED_DELAY_MS));
+                    return true;
+                }
+
+                std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+                if(isReady)
+                {
+                    uint32_t observedLatency = (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(now - waitStart).count();
+                    learnedLatency = (learnedLatency == 0) ? observedLatency
+                                                           : ((learnedLatency * 3) + observedLatency) / 4;
+                    return true;
+                }
+
+                if(now >= deadline)
+                {
+                    return false;
+                }
+
+                std::this_thread::sleep_for(std::chrono::milliseconds(pollInterval));
+                pollInterval = (pollInterval * 2 > PROG_READY_POLL_MAX_INTERVAL_MS) ? PROG_READY_POLL_MAX_INTERVAL_MS
+                                                                                   : pollInterval * 2;
             }
-            return reversed;
         }
     } // XboxHDMI
 } // Conflux
\ No newline at end of file
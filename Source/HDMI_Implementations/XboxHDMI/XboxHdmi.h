@@ -18,9 +18,26 @@ Copyright 2021 Chase Cobb
 #define XBOXHDMI_H
 
 #include "HdmiInterface.h"
+#include "FlashPlan.h"
+#include "FlashManifest.h"
+#include "FirmwareImageReader.h"
+#include "FirmwareCatalog.h"
+#include "FlashCheckpoint.h"
+#include "FlashJournal.h"
+#include "SmBusWorker.h"
+#include "SmBusTransport.h"
+#include "RegisterShadow.h"
+#include "BusTransactionPolicy.h"
+#ifdef CONFLUX_SMBUS_TRACE
+#include "SmBusTracer.h"
+#endif
 #include <time.h>
+#include <chrono>
 #include <thread>
-#include <windows.h>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <string>
 
 namespace Conflux
 {
@@ -34,18 +51,48 @@ namespace Conflux
             HDMI_FIRMWARE,
         };
 
+        /**
+         * @brief How the flash loop waits for the device to finish
+         * with a page before moving on.
+         * 
+         */
+        enum ProgrammingWaitMode
+        {
+            FIXED_DELAY,    // Always sleep PROG_READY_FIXED_DELAY_MS
+            POLL_BUSY,      // Poll the busy registers with exponential backoff
+            ADAPTIVE,       // Poll, but sleep through the latency seen on earlier pages first
+        };
+
+        enum ProgrammingWaitPoint
+        {
+            AFTER_PAGE_CRC,
+            AFTER_PAGE_DATA,
+            PROGRAMMING_WAIT_POINT_COUNT,
+        };
+
         class XboxHdmi : public HdmiInterface
         {
         public:
-            XboxHdmi();
+            /**
+             * @brief Construct a new XboxHdmi object.
+             * 
+             * @param smBus transport the device is reached through. It
+             * must outlive this object.
+             */
+            XboxHdmi(SmBusTransport* smBus);
             ~XboxHdmi();
             
             bool IsFirmwareUpdateAvailable(UpdateSource updateSource, const char* firmwareFilePath = "");
+            void RefreshFirmwareSources();
+            void AddFirmwareSearchDirectory(UpdateSource updateSource, const char* directoryPath);
             bool UpdateFirmware(UpdateSource updateSource, void (*currentProcess)(const char* currentProcess)
                                                          , void (*percentComplete)(int percentageComplete)
                                                          , void (*errorMessage)(const char* errorMessage)
                                                          , void (*updateComplete)(bool flashSuccessful)
                                                          , const char* pathToFirmware = "");
+            bool CancelFirmwareUpdate();
+            bool PauseFirmwareUpdate();
+            bool ResumeFirmwareUpdate();
             bool IsFeatureSupported(SupportedFeatures feature);
             bool GetFirmwareVersion(VersionCode* versionCode);
             const char* GetName();
@@ -54,30 +101,129 @@ namespace Conflux
             bool UpdateConfigValues();
             bool SaveConfig();
 
+            /**
+             * @brief Sets how firmware updates wait for each page to be
+             * programmed. Firmware that does not report busy state reads
+             * as ready at all times, so fixed delays are used until the
+             * device has been seen busy after a page write.
+             * 
+             * @param waitMode wait mode, ProgrammingWaitMode::ADAPTIVE
+             * by default.
+             */
+            void SetProgrammingWaitMode(ProgrammingWaitMode waitMode);
+
+            /**
+             * @brief Gets the queue metrics of the SMBus worker that
+             * carries all traffic to the device.
+             * 
+             * @param metrics filled out with the current metrics.
+             */
+            void GetBusMetrics(SmBusWorkerMetrics* metrics);
+
+            /**
+             * @brief Gets how many register reads were answered without
+             * going to the device.
+             * 
+             * @param metrics filled out with the register shadow metrics.
+             */
+            void GetRegisterShadowMetrics(RegisterShadowMetrics* metrics);
+
+            /**
+             * @brief Gets the bus errors seen so far, and how many of
+             * them retries recovered from.
+             * 
+             * @param counters filled out with the totals over every
+             * register.
+             */
+            void GetBusErrorCounters(BusErrorCounters* counters);
+
+            /**
+             * @brief Gets the bus errors seen with one register.
+             * 
+             * @param command XboxHDMI register.
+             * @param counters filled out with the register's counters.
+             */
+            void GetRegisterErrorCounters(uint8_t command, BusErrorCounters* counters);
+
+            /**
+             * @brief Writes the most recent SMBus transactions to a file
+             * for the Trace_Decoder tool.
+             * 
+             * @param path absolute path of the dump file.
+             * @return true if the trace was written.
+             * @return false if it could not be written or the library
+             * was built without CONFLUX_SMBUS_TRACE.
+             */
+            bool DumpBusTrace(const char* path);
+
         private:
-            uint8_t* m_loadedFirmware;
+            // Only used from jobs on the SMBus worker. Points at the
+            // shadow, which sits in front of the injected transport.
+            SmBusTransport* m_smBus;
+#ifdef CONFLUX_SMBUS_TRACE
+            // Below the shadow so only real bus traffic is traced
+            SmBusTracer m_smBusTracer;
+#endif
+            // Below the shadow so it only sees the failures retries couldn't fix
+            BusTransactionPolicy m_busPolicy;
+            RegisterShadow m_registerShadow;
+            SmBusTransferWidth m_transferWidth;
+            bool m_transferWidthKnown;
+
+            // Every transaction with the device goes through here
+            SmBusWorker m_smBusWorker;
+
+            FirmwareImageReader m_firmwareImage;
+            FirmwareCatalog m_firmwareCatalog;
+            std::string m_pathToFirmware;
+            // Taken when the update starts, so the worker never sees the options change under it
+            FirmwareUpdateOptions m_updateOptions;
+            FlashPlan m_flashPlan;
+            FlashManifest m_flashManifest;
+            FlashCheckpoint m_flashCheckpoint;
+            FlashJournal m_flashJournal;
             std::thread m_firmwareUpdateThread;
+            std::atomic<bool> m_firmwareUpdateRunning;
+
+            // Requests from the application, honoured at page boundaries
+            std::mutex m_updateControlMutex;
+            std::condition_variable m_updateControlCondition;
+            bool m_cancelRequested;
+            bool m_pauseRequested;
 
-            void (*m_currentUpdateProcess)(const char* currentProcess);
-            void (*m_currentPercentComplete)(int percentComplete);
-            void (*m_currentErrorMessage)(const char* errorMessage);
-            void (*m_updateComplete)(bool flashSuccessful);
+            ProgrammingWaitMode m_programmingWaitMode;
+            bool m_busyStateReported;
+            uint32_t m_learnedReadyLatencyMs[PROGRAMMING_WAIT_POINT_COUNT];
 
+            bool RunBusJob(BusJobPriority priority, bool readOnly, const SmBusWorker::Job& job);
+            SmBusTransferWidth GetTransferWidth();
             bool GetFirmwareCompileTime(time_t* compileTime);
             bool GetBootMode(BootMode* mode);
             bool SwitchBootMode(BootMode switchToMode);
+            bool WaitForBootMode(BootMode targetMode, std::chrono::steady_clock::time_point deadline);
 
             void StartFirmwareUpdateProcess(UpdateSource updateSource);
-            bool LoadFirmwareImage(UpdateSource updateSource, uint8_t*& firmwareImage, long* fileSize, const char* firmwareFilePath = "");
-            
-            void GeneratePageCrc(uint32_t* CrcValue, uint8_t* firmwareFile, uint32_t offset, long fileSize);
+            void FinishFirmwareUpdate(bool updateSuccessful);
+            bool WaitAtPageBoundary();
+            bool OpenFirmwareImage(UpdateSource updateSource, const char* firmwareFilePath = "");
+            bool LoadFlashPlan(uint32_t fileSize);
+            bool VerifyFirmwareImage(uint32_t imageDigest);
+            uint32_t SelectPagesToFlash(bool* pagesToFlash);
+            void RecordFlashManifest();
+            void RestoreCheckpointFromJournal();
+            void BeginFlashJournal(uint32_t resumePage);
+            bool SelectProgrammingPage(uint32_t pageIndex);
+
+            bool ProgramPage(uint32_t pageIndex, bool selectPage, uint32_t bytesAlreadyWritten);
             bool WritePageCrc(uint32_t CrcValue);
-            bool WritePageData(uint8_t* firmwareFile, uint32_t offset, long fileSize);
-            bool CheckForProgrammingErrors(ULONG* statusValue);
+            bool WritePageData(const uint8_t* data, uint32_t length);
+            bool CheckForProgrammingErrors(uint8_t* statusValue);
+            bool VerifyPage(uint32_t pageIndex);
+            bool ReflashFailedPages();
 
-            uint32_t CrcAddByte(uint32_t crc, uint8_t addByte);
-            uint32_t CrcResult(uint32_t crc);
-            uint32_t ReverseU32(uint32_t dataToReverse);
+            bool IsBusyStateReported();
+            bool IsProgrammingReady(bool* isReady);
+            bool WaitForProgrammingReady(ProgrammingWaitPoint waitPoint);
         };
     } // XboxHDMI
 } // Conflux
@@ -0,0 +1,334 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef XBOXHDMIREGISTERS_H
+#define XBOXHDMIREGISTERS_H
+
+#include "SmBusTransport.h"
+#include "XboxHDMI_Config.h"
+#include <stdint.h>
+#include <type_traits>
+
+namespace Conflux
+{
+    namespace XboxHDMI
+    {
+        /**
+         * @brief How long an XboxHDMI register keeps the value
+         * last read from or written to it.
+         * 
+         */
+        enum RegisterVolatility
+        {
+            VOLATILE_REGISTER,      // Boot mode, programming and status, always read from the device
+            BOOT_CONSTANT_REGISTER, // Version and compile time, fixed until the device boots again
+            EEPROM_REGISTER,        // Settings, only change when written
+        };
+
+        /**
+         * @brief Which register holds the least significant byte of a
+         * multi-byte value.
+         * 
+         */
+        enum RegisterByteOrder
+        {
+            REGISTER_LITTLE_ENDIAN, // Lowest register holds the least significant byte
+            REGISTER_BIG_ENDIAN,    // Lowest register holds the most significant byte
+        };
+
+        /**
+         * @brief What the library may do with a register.
+         * 
+         */
+        enum RegisterAccess
+        {
+            REGISTER_READ_ONLY,
+            REGISTER_WRITE_ONLY,
+            REGISTER_READ_WRITE,
+            REGISTER_WRITE_STREAM,  // Every write moves the device on, so one is never repeated
+        };
+
+        /**
+         * @brief How the registers of a multi-byte value are moved.
+         * 
+         */
+        enum RegisterTransfer
+        {
+            TRANSFER_BATCHED,           // One batch, lowest register first, words where the device allows
+            TRANSFER_BYTES_DESCENDING,  // Written as single bytes, highest register first, read as a batch
+        };
+
+        /**
+         * @brief Describes one XboxHDMI register, or a run of
+         * consecutive registers read and written as one value.
+         * Everything is known at compile time, so ReadRegister() and
+         * WriteRegister() compile down to the same transactions and
+         * shifts as hand-written code.
+         * 
+         * @tparam ValueType unsigned type the registers assemble into,
+         * void for a block only moved as bytes.
+         * @tparam Command first register.
+         * @tparam Width number of consecutive registers.
+         * @tparam ByteOrder order of the bytes across the registers.
+         * @tparam Access what the library may do with the registers.
+         * @tparam Volatility how long the registers can be shadowed.
+         * @tparam Transfer how the registers are moved.
+         */
+        template<typename ValueType, uint8_t Command, uint8_t Width, RegisterByteOrder ByteOrder,
+                 RegisterAccess Access, RegisterVolatility Volatility, RegisterTransfer Transfer = TRANSFER_BATCHED>
+        struct Register
+        {
+            typedef ValueType Value;
+            static const uint8_t command = Command;
+            static const uint8_t width = Width;
+            static const RegisterByteOrder byteOrder = ByteOrder;
+            static const RegisterAccess access = Access;
+            static const RegisterVolatility volatility = Volatility;
+            static const RegisterTransfer transfer = Transfer;
+
+            static_assert(Width > 0 && (unsigned int)Command + Width <= 256, "registers run off the end of the map");
+
+            static constexpr bool Covers(uint8_t registerCommand)
+            {
+                return registerCommand >= Command && registerCommand < Command + Width;
+            }
+
+            static constexpr bool IsReadable()
+            {
+                return Access == REGISTER_READ_ONLY || Access == REGISTER_READ_WRITE;
+            }
+
+            static constexpr bool IsWritable()
+            {
+                return Access != REGISTER_READ_ONLY;
+            }
+        };
+
+        // The XboxHDMI register map, built from the addresses in XboxHDMI_Config.h
+        typedef Register<uint8_t, I2C_BOOT_MODE, 1, REGISTER_LITTLE_ENDIAN, REGISTER_READ_ONLY,
+                         VOLATILE_REGISTER> BootModeRegister;
+        typedef Register<uint32_t, I2C_COMPILE_TIME0, 4, REGISTER_BIG_ENDIAN, REGISTER_READ_ONLY,
+                         BOOT_CONSTANT_REGISTER> CompileTimeRegister;
+        typedef Register<uint8_t, I2C_LOAD_APP, 1, REGISTER_LITTLE_ENDIAN, REGISTER_WRITE_ONLY,
+                         VOLATILE_REGISTER> LoadAppRegister;
+        typedef Register<uint8_t, I2C_PROG_DATA, 1, REGISTER_LITTLE_ENDIAN, REGISTER_WRITE_STREAM,
+                         VOLATILE_REGISTER> ProgDataRegister;
+        typedef Register<uint8_t, I2C_PROG_PAGE, 1, REGISTER_LITTLE_ENDIAN, REGISTER_READ_WRITE,
+                         VOLATILE_REGISTER> ProgPageRegister;
+        // Page in the low byte, write position in the high byte
+        typedef Register<uint16_t, I2C_PROG_PAGE, 2, REGISTER_LITTLE_ENDIAN, REGISTER_READ_ONLY,
+                         VOLATILE_REGISTER> ProgPositionRegister;
+        // Full in the low byte, busy in the high byte
+        typedef Register<uint16_t, I2C_PROG_FULL, 2, REGISTER_LITTLE_ENDIAN, REGISTER_READ_ONLY,
+                         VOLATILE_REGISTER> ProgStateRegister;
+        // The device checks the page once CRC0 lands, so it has to be written last
+        typedef Register<uint32_t, I2C_PROG_CRC0, 4, REGISTER_LITTLE_ENDIAN, REGISTER_READ_WRITE,
+                         VOLATILE_REGISTER, TRANSFER_BYTES_DESCENDING> ProgCrcRegister;
+        typedef Register<uint8_t, I2C_PROG_ERROR, 1, REGISTER_LITTLE_ENDIAN, REGISTER_READ_ONLY,
+                         VOLATILE_REGISTER> ProgErrorRegister;
+        typedef Register<uint8_t, I2C_EEPROM_SAVE, 1, REGISTER_LITTLE_ENDIAN, REGISTER_WRITE_ONLY,
+                         VOLATILE_REGISTER> EepromSaveRegister;
+        // Widescreen, video out, luma, Cb and Cr
+        typedef Register<void, I2C_EEPROM_WIDESCREEN, 5, REGISTER_LITTLE_ENDIAN, REGISTER_READ_WRITE,
+                         EEPROM_REGISTER> EepromSettingsRegisters;
+        // Major in the high byte, patch in the low byte
+        typedef Register<uint32_t, I2C_FIRMWARE_VERSION, 3, REGISTER_BIG_ENDIAN, REGISTER_READ_ONLY,
+                         BOOT_CONSTANT_REGISTER> FirmwareVersionRegister;
+
+        /**
+         * @brief Answers questions about a register number from a list
+         * of register descriptors, first match wins.
+         * 
+         */
+        template<typename... Registers>
+        struct RegisterTable
+        {
+            static constexpr RegisterVolatility GetVolatility(uint8_t) {return VOLATILE_REGISTER;}
+            static constexpr bool IsWriteStream(uint8_t) {return false;}
+        };
+
+        template<typename First, typename... Rest>
+        struct RegisterTable<First, Rest...>
+        {
+            static constexpr RegisterVolatility GetVolatility(uint8_t command)
+            {
+                return First::Covers(command) ? First::volatility : RegisterTable<Rest...>::GetVolatility(command);
+            }
+
+            static constexpr bool IsWriteStream(uint8_t command)
+            {
+                return First::Covers(command) ? First::access == REGISTER_WRITE_STREAM :
+                                                RegisterTable<Rest...>::IsWriteStream(command);
+            }
+        };
+
+        // Registers a lookup by number needs to know about
+        typedef RegisterTable<FirmwareVersionRegister,
+                              CompileTimeRegister,
+                              EepromSettingsRegisters,
+                              ProgDataRegister> XboxHdmiRegisterMap;
+
+        static_assert(XboxHdmiRegisterMap::GetVolatility(I2C_FIRMWARE_VERSION + 2) == BOOT_CONSTANT_REGISTER &&
+                      XboxHdmiRegisterMap::GetVolatility(I2C_COMPILE_TIME3) == BOOT_CONSTANT_REGISTER &&
+                      XboxHdmiRegisterMap::GetVolatility(I2C_EEPROM_ADJUST_CR) == EEPROM_REGISTER &&
+                      XboxHdmiRegisterMap::GetVolatility(I2C_BOOT_MODE) == VOLATILE_REGISTER,
+                      "register map volatility");
+
+        /**
+         * @brief Assembles the value of a register from its bytes.
+         * 
+         * @tparam R register descriptor.
+         * @param bytes R::width bytes, lowest register first.
+         * @return R::Value assembled value.
+         */
+        template<typename R>
+        inline typename R::Value AssembleRegisterValue(const uint8_t* bytes)
+        {
+            static_assert(std::is_unsigned<typename R::Value>::value && R::width <= sizeof(typename R::Value),
+                          "register value must be an unsigned type wide enough for every byte");
+
+            typename R::Value value = 0;
+            for(uint8_t index = 0; index < R::width; ++index)
+            {
+                uint8_t shift = 8 * ((R::byteOrder == REGISTER_LITTLE_ENDIAN) ? index : (R::width - 1 - index));
+                value |= (typename R::Value)((typename R::Value)bytes[index] << shift);
+            }
+            return value;
+        }
+
+        /**
+         * @brief Splits the value of a register into its bytes.
+         * 
+         * @tparam R register descriptor.
+         * @param value value to split.
+         * @param bytes R::width bytes filled out, lowest register first.
+         */
+        template<typename R>
+        inline void SplitRegisterValue(typename R::Value value, uint8_t* bytes)
+        {
+            static_assert(std::is_unsigned<typename R::Value>::value && R::width <= sizeof(typename R::Value),
+                          "register value must be an unsigned type wide enough for every byte");
+
+            for(uint8_t index = 0; index < R::width; ++index)
+            {
+                uint8_t shift = 8 * ((R::byteOrder == REGISTER_LITTLE_ENDIAN) ? index : (R::width - 1 - index));
+                bytes[index] = (uint8_t)(value >> shift);
+            }
+        }
+
+        /**
+         * @brief Reads the raw bytes of a register.
+         * 
+         * @tparam R register descriptor.
+         * @param smBus transport the device is reached through.
+         * @param bytes R::width bytes filled out, lowest register first.
+         * @param width widest transfer the device supports.
+         * @return true if every register was read.
+         * @return false otherwise.
+         */
+        template<typename R>
+        inline bool ReadRegisterBytes(SmBusTransport* smBus, uint8_t* bytes, SmBusTransferWidth width)
+        {
+            static_assert(R::IsReadable(), "register can't be read");
+
+            if(R::width == 1)
+            {
+                return smBus->ReadByte(I2C_HDMI_ADRESS, R::command, bytes);
+            }
+            return smBus->ReadRegisters(I2C_HDMI_ADRESS, R::command, R::width, bytes, width);
+        }
+
+        /**
+         * @brief Writes the raw bytes of a register, in the order its
+         * descriptor asks for.
+         * 
+         * @tparam R register descriptor.
+         * @param smBus transport the device is reached through.
+         * @param bytes R::width bytes to write, lowest register first.
+         * @param width widest transfer the device supports.
+         * @return true if every register was written.
+         * @return false otherwise.
+         */
+        template<typename R>
+        inline bool WriteRegisterBytes(SmBusTransport* smBus, const uint8_t* bytes, SmBusTransferWidth width)
+        {
+            static_assert(R::IsWritable(), "register can't be written");
+
+            if(R::width == 1)
+            {
+                return smBus->WriteByte(I2C_HDMI_ADRESS, R::command, bytes[0]);
+            }
+
+            if(R::transfer == TRANSFER_BYTES_DESCENDING)
+            {
+                for(uint8_t index = R::width; index > 0; --index)
+                {
+                    if(!smBus->WriteByte(I2C_HDMI_ADRESS, (uint8_t)(R::command + index - 1), bytes[index - 1]))
+                    {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            return smBus->WriteRegisters(I2C_HDMI_ADRESS, R::command, R::width, bytes, width);
+        }
+
+        /**
+         * @brief Reads a register and assembles its value.
+         * 
+         * @tparam R register descriptor.
+         * @param smBus transport the device is reached through.
+         * @param value filled out with the register value.
+         * @param width widest transfer the device supports.
+         * @return true if every register was read.
+         * @return false otherwise.
+         */
+        template<typename R>
+        inline bool ReadRegister(SmBusTransport* smBus, typename R::Value* value,
+                                 SmBusTransferWidth width = BYTE_TRANSFERS)
+        {
+            uint8_t bytes[R::width];
+            if(!ReadRegisterBytes<R>(smBus, bytes, width))
+            {
+                return false;
+            }
+
+            *value = AssembleRegisterValue<R>(bytes);
+            return true;
+        }
+
+        /**
+         * @brief Splits a value and writes it to a register.
+         * 
+         * @tparam R register descriptor.
+         * @param smBus transport the device is reached through.
+         * @param value value to write.
+         * @param width widest transfer the device supports.
+         * @return true if every register was written.
+         * @return false otherwise.
+         */
+        template<typename R>
+        inline bool WriteRegister(SmBusTransport* smBus, typename R::Value value,
+                                  SmBusTransferWidth width = BYTE_TRANSFERS)
+        {
+            uint8_t bytes[R::width];
+            SplitRegisterValue<R>(value, bytes);
+            return WriteRegisterBytes<R>(smBus, bytes, width);
+        }
+    } // XboxHDMI
+} // Conflux
+
+#endif // XBOXHDMIREGISTERS_H
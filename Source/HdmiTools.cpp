@@ -26,6 +26,7 @@ namespace Conflux
 
     HdmiTools::HdmiTools()
     {
+        m_smBusTransport = GetPlatformSmBusTransport();
         m_hdmiInterface = nullptr;
         m_firmwareVersion = nullptr;
     } 
@@ -87,7 +88,7 @@ namespace Conflux
             return false;
             break;
         case HdmiHardwareId::XBOXHDMI:
-            m_hdmiInterface = new XboxHDMI::XboxHdmi;
+            m_hdmiInterface = new XboxHDMI::XboxHdmi(m_smBusTransport);
             m_hdmiInterface->LoadConfig();
             return true;
             break;
@@ -98,9 +99,20 @@ namespace Conflux
         return false;
     }
 
+    bool HdmiTools::SetSmBusTransport(SmBusTransport* transport)
+    {
+        if(transport == nullptr || m_hdmiInterface != nullptr)
+        {
+            return false;
+        }
+
+        m_smBusTransport = transport;
+        return true;
+    }
+
     HdmiHardwareId HdmiTools::GetHardwareId()
     {
-        return DetectInstalledHardware();
+        return DetectInstalledHardware(m_smBusTransport);
     }
 
     bool HdmiTools::IsFeatureSupported(SupportedFeatures feature)
@@ -151,11 +163,9 @@ namespace Conflux
                 m_firmwareVersion = new VersionCode;
             }
 
-            if(m_hdmiInterface->GetFirmwareVersion(m_firmwareVersion))
-            {
-                // TODO : Add a "dirty" flag to avoid polling
-                //        unless necessary.
-            }
+            // Cheap to call repeatedly, implementations only go to the
+            // device again once it may have rebooted
+            m_hdmiInterface->GetFirmwareVersion(m_firmwareVersion);
         }
 
         return *m_firmwareVersion;
@@ -191,6 +201,26 @@ namespace Conflux
         return updateAvailable;
     }
 
+    bool HdmiTools::RefreshUpdateSources()
+    {
+        if(m_hdmiInterface != nullptr)
+        {
+            m_hdmiInterface->RefreshFirmwareSources();
+            return true;
+        }
+        return false;
+    }
+
+    bool HdmiTools::AddUpdateSearchDirectory(UpdateSource updateSource, const char* directoryPath)
+    {
+        if(m_hdmiInterface != nullptr && directoryPath != nullptr)
+        {
+            m_hdmiInterface->AddFirmwareSearchDirectory(updateSource, directoryPath);
+            return true;
+        }
+        return false;
+    }
+
     bool HdmiTools::UpdateFirmware(UpdateSource updateSource, void (*currentProcess)(const char* currentProcess)
                                                             , void (*percentComplete)(int percentageComplete)
                                                             , void (*errorMessage)(const char* errorMessage)
@@ -209,6 +239,72 @@ namespace Conflux
         return false;
     }
 
+    bool HdmiTools::SetFirmwareUpdateOptions(const FirmwareUpdateOptions& options)
+    {
+        if(m_hdmiInterface != nullptr)
+        {
+            m_hdmiInterface->SetFirmwareUpdateOptions(options);
+            return true;
+        }
+        return false;
+    }
+
+    bool HdmiTools::CancelFirmwareUpdate()
+    {
+        if(m_hdmiInterface != nullptr)
+        {
+            return m_hdmiInterface->CancelFirmwareUpdate();
+        }
+        return false;
+    }
+
+    bool HdmiTools::PauseFirmwareUpdate()
+    {
+        if(m_hdmiInterface != nullptr)
+        {
+            return m_hdmiInterface->PauseFirmwareUpdate();
+        }
+        return false;
+    }
+
+    bool HdmiTools::ResumeFirmwareUpdate()
+    {
+        if(m_hdmiInterface != nullptr)
+        {
+            return m_hdmiInterface->ResumeFirmwareUpdate();
+        }
+        return false;
+    }
+
+    bool HdmiTools::GetFirmwareUpdateReport(FirmwareUpdateReport* report)
+    {
+        if(m_hdmiInterface != nullptr && report != nullptr)
+        {
+            *report = m_hdmiInterface->GetFirmwareUpdateReport();
+            return true;
+        }
+        return false;
+    }
+
+    bool HdmiTools::GetFirmwareUpdateProgress(FirmwareUpdateProgress* progress)
+    {
+        if(m_hdmiInterface != nullptr && progress != nullptr)
+        {
+            m_hdmiInterface->GetFirmwareUpdateProgress(progress);
+            return true;
+        }
+        return false;
+    }
+
+    bool HdmiTools::PollFirmwareUpdateEvent(FirmwareUpdateEvent* event)
+    {
+        if(m_hdmiInterface != nullptr && event != nullptr)
+        {
+            return m_hdmiInterface->PollFirmwareUpdateEvent(event);
+        }
+        return false;
+    }
+
     bool HdmiTools::SaveSettings()
     {
         if(m_hdmiInterface != nullptr)
@@ -20,6 +20,7 @@ Copyright 2021 Chase Cobb
 #include "Enums.h"
 #include "VersionCode.h"
 #include "HdmiInterface.h"
+#include "SmBusTransport.h"
 #include <vector>
 
 namespace Conflux
@@ -55,6 +56,20 @@ namespace Conflux
          */
         bool Initialize();
 
+        /**
+         * @brief Sets the SMBus transport the HDMI hardware is reached
+         * through, in place of the platform's own. Used to run the
+         * library against a simulated or recorded device.
+         * 
+         * @param transport transport to use, it must outlive the
+         * singleton.
+         * @return true if the transport was set.
+         * @return false if transport is nullptr or the singleton is
+         * already initialized.
+         * @note Must be called before Initialize().
+         */
+        bool SetSmBusTransport(SmBusTransport* transport);
+
         /**
          * @brief Check feature support on the current platform.
          * 
@@ -112,33 +127,62 @@ namespace Conflux
          * 
          * @param updateSource Enumeration of possible update sources. 
          * Indexed by Conflux::UpdateSource.
-         * @param pathToFirmware Allows the location of the update
-         * to be provided by absolute path, if the update source is 
-         * Conflux::UpdateSource::WORKING_DIRECTORY.
+         * @param pathToFirmware Allows a specific update file on the
+         * update source to be provided by absolute path, instead of
+         * the newest firmware found on it.
          * @return true if an update is available.
          * @return false otherwise.
          */
         bool IsUpdateAvailable(UpdateSource updateSource, const char* pathToFirmware = "");
 
+        /**
+         * @brief Checks the update sources again, for example after
+         * the user has copied a new firmware file. IsUpdateAvailable()
+         * otherwise caches its results for a short time.
+         * 
+         * The sources are scanned in the background, so this can be
+         * called from the render loop. IsUpdateAvailable() keeps
+         * giving the previous results until each scan completes.
+         * 
+         * @return true if the update sources were checked.
+         * @return false otherwise.
+         */
+        bool RefreshUpdateSources();
+
+        /**
+         * @brief Adds a directory to search for firmware files, on top
+         * of the defaults for the update source.
+         * 
+         * @param updateSource Enumeration of possible update sources. 
+         * Indexed by Conflux::UpdateSource.
+         * @param directoryPath absolute path to the directory.
+         * @return true if the directory was added.
+         * @return false otherwise.
+         */
+        bool AddUpdateSearchDirectory(UpdateSource updateSource, const char* directoryPath);
+
         /**
          * @brief Calling this function with a valid update source
          * will begin the process of updating the firmware. This is an 
          * async process and updates to the process are provided via 
-         * callbacks.
+         * callbacks, or by polling GetFirmwareUpdateProgress().
+         * Progress callbacks are coalesced and rate limited, see
+         * FirmwareUpdateOptions::maxProgressCallbacksPerSecond.
          * 
          * @param updateSource Enumeration of possible update sources. 
          * Indexed by Conflux::UpdateSource.
          * @param currentProcess Callback that provides updates
-         * on the current update process.
+         * on the current update process. May be nullptr.
          * @param percentComplete Callback that provides the 
-         * current percentage complete.
+         * current percentage complete. May be nullptr.
          * @param errorMessage Callback that provides any errors
-         * encountered during the process.
+         * encountered during the process. May be nullptr.
          * @param updateComplete Callback that notifies that the
-         * update has completed successfully, or otherwise.
-         * @param pathToFirmware Allows the location of the update
-         * to be provided by absolute path, if the update source is 
-         * Conflux::UpdateSource::WORKING_DIRECTORY.
+         * update has completed successfully, or otherwise. May be
+         * nullptr.
+         * @param pathToFirmware Allows a specific update file on the
+         * update source to be provided by absolute path, instead of
+         * the newest firmware found on it.
          * @return true if the Process was started successfully.
          * @return false otherwise.
          */
@@ -146,7 +190,84 @@ namespace Conflux
                                                      , void (*percentComplete)(int percentageComplete)
                                                      , void (*errorMessage)(const char* errorMessage)
                                                      , void (*updateComplete)(bool flashSuccessful)
-                                                     , const char* pathToFirmware = " ");
+                                                     , const char* pathToFirmware = "");
+
+        /**
+         * @brief Sets options that change how the next firmware
+         * update is performed.
+         * 
+         * @param options firmware update options. Options the installed
+         * HDMI hardware does not support are ignored.
+         * @return true if the options were applied.
+         * @return false otherwise.
+         */
+        bool SetFirmwareUpdateOptions(const FirmwareUpdateOptions& options);
+
+        /**
+         * @brief Stops the running firmware update once the current
+         * page is finished. The HDMI device stays in its boot rom
+         * until an update completes. Issuing the same update again
+         * continues from the last verified page when
+         * FirmwareUpdateOptions::resumeFromCheckpoint is set, and
+         * starts over from the first page otherwise.
+         * 
+         * @return true if an update was running.
+         * @return false otherwise.
+         */
+        bool CancelFirmwareUpdate();
+
+        /**
+         * @brief Holds the running firmware update once the current
+         * page is finished.
+         * 
+         * @return true if an update was running.
+         * @return false otherwise.
+         */
+        bool PauseFirmwareUpdate();
+
+        /**
+         * @brief Continues a paused firmware update.
+         * 
+         * @return true if an update was running.
+         * @return false otherwise.
+         */
+        bool ResumeFirmwareUpdate();
+
+        /**
+         * @brief Gets the report of the last firmware update, including
+         * per page retry counts.
+         * 
+         * @param report filled out with the update report.
+         * @return true if a report was available.
+         * @return false otherwise.
+         * @note The report is only complete once the update complete
+         * callback has been called.
+         */
+        bool GetFirmwareUpdateReport(FirmwareUpdateReport* report);
+
+        /**
+         * @brief Gets the current state of a firmware update, including
+         * the phase, page, bytes written, last error and time remaining.
+         * Polling this once per frame replaces the progress callbacks.
+         * 
+         * @param progress filled out with the current state.
+         * @return true if the state was available.
+         * @return false otherwise.
+         */
+        bool GetFirmwareUpdateProgress(FirmwareUpdateProgress* progress);
+
+        /**
+         * @brief Removes the oldest event raised by a firmware update:
+         * phase changes, percentage changes, finished pages, errors and
+         * completion. Unlike the callbacks, events are handled on the
+         * caller's thread, so no locking is needed. Drain it from one
+         * thread only, for example the render loop.
+         * 
+         * @param event filled out with the oldest event.
+         * @return true if an event was removed.
+         * @return false if no events are queued.
+         */
+        bool PollFirmwareUpdateEvent(FirmwareUpdateEvent* event);
 
         /**
          * @brief Get the current value of a given feature, as well
@@ -204,6 +325,7 @@ namespace Conflux
 
     private:
         static HdmiTools* m_instance;
+        SmBusTransport* m_smBusTransport;
         HdmiInterface* m_hdmiInterface;
         VersionCode* m_firmwareVersion;
         VersionCode* m_kernelVersion;
@@ -0,0 +1,215 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "Enums.h"
+#include "FirmwareHeader.h"
+#include "FlashPlan.h"
+
+using namespace Conflux;
+using namespace Conflux::XboxHDMI;
+
+void PrintUsage(const char* toolName);
+bool ReadFile(const char* path, std::vector<uint8_t>* contents);
+bool WriteFile(const char* path, const uint8_t* data, size_t length);
+int Pack(const char* imagePath, const char* outputPath, const char* version);
+int Inspect(const char* filePath);
+int Plan(const char* imagePath, const char* outputPath);
+
+int main(int argc, char* argv[])
+{
+  if(argc == 5 && strcmp(argv[1], "pack") == 0)
+  {
+    return Pack(argv[2], argv[3], argv[4]);
+  }
+  else if(argc == 3 && strcmp(argv[1], "inspect") == 0)
+  {
+    return Inspect(argv[2]);
+  }
+  else if(argc == 4 && strcmp(argv[1], "plan") == 0)
+  {
+    return Plan(argv[2], argv[3]);
+  }
+
+  PrintUsage(argv[0]);
+  return 1;
+}
+
+void PrintUsage(const char* toolName)
+{
+  printf("Usage:\n");
+  printf("  %s pack <firmware.bin> <firmware.cfw> <major.minor.patch>\n", toolName);
+  printf("  %s inspect <firmware file>\n", toolName);
+  printf("  %s plan <firmware.bin> <firmware.plan>\n", toolName);
+}
+
+bool ReadFile(const char* path, std::vector<uint8_t>* contents)
+{
+  FILE* file = fopen(path, "rb");
+  if(!file)
+  {
+    return false;
+  }
+
+  fseek(file, 0, SEEK_END);
+  long fileSize = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  bool readSuccessful = fileSize >= 0;
+  if(readSuccessful)
+  {
+    contents->resize((size_t)fileSize);
+    readSuccessful = fread(contents->data(), 1, contents->size(), file) == contents->size();
+  }
+
+  fclose(file);
+  return readSuccessful;
+}
+
+bool WriteFile(const char* path, const uint8_t* data, size_t length)
+{
+  FILE* file = fopen(path, "wb");
+  if(!file)
+  {
+    return false;
+  }
+
+  bool writeSuccessful = fwrite(data, 1, length, file) == length;
+  return (fclose(file) == 0) && writeSuccessful;
+}
+
+int Pack(const char* imagePath, const char* outputPath, const char* version)
+{
+  unsigned int major, minor, patch;
+  if(sscanf(version, "%u.%u.%u", &major, &minor, &patch) != 3 ||
+     major > 0xFF || minor > 0xFF || patch > 0xFF)
+  {
+    printf("Invalid version \"%s\"\n", version);
+    return 1;
+  }
+
+  std::vector<uint8_t> image;
+  if(!ReadFile(imagePath, &image))
+  {
+    printf("Unable to read %s\n", imagePath);
+    return 1;
+  }
+
+  FirmwareHeader header;
+  if(!header.Build(image.data(), (uint32_t)image.size(), HdmiHardwareId::XBOXHDMI,
+                   (uint8_t)major, (uint8_t)minor, (uint8_t)patch))
+  {
+    printf("%s is not a valid firmware image (%zu bytes)\n", imagePath, image.size());
+    return 1;
+  }
+
+  std::vector<uint8_t> container(FirmwareHeader::SERIALIZED_SIZE);
+  header.Serialize(container.data(), (uint32_t)container.size());
+  container.insert(container.end(), image.begin(), image.end());
+
+  if(!WriteFile(outputPath, container.data(), container.size()))
+  {
+    printf("Unable to write %s\n", outputPath);
+    return 1;
+  }
+
+  printf("Packed %s v%u.%u.%u into %s\n", imagePath, major, minor, patch, outputPath);
+  return 0;
+}
+
+int Inspect(const char* filePath)
+{
+  std::vector<uint8_t> contents;
+  if(!ReadFile(filePath, &contents))
+  {
+    printf("Unable to read %s\n", filePath);
+    return 1;
+  }
+
+  FirmwareHeader header;
+  switch(header.Deserialize(contents.data(), (uint32_t)contents.size()))
+  {
+    case FIRMWARE_FILE_RAW:
+      printf("%s: raw firmware image, %zu bytes\n", filePath, contents.size());
+      return 0;
+    case FIRMWARE_FILE_CONTAINER:
+      break;
+    default:
+      printf("%s: damaged firmware container\n", filePath);
+      return 1;
+  }
+
+  printf("%s: firmware container\n", filePath);
+  printf("  Hardware ID: %u\n", header.GetHardwareId());
+  printf("  Version:     %u.%u.%u\n", header.GetMajor(), header.GetMinor(), header.GetPatch());
+  printf("  Image:       %u bytes\n", header.GetImageLength());
+  printf("  Digest:      %08X\n", header.GetImageDigest());
+
+  if(contents.size() < FirmwareHeader::SERIALIZED_SIZE + header.GetImageLength())
+  {
+    printf("  Image is truncated\n");
+    return 1;
+  }
+
+  // Check the payload against the header the same way the console does
+  FirmwareHeader payloadHeader;
+  payloadHeader.Build(contents.data() + FirmwareHeader::SERIALIZED_SIZE, header.GetImageLength(),
+                      header.GetHardwareId(), header.GetMajor(), header.GetMinor(), header.GetPatch());
+
+  bool imageIntact = payloadHeader.GetImageDigest() == header.GetImageDigest();
+  for(uint32_t pageIndex = 0; pageIndex < PROGRAMMABLE_PAGES; ++pageIndex)
+  {
+    bool pageIntact = payloadHeader.GetPageCrc(pageIndex) == header.GetPageCrc(pageIndex);
+    printf("  Page %2u:     %08X%s\n", pageIndex, header.GetPageCrc(pageIndex), pageIntact ? "" : " (mismatch)");
+    imageIntact = imageIntact && pageIntact;
+  }
+
+  printf("  Image is %s\n", imageIntact ? "intact" : "corrupt");
+  return imageIntact ? 0 : 1;
+}
+
+int Plan(const char* imagePath, const char* outputPath)
+{
+  std::vector<uint8_t> image;
+  if(!ReadFile(imagePath, &image))
+  {
+    printf("Unable to read %s\n", imagePath);
+    return 1;
+  }
+
+  FlashPlan flashPlan;
+  if(!flashPlan.Build(image.data(), (long)image.size()))
+  {
+    printf("%s is not a valid firmware image (%zu bytes)\n", imagePath, image.size());
+    return 1;
+  }
+
+  uint8_t serializedPlan[FlashPlan::SERIALIZED_SIZE];
+  flashPlan.Serialize(serializedPlan, sizeof(serializedPlan));
+
+  if(!WriteFile(outputPath, serializedPlan, sizeof(serializedPlan)))
+  {
+    printf("Unable to write %s\n", outputPath);
+    return 1;
+  }
+
+  printf("Wrote flash plan for %s to %s\n", imagePath, outputPath);
+  return 0;
+}
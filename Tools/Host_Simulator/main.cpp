@@ -0,0 +1,651 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#include "HdmiTools.h"
+#include "SimulatedXboxHdmi.h"
+#include "XboxHdmi.h"
+#include "SmBusWorker.h"
+#include "SmBusTracer.h"
+#include "SmBusReplay.h"
+#include "FirmwareCatalog.h"
+#include "XboxHDMI_Config.h"
+
+using namespace Conflux;
+using namespace Conflux::XboxHDMI;
+
+// One byte read at the 100 kHz the console runs its SMBus at:
+// start, address, command, repeated start, address, data, stop
+const double SMBUS_BYTE_READ_US = 380.0;
+
+// What tracing may add to a transaction, about 0.25% of a bus read
+const double TRACE_BUDGET_NS = 1000.0;
+
+// How long the slow update source takes to get ready, a DVD drive spinning up
+const uint32_t SLOW_SOURCE_PREPARE_MS = 200;
+
+// How long the simulated device stays busy after a page write
+const uint32_t PAGE_PROGRAM_LATENCY_MS = 2;
+
+const char* const FIRMWARE_IMAGE_PATH = "host_firmware.bin";
+const char* const SMBUS_TRACE_PATH = "host_smbus.trace";
+const char* const SMBUS_SESSION_PATH = "host_session.smbus";
+const char* const CATALOG_IMAGE_PATH = "host_catalog.bin";
+
+int g_failures = 0;
+
+void Check(bool condition, const char* description);
+bool WriteFirmwareImage(const char* path, std::vector<uint8_t>* image);
+bool WriteStaleFlashPlan(const std::vector<uint8_t>& image);
+void RunApiChecks(HdmiTools* hdmiTools, SimulatedXboxHdmi* device);
+void RunByteFallbackChecks();
+void RunRegisterShadowChecks();
+void RunBusRetryChecks();
+void RunSessionReplayChecks();
+void RunFirmwareCatalogChecks();
+bool PrepareSlowSource();
+bool RunSettingsSession(SmBusTransport* transport, int luma);
+void RunFirmwareUpdate(HdmiTools* hdmiTools, SimulatedXboxHdmi* device);
+void RunDispatchBenchmark(SimulatedXboxHdmi* device, int transactions);
+void RunTracerBenchmark(int transactions);
+bool ReadThroughInterface(SmBusTransport* transport, uint8_t* value) __attribute__((noinline));
+
+int main(int argc, char* argv[])
+{
+  int transactions = 1000000;
+  if(argc > 1)
+  {
+    transactions = atoi(argv[1]);
+  }
+  if(transactions <= 0)
+  {
+    printf("Usage: %s [benchmark transactions]\n", argv[0]);
+    return 1;
+  }
+
+  // Outlives the singleton, which is never torn down
+  static SimulatedXboxHdmi device;
+  device.SetFirmwareVersion(1, 2, 3);
+
+  printf("Initialization\n");
+  HdmiTools* hdmiTools = HdmiTools::GetInstance();
+  Check(hdmiTools->SetSmBusTransport(&device), "transport accepted before Initialize()");
+
+  device.SetPresent(false);
+  Check(!hdmiTools->Initialize(), "Initialize() fails without a device on the bus");
+  device.SetPresent(true);
+
+  // Detection, settings and version, everything an application reads at startup
+  unsigned long long startupTransactions = device.GetTransactionCount();
+  Check(hdmiTools->Initialize(), "Initialize() finds the simulated XboxHDMI");
+  hdmiTools->GetFirmwareVersion();
+  startupTransactions = device.GetTransactionCount() - startupTransactions;
+  printf("  %llu transactions to start up\n", startupTransactions);
+  Check(startupTransactions <= 8, "startup takes word transfers");
+  Check(!hdmiTools->SetSmBusTransport(&device), "transport rejected after Initialize()");
+
+  RunApiChecks(hdmiTools, &device);
+  RunByteFallbackChecks();
+  RunRegisterShadowChecks();
+  RunBusRetryChecks();
+  RunSessionReplayChecks();
+  RunFirmwareCatalogChecks();
+  RunFirmwareUpdate(hdmiTools, &device);
+  RunDispatchBenchmark(&device, transactions);
+  RunTracerBenchmark(transactions);
+
+  printf("%s: %d check(s) failed\n", g_failures == 0 ? "PASS" : "FAIL", g_failures);
+  return g_failures == 0 ? 0 : 1;
+}
+
+void Check(bool condition, const char* description)
+{
+  printf("  [%s] %s\n", condition ? " ok " : "FAIL", description);
+  if(!condition)
+  {
+    ++g_failures;
+  }
+}
+
+void RunApiChecks(HdmiTools* hdmiTools, SimulatedXboxHdmi* device)
+{
+  printf("HdmiTools API\n");
+
+  Check(strcmp(hdmiTools->GetHdmiName(), "XboxHDMI") == 0, "GetHdmiName() is XboxHDMI");
+
+  VersionCode firmwareVersion = hdmiTools->GetFirmwareVersion();
+  Check(firmwareVersion.GetMajor() == 1 && firmwareVersion.GetMinor() == 2 && firmwareVersion.GetPatch() == 3,
+        "GetFirmwareVersion() reads 1.2.3 from the device");
+
+  std::vector<SupportedFeatures> features;
+  hdmiTools->GetAllSupportedFeatures(&features);
+  Check(features.size() == 5, "five configurable features");
+
+  int value, min, max;
+  Check(hdmiTools->GetFeatureValues(SupportedFeatures::LUMA_ADJUST, &value, &min, &max) &&
+        value == 0 && min == -12 && max == 12, "luma starts at 0 in -12..12");
+
+  Check(hdmiTools->SetFeatureValue(SupportedFeatures::LUMA_ADJUST, -5), "SetFeatureValue() luma -5");
+  Check(hdmiTools->SetFeatureValue(SupportedFeatures::WIDESCREEN_ADJUST, 2), "SetFeatureValue() widescreen 2");
+  Check(hdmiTools->UpdateFeatureConfig(), "UpdateFeatureConfig()");
+  Check(hdmiTools->SaveSettings(), "SaveSettings()");
+
+  uint8_t luma = 0;
+  uint8_t widescreen = 0;
+  Check(device->ReadByte(I2C_HDMI_ADRESS, I2C_EEPROM_ADJUST_LUMA, &luma) && (int8_t)luma == -5 &&
+        device->ReadByte(I2C_HDMI_ADRESS, I2C_EEPROM_WIDESCREEN, &widescreen) && widescreen == 2,
+        "settings registers hold the new values");
+}
+
+void RunByteFallbackChecks()
+{
+  printf("Device without word transfers\n");
+
+  SimulatedXboxHdmi device;
+  device.SetFirmwareVersion(1, 2, 3);
+  device.SetRegisterAutoIncrement(false);
+
+  XboxHdmi xboxHdmi(&device);
+  Check(xboxHdmi.LoadConfig(), "LoadConfig()");
+
+  VersionCode firmwareVersion;
+  Check(xboxHdmi.GetFirmwareVersion(&firmwareVersion) && firmwareVersion.GetMajor() == 1 &&
+        firmwareVersion.GetMinor() == 2 && firmwareVersion.GetPatch() == 3, "version read a byte at a time");
+
+  int value;
+  Check(xboxHdmi.SetFeatureCurrentValue(SupportedFeatures::CB_ADJUST, 7) && xboxHdmi.UpdateConfigValues(),
+        "UpdateConfigValues()");
+
+  uint8_t cb = 0;
+  uint8_t cr = 0xFF;
+  Check(device.ReadByte(I2C_HDMI_ADRESS, I2C_EEPROM_ADJUST_CB, &cb) && cb == 7 &&
+        device.ReadByte(I2C_HDMI_ADRESS, I2C_EEPROM_ADJUST_CR, &cr) && cr == 0 &&
+        xboxHdmi.GetFeatureCurrentValue(SupportedFeatures::CB_ADJUST, &value) && value == 7,
+        "settings registers written one by one");
+}
+
+void RunRegisterShadowChecks()
+{
+  printf("Register shadow\n");
+
+  SimulatedXboxHdmi device;
+  device.SetFirmwareVersion(1, 2, 3);
+
+  XboxHdmi xboxHdmi(&device);
+  VersionCode firmwareVersion;
+  Check(xboxHdmi.LoadConfig() && xboxHdmi.GetFirmwareVersion(&firmwareVersion), "first reads reach the device");
+
+  unsigned long long transactions = device.GetTransactionCount();
+  for(int repeat = 0; repeat < 10; ++repeat)
+  {
+    xboxHdmi.LoadConfig();
+    xboxHdmi.GetFirmwareVersion(&firmwareVersion);
+  }
+  Check(device.GetTransactionCount() == transactions, "repeated settings and version reads stay off the bus");
+
+  int value;
+  Check(xboxHdmi.SetFeatureCurrentValue(SupportedFeatures::LUMA_ADJUST, 4) && xboxHdmi.UpdateConfigValues() &&
+        xboxHdmi.LoadConfig() && xboxHdmi.GetFeatureCurrentValue(SupportedFeatures::LUMA_ADJUST, &value) &&
+        value == 4, "written settings read back from the shadow");
+
+  RegisterShadowMetrics metrics;
+  xboxHdmi.GetRegisterShadowMetrics(&metrics);
+  printf("  %llu hits, %llu misses, %llu uncached, %llu invalidations\n",
+         metrics.hits, metrics.misses, metrics.uncached, metrics.invalidations);
+  Check(metrics.hits == 85 && metrics.misses == 8, "every repeat served from the shadow");
+}
+
+void RunBusRetryChecks()
+{
+  printf("Bus retries\n");
+
+  // One in three transactions is lost, far noisier than a real bus
+  SimulatedXboxHdmi device;
+  device.SetFirmwareVersion(1, 2, 3);
+  device.SetFaultInjection(SMBUS_NAK, 3);
+
+  XboxHdmi xboxHdmi(&device);
+  VersionCode firmwareVersion;
+  Check(xboxHdmi.LoadConfig() && xboxHdmi.GetFirmwareVersion(&firmwareVersion) &&
+        firmwareVersion.GetMajor() == 1 && firmwareVersion.GetMinor() == 2 && firmwareVersion.GetPatch() == 3,
+        "settings and version read through NAKs");
+
+  // Widescreen, video out, luma, Cb and Cr, in register order
+  const int8_t settings[5] = {1, 1, 5, -7, -3};
+  Check(xboxHdmi.SetFeatureCurrentValue(SupportedFeatures::WIDESCREEN_ADJUST, settings[0]) &&
+        xboxHdmi.SetFeatureCurrentValue(SupportedFeatures::VIDEO_MODE_ADJUST, settings[1]) &&
+        xboxHdmi.SetFeatureCurrentValue(SupportedFeatures::LUMA_ADJUST, settings[2]) &&
+        xboxHdmi.SetFeatureCurrentValue(SupportedFeatures::CB_ADJUST, settings[3]) &&
+        xboxHdmi.SetFeatureCurrentValue(SupportedFeatures::CR_ADJUST, settings[4]) &&
+        xboxHdmi.UpdateConfigValues(), "settings written through NAKs");
+
+  // Straight from the device, the shadow would answer otherwise
+  device.SetFaultInjection(SMBUS_OK, 0);
+  bool settingsReached = true;
+  for(uint8_t index = 0; index < sizeof(settings); ++index)
+  {
+    uint8_t setting = 0;
+    settingsReached = settingsReached && device.ReadByte(I2C_HDMI_ADRESS, I2C_EEPROM_WIDESCREEN + index, &setting) &&
+                      (int8_t)setting == settings[index];
+  }
+  Check(settingsReached, "every setting reached the device");
+
+  BusErrorCounters counters;
+  xboxHdmi.GetBusErrorCounters(&counters);
+  printf("  %llu transient, %llu fatal, %llu retries, %llu recovered, %llu failed\n",
+         counters.transientErrors, counters.fatalErrors, counters.retries, counters.recovered, counters.failed);
+  Check(counters.transientErrors > 0 && counters.recovered == counters.transientErrors && counters.failed == 0,
+        "every NAK recovered by a retry");
+
+  // Refused requests fail at once, a device that never answers costs the deadline at most
+  BusTransactionPolicy busPolicy(&device);
+  uint8_t bootMode;
+  device.SetFaultInjection(SMBUS_INVALID_REQUEST, 1);
+  Check(!busPolicy.ReadByte(I2C_HDMI_ADRESS, I2C_BOOT_MODE, &bootMode) &&
+        busPolicy.GetLastBusError() == SMBUS_INVALID_REQUEST, "refused request reported as fatal");
+  busPolicy.GetErrorCounters(I2C_BOOT_MODE, &counters);
+  Check(counters.fatalErrors == 1 && counters.retries == 0 && counters.failed == 1, "fatal errors are not retried");
+
+  device.SetFaultInjection(SMBUS_OK, 0);
+  device.SetPresent(false);
+  busPolicy.ResetErrorCounters();
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  Check(!busPolicy.ReadByte(I2C_HDMI_ADRESS, I2C_BOOT_MODE, &bootMode) &&
+        busPolicy.GetLastBusError() == SMBUS_NAK, "absent device reported as a NAK");
+  unsigned long long elapsedUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                                   std::chrono::steady_clock::now() - start).count();
+  busPolicy.GetErrorCounters(I2C_BOOT_MODE, &counters);
+  printf("  absent device given up on after %llu us and %llu retries\n", elapsedUs, counters.retries);
+  Check(counters.failed == 1 && counters.retries <= SMBUS_TRANSACTION_RETRIES &&
+        elapsedUs < SMBUS_TRANSACTION_DEADLINE_US + 5000, "retries stop at the deadline");
+
+  // A page data byte may have landed, it is never written twice
+  device.SetPresent(true);
+  device.SetFaultInjection(SMBUS_NAK, 1);
+  busPolicy.ResetErrorCounters();
+  Check(!busPolicy.WriteByte(I2C_HDMI_ADRESS, I2C_PROG_DATA, 0x00), "page data write fails on a NAK");
+  busPolicy.GetErrorCounters(I2C_PROG_DATA, &counters);
+  Check(counters.retries == 0 && counters.failed == 1, "page data writes are not retried");
+}
+
+void RunSessionReplayChecks()
+{
+  printf("Session replay\n");
+
+  const uint32_t latencyUs = 20;
+  SimulatedXboxHdmi device;
+  device.SetTransactionLatencyUs(latencyUs);
+  SmBusTracer recorder(&device);
+  Check(recorder.StartRecording(SMBUS_SESSION_PATH) && RunSettingsSession(&recorder, 6) &&
+        recorder.StopRecording(), "settings session recorded");
+  uint32_t recorded = recorder.GetRecordCount();
+
+  SmBusReplay replay;
+  SmBusReplayReport report;
+  Check(replay.Load(SMBUS_SESSION_PATH), "session loaded");
+  Check(RunSettingsSession(&replay, 6), "session replays at recorded timing");
+  replay.GetReport(&report);
+  printf("  %llu transactions, recorded %llu us, replayed %llu us\n",
+         report.transactions, report.recordedUs, report.replayedUs);
+  Check(report.transactions == recorded && report.divergences == 0 && report.remaining == 0,
+        "replay follows the recording exactly");
+  Check(report.replayedUs >= (report.transactions - 1) * latencyUs, "recorded device latency kept");
+
+  replay.Load(SMBUS_SESSION_PATH);
+  replay.SetTiming(REPLAY_FAST);
+  Check(RunSettingsSession(&replay, 7), "changed session still replays");
+  replay.GetReport(&report);
+  printf("  changed session: %llu divergence(s), first: %s\n", report.divergences,
+         replay.GetFirstDivergence().c_str());
+  Check(report.divergences == 1 && report.remaining == 0, "changed setting reported as a divergence");
+
+  remove(SMBUS_SESSION_PATH);
+}
+
+bool RunSettingsSession(SmBusTransport* transport, int luma)
+{
+  XboxHdmi xboxHdmi(transport);
+  VersionCode firmwareVersion;
+  return xboxHdmi.LoadConfig() && xboxHdmi.GetFirmwareVersion(&firmwareVersion) &&
+         xboxHdmi.SetFeatureCurrentValue(SupportedFeatures::LUMA_ADJUST, luma) &&
+         xboxHdmi.UpdateConfigValues() && xboxHdmi.SaveConfig();
+}
+
+void RunFirmwareCatalogChecks()
+{
+  printf("Firmware catalog\n");
+
+  std::vector<uint8_t> image;
+  if(!WriteFirmwareImage(CATALOG_IMAGE_PATH, &image))
+  {
+    Check(false, "firmware image written");
+    return;
+  }
+
+  // Every query finds the source expired
+  FirmwareCatalog catalog;
+  catalog.AddSearchPath(UpdateSource::DVD, CATALOG_IMAGE_PATH);
+  catalog.SetSourcePreparation(UpdateSource::DVD, PrepareSlowSource);
+  catalog.SetTimeToLive(0);
+  Check(catalog.IsUpdateAvailable(UpdateSource::DVD), "first query waits for the first scan");
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  bool updateAvailable = true;
+  for(int query = 0; query < 100; ++query)
+  {
+    updateAvailable = updateAvailable && catalog.IsUpdateAvailable(UpdateSource::DVD);
+  }
+  long long elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                          std::chrono::steady_clock::now() - start).count();
+  printf("  100 queries of an expired source in %lld ms\n", elapsedMs);
+  Check(updateAvailable && elapsedMs < SLOW_SOURCE_PREPARE_MS, "expired source answered from the last index");
+
+  // Picked up once a background scan completes
+  remove(CATALOG_IMAGE_PATH);
+  std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() +
+                                                   std::chrono::milliseconds(SLOW_SOURCE_PREPARE_MS * 10);
+  while(catalog.IsUpdateAvailable(UpdateSource::DVD) && std::chrono::steady_clock::now() < deadline)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  Check(!catalog.IsUpdateAvailable(UpdateSource::DVD), "background scan replaces the index");
+
+  // Only an explicit refresh notices the file coming back
+  catalog.SetTimeToLive(60000);
+  WriteFirmwareImage(CATALOG_IMAGE_PATH, &image);
+  start = std::chrono::steady_clock::now();
+  catalog.Refresh();
+  elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+  Check(elapsedMs < SLOW_SOURCE_PREPARE_MS, "Refresh() returns before the scan completes");
+
+  deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(SLOW_SOURCE_PREPARE_MS * 10);
+  while(!catalog.IsUpdateAvailable(UpdateSource::DVD) && std::chrono::steady_clock::now() < deadline)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  Check(catalog.IsUpdateAvailable(UpdateSource::DVD), "refreshed index published when the scan completes");
+  remove(CATALOG_IMAGE_PATH);
+}
+
+bool PrepareSlowSource()
+{
+  std::this_thread::sleep_for(std::chrono::milliseconds(SLOW_SOURCE_PREPARE_MS));
+  return true;
+}
+
+void RunFirmwareUpdate(HdmiTools* hdmiTools, SimulatedXboxHdmi* device)
+{
+  printf("Firmware update\n");
+
+  std::vector<uint8_t> image;
+  if(!WriteFirmwareImage(FIRMWARE_IMAGE_PATH, &image))
+  {
+    Check(false, "firmware image written");
+    return;
+  }
+
+  // Start as a console this library has never flashed
+  remove(DEFAULT_FLASH_MANIFEST_PATH);
+
+  // Left behind for another image of the same size, it has to be rebuilt
+  Check(WriteStaleFlashPlan(image), "stale flash plan written");
+
+  FirmwareUpdateOptions options;
+  options.verifyAfterFlash = true;
+  Check(hdmiTools->SetFirmwareUpdateOptions(options), "SetFirmwareUpdateOptions() with verification");
+  Check(hdmiTools->IsUpdateAvailable(UpdateSource::WORKING_DIRECTORY, FIRMWARE_IMAGE_PATH),
+        "IsUpdateAvailable() sees the image");
+
+  // What the device reports once it boots the new image
+  device->SetFirmwareVersion(1, 3, 0);
+
+  // Busy for a moment after every page write, so busy reporting is seen and trusted
+  device->SetPageProgramLatencyMs(PAGE_PROGRAM_LATENCY_MS);
+
+  unsigned long long transactions = device->GetTransactionCount();
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  Check(hdmiTools->UpdateFirmware(UpdateSource::WORKING_DIRECTORY, nullptr, nullptr, nullptr, nullptr,
+                                  FIRMWARE_IMAGE_PATH), "UpdateFirmware() started");
+
+  FirmwareUpdateEvent event;
+  bool updateSuccessful = false;
+  int pagesDone = 0;
+  while(true)
+  {
+    if(!hdmiTools->PollFirmwareUpdateEvent(&event))
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      continue;
+    }
+
+    if(event.type == EVENT_ERROR)
+    {
+      printf("         error: %s\n", event.message);
+    }
+    else if(event.type == EVENT_PAGE_DONE)
+    {
+      ++pagesDone;
+    }
+    else if(event.type == EVENT_UPDATE_COMPLETE)
+    {
+      updateSuccessful = (event.value == 1);
+      break;
+    }
+  }
+  double elapsedMs = (double)std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::steady_clock::now() - start).count() / 1000.0;
+  transactions = device->GetTransactionCount() - transactions;
+
+  Check(updateSuccessful, "update completed successfully");
+  Check(pagesDone == (int)PROGRAMMABLE_PAGES, "every page reported done");
+
+  FirmwareUpdateProgress progress;
+  hdmiTools->GetFirmwareUpdateProgress(&progress);
+  Check(progress.droppedEvents == 0, "no events dropped");
+
+  FirmwareUpdateReport report;
+  Check(hdmiTools->GetFirmwareUpdateReport(&report) && report.updateSuccessful && report.verifyPerformed &&
+        report.pagesReflashed == 0, "report shows a verified update");
+
+  bool pagesMatch = true;
+  uint8_t flashedPage[XBOX_HDMI_PAGE_SIZE];
+  for(uint32_t pageIndex = 0; pageIndex < PROGRAMMABLE_PAGES; ++pageIndex)
+  {
+    pagesMatch = pagesMatch && device->GetFlashedPage(pageIndex, flashedPage) &&
+                 memcmp(flashedPage, image.data() + (pageIndex * XBOX_HDMI_PAGE_SIZE), XBOX_HDMI_PAGE_SIZE) == 0;
+  }
+  Check(pagesMatch, "device flash matches the padded image");
+
+  printf("  %.1f ms for %u pages, bus %llu us, device waits %llu us\n", elapsedMs, PROGRAMMABLE_PAGES,
+         report.stageTimings.busUs, report.stageTimings.deviceWaitUs);
+
+  printf("  %llu transactions\n", transactions);
+  Check(report.stageTimings.deviceWaitUs < PROG_READY_FIXED_DELAY_MS * 1000ULL,
+        "busy reporting detected, no fixed delays");
+
+  VersionCode firmwareVersion = hdmiTools->GetFirmwareVersion();
+  Check(firmwareVersion.GetMajor() == 1 && firmwareVersion.GetMinor() == 3 && firmwareVersion.GetPatch() == 0,
+        "version read again after the update");
+
+  device->SetPageProgramLatencyMs(0);
+  remove(DEFAULT_FLASH_MANIFEST_PATH);
+  remove(DEFAULT_FLASH_PLAN_WORKING_DIRECTORY);
+  remove(FIRMWARE_IMAGE_PATH);
+}
+
+void RunDispatchBenchmark(SimulatedXboxHdmi* device, int transactions)
+{
+  printf("Transport dispatch, %d reads per path\n", transactions);
+
+  uint8_t value = 0;
+  uint32_t sink = 0;
+
+  // Qualified call, so the compiler binds it statically
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for(int transaction = 0; transaction < transactions; ++transaction)
+  {
+    device->SimulatedXboxHdmi::ReadByte(I2C_HDMI_ADRESS, I2C_BOOT_MODE, &value);
+    sink += value;
+  }
+  double directNs = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now() - start).count() / transactions;
+
+  start = std::chrono::steady_clock::now();
+  for(int transaction = 0; transaction < transactions; ++transaction)
+  {
+    ReadThroughInterface(device, &value);
+    sink += value;
+  }
+  double interfaceNs = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::steady_clock::now() - start).count() / transactions;
+
+  // What XboxHdmi actually pays, a job on the SMBus worker per transaction
+  SmBusWorker worker;
+  int workerTransactions = transactions / 10 > 0 ? transactions / 10 : 1;
+  start = std::chrono::steady_clock::now();
+  for(int transaction = 0; transaction < workerTransactions; ++transaction)
+  {
+    worker.Run(INTERACTIVE_JOB, true, [device, &value]() {
+      return ReadThroughInterface(device, &value);
+    });
+    sink += value;
+  }
+  double workerNs = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now() - start).count() / workerTransactions;
+
+  double dispatchNs = interfaceNs > directNs ? interfaceNs - directNs : 0.0;
+  printf("  direct call:            %10.1f ns/read (checksum %08x)\n", directNs, sink);
+  printf("  SmBusTransport:         %10.1f ns/read\n", interfaceNs);
+  printf("  SmBusWorker job:        %10.1f ns/read\n", workerNs);
+  printf("  virtual dispatch:       %10.1f ns, %.5f%% of a %.0f us bus read\n",
+         dispatchNs, (dispatchNs / 1000.0) / SMBUS_BYTE_READ_US * 100.0, SMBUS_BYTE_READ_US);
+
+  Check(dispatchNs / 1000.0 < SMBUS_BYTE_READ_US / 1000.0, "dispatch costs under 0.1% of a bus read");
+}
+
+void RunTracerBenchmark(int transactions)
+{
+  printf("SMBus tracer, %d reads per path\n", transactions);
+
+  SimulatedXboxHdmi device;
+  SmBusTracer tracer(&device);
+  uint8_t value = 0;
+  uint32_t sink = 0;
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for(int transaction = 0; transaction < transactions; ++transaction)
+  {
+    ReadThroughInterface(&device, &value);
+    sink += value;
+  }
+  double untracedNs = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start).count() / transactions;
+
+  start = std::chrono::steady_clock::now();
+  for(int transaction = 0; transaction < transactions; ++transaction)
+  {
+    ReadThroughInterface(&tracer, &value);
+    sink += value;
+  }
+  double tracedNs = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now() - start).count() / transactions;
+
+  double overheadNs = tracedNs > untracedNs ? tracedNs - untracedNs : 0.0;
+  printf("  untraced:               %10.1f ns/read (checksum %08x)\n", untracedNs, sink);
+  printf("  traced:                 %10.1f ns/read\n", tracedNs);
+  printf("  tracing overhead:       %10.1f ns, budget %.0f ns\n", overheadNs, TRACE_BUDGET_NS);
+  Check(overheadNs < TRACE_BUDGET_NS, "tracing stays within its budget");
+
+  uint32_t expectedRecords = (uint32_t)transactions < SmBusTracer::RECORD_CAPACITY ?
+                             (uint32_t)transactions : SmBusTracer::RECORD_CAPACITY;
+  SmBusTraceRecord newest;
+  Check(tracer.GetRecordCount() == expectedRecords &&
+        tracer.GetRecord(expectedRecords - 1, &newest) && newest.sequence == (uint32_t)transactions - 1 &&
+        newest.command == I2C_BOOT_MODE && newest.operation == TRACE_READ_BYTE && newest.result == SMBUS_OK,
+        "ring buffer keeps the newest transactions");
+
+  // Settings round trips on a device with bus-like latency, left behind for Tools/Trace_Decoder
+  device.SetTransactionLatencyUs(50);
+  XboxHdmi xboxHdmi(&device);
+  xboxHdmi.LoadConfig();
+  for(int round = 0; round < 100; ++round)
+  {
+    xboxHdmi.SetFeatureCurrentValue(SupportedFeatures::LUMA_ADJUST, round % 10);
+    xboxHdmi.UpdateConfigValues();
+    xboxHdmi.LoadConfig();
+  }
+#ifdef CONFLUX_SMBUS_TRACE
+  Check(xboxHdmi.DumpBusTrace(SMBUS_TRACE_PATH), "bus trace dumped");
+  printf("  settings round trips traced to %s\n", SMBUS_TRACE_PATH);
+#else
+  Check(!xboxHdmi.DumpBusTrace(SMBUS_TRACE_PATH), "no trace without CONFLUX_SMBUS_TRACE");
+#endif
+}
+
+bool ReadThroughInterface(SmBusTransport* transport, uint8_t* value)
+{
+  return transport->ReadByte(I2C_HDMI_ADRESS, I2C_BOOT_MODE, value);
+}
+
+bool WriteFirmwareImage(const char* path, std::vector<uint8_t>* image)
+{
+  // Half a page short of full, so the last page exercises padding
+  uint32_t imageSize = (PROGRAMMABLE_PAGES * XBOX_HDMI_PAGE_SIZE) - (XBOX_HDMI_PAGE_SIZE / 2);
+  image->assign(PROGRAMMABLE_PAGES * XBOX_HDMI_PAGE_SIZE, 0x00);
+  for(uint32_t index = 0; index < imageSize; ++index)
+  {
+    (*image)[index] = (uint8_t)((index * 2654435761u) >> 13);
+  }
+
+  FILE* imageFile = fopen(path, "wb");
+  if(imageFile == nullptr)
+  {
+    return false;
+  }
+
+  bool imageWritten = fwrite(image->data(), 1, imageSize, imageFile) == imageSize;
+  return (fclose(imageFile) == 0) && imageWritten;
+}
+
+bool WriteStaleFlashPlan(const std::vector<uint8_t>& image)
+{
+  uint32_t imageSize = (PROGRAMMABLE_PAGES * XBOX_HDMI_PAGE_SIZE) - (XBOX_HDMI_PAGE_SIZE / 2);
+  std::vector<uint8_t> otherImage(image.begin(), image.begin() + imageSize);
+  otherImage[0] ^= 0xFF;
+
+  FlashPlan flashPlan;
+  uint8_t serializedPlan[FlashPlan::SERIALIZED_SIZE];
+  if(!flashPlan.Build(otherImage.data(), (long)otherImage.size()) ||
+     !flashPlan.Serialize(serializedPlan, sizeof(serializedPlan)))
+  {
+    return false;
+  }
+
+  FILE* planFile = fopen(DEFAULT_FLASH_PLAN_WORKING_DIRECTORY, "wb");
+  if(planFile == nullptr)
+  {
+    return false;
+  }
+
+  bool planWritten = fwrite(serializedPlan, 1, sizeof(serializedPlan), planFile) == sizeof(serializedPlan);
+  return (fclose(planFile) == 0) && planWritten;
+}
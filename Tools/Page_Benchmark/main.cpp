@@ -0,0 +1,299 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "Crc32.h"
+#include "PageArena.h"
+
+using namespace Conflux;
+using namespace Conflux::XboxHDMI;
+
+// Fixed so a failing case can be reproduced
+const uint32_t CRC_DIFFERENTIAL_SEED = 0x5EED1234;
+const int CRC_DIFFERENTIAL_TRIALS = 20000;
+const size_t CRC_DIFFERENTIAL_MAX_LENGTH = 3 * XBOX_HDMI_PAGE_SIZE;
+
+// Old flash path, one call per byte with a bounds check for the padding
+uint32_t LegacyCrcAddByte(uint32_t crc, uint8_t addByte) __attribute__((noinline));
+void LegacyGeneratePageCrc(uint32_t* crcValue, const uint8_t* firmwareFile, uint32_t offset, long fileSize) __attribute__((noinline));
+uint8_t LegacyPageDataByte(const uint8_t* firmwareFile, uint32_t offset, long fileSize) __attribute__((noinline));
+uint32_t LegacyCrcResult(uint32_t crc);
+uint32_t ReferenceCrc(const uint8_t* data, size_t length);
+bool RunCrcDifferentialCheck(int trials);
+
+uint32_t ReferenceCrc(const uint8_t* data, size_t length)
+{
+  uint32_t crc = CRC_INIT;
+  for(size_t index = 0; index < length; ++index)
+  {
+    crc = LegacyCrcAddByte(crc, data[index]);
+  }
+  return LegacyCrcResult(crc);
+}
+
+bool RunCrcDifferentialCheck(int trials)
+{
+  std::mt19937 random(CRC_DIFFERENTIAL_SEED);
+  std::vector<uint8_t> buffer(CRC_DIFFERENTIAL_MAX_LENGTH + 8);
+
+  for(int trial = 0; trial < trials; ++trial)
+  {
+    // Short lengths are where the tail handling lives, so they get a share of their own
+    size_t length = (trial % 4 == 0) ? random() % 32 : random() % (CRC_DIFFERENTIAL_MAX_LENGTH + 1);
+    size_t alignment = random() % 8;
+    size_t split = (length > 0) ? random() % (length + 1) : 0;
+    const uint8_t* data = buffer.data() + alignment;
+
+    for(size_t index = 0; index < length; ++index)
+    {
+      buffer[alignment + index] = (uint8_t)random();
+    }
+
+    uint32_t expected = ReferenceCrc(data, length);
+    uint32_t whole = Crc32::Compute(data, length);
+    uint32_t pieces = Crc32::Finalize(Crc32::Update(Crc32::Update(Crc32::INITIAL_VALUE, data, split),
+                                                    data + split, length - split));
+    if(whole != expected || pieces != expected)
+    {
+      printf("CRC differs from the per byte reference: length %u, alignment %u, split %u "
+             "(reference %08x, whole %08x, split %08x)\n", (uint32_t)length, (uint32_t)alignment,
+             (uint32_t)split, expected, whole, pieces);
+      return false;
+    }
+
+    // Padding goes through UpdateZeros(), it has to match zero bytes fed one at a time
+    memset(buffer.data() + alignment + split, 0x00, length - split);
+    expected = ReferenceCrc(data, length);
+    uint32_t padded = Crc32::Finalize(Crc32::UpdateZeros(Crc32::Update(Crc32::INITIAL_VALUE, data, split),
+                                                         length - split));
+    if(padded != expected)
+    {
+      printf("Zero padded CRC differs from the per byte reference: length %u, alignment %u, zeros %u "
+             "(reference %08x, padded %08x)\n", (uint32_t)length, (uint32_t)alignment,
+             (uint32_t)(length - split), expected, padded);
+      return false;
+    }
+  }
+
+  printf("CRC matches the per byte reference over %d random lengths and alignments\n", trials);
+  return true;
+}
+
+uint32_t LegacyPreparePage(const std::vector<uint8_t>& image, uint32_t pageIndex, uint32_t* dataSum);
+uint32_t ArenaPreparePage(const std::vector<uint8_t>& image, PageArena* arena, uint32_t pageIndex, uint32_t* dataSum);
+bool ReadImage(const char* path, std::vector<uint8_t>* image);
+
+int main(int argc, char* argv[])
+{
+  std::vector<uint8_t> image;
+  int iterations = 200;
+
+  if(argc > 1 && !ReadImage(argv[1], &image))
+  {
+    printf("Unable to read %s\n", argv[1]);
+    return 1;
+  }
+  if(argc > 2)
+  {
+    iterations = atoi(argv[2]);
+  }
+  if(image.empty())
+  {
+    // Half a page short of full, so the last page exercises padding
+    image.resize((PROGRAMMABLE_PAGES * XBOX_HDMI_PAGE_SIZE) - (XBOX_HDMI_PAGE_SIZE / 2));
+    for(size_t index = 0; index < image.size(); ++index)
+    {
+      image[index] = (uint8_t)((index * 2654435761u) >> 13);
+    }
+  }
+  if(image.size() > PROGRAMMABLE_PAGES * XBOX_HDMI_PAGE_SIZE || iterations <= 0)
+  {
+    printf("Usage: %s [firmware.bin] [iterations]\n", argv[0]);
+    return 1;
+  }
+
+  // The table driven CRC has to match the per byte one for any length and alignment
+  if(!RunCrcDifferentialCheck(CRC_DIFFERENTIAL_TRIALS))
+  {
+    return 1;
+  }
+
+  // Both paths have to agree before their timings mean anything
+  PageArena* arena = new PageArena;
+  for(uint32_t pageIndex = 0; pageIndex < PROGRAMMABLE_PAGES; ++pageIndex)
+  {
+    uint32_t legacySum = 0;
+    uint32_t arenaSum = 0;
+    if(LegacyPreparePage(image, pageIndex, &legacySum) != ArenaPreparePage(image, arena, pageIndex, &arenaSum) ||
+       legacySum != arenaSum)
+    {
+      printf("Page %u differs between the legacy and arena paths\n", pageIndex);
+      delete arena;
+      return 1;
+    }
+  }
+
+  uint32_t sink = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for(int iteration = 0; iteration < iterations; ++iteration)
+  {
+    for(uint32_t pageIndex = 0; pageIndex < PROGRAMMABLE_PAGES; ++pageIndex)
+    {
+      sink += LegacyPreparePage(image, pageIndex, &sink);
+    }
+  }
+  double legacyNs = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now() - start).count();
+
+  start = std::chrono::steady_clock::now();
+  for(int iteration = 0; iteration < iterations; ++iteration)
+  {
+    for(uint32_t pageIndex = 0; pageIndex < PROGRAMMABLE_PAGES; ++pageIndex)
+    {
+      sink += ArenaPreparePage(image, arena, pageIndex, &sink);
+    }
+  }
+  double arenaNs = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     std::chrono::steady_clock::now() - start).count();
+  delete arena;
+
+  double pages = (double)iterations * PROGRAMMABLE_PAGES;
+  printf("Image: %u bytes, %d passes over %u pages (checksum %08x)\n",
+         (uint32_t)image.size(), iterations, PROGRAMMABLE_PAGES, sink);
+  printf("  legacy per byte path: %10.0f ns/page\n", legacyNs / pages);
+  printf("  page arena path:      %10.0f ns/page\n", arenaNs / pages);
+  printf("  speedup:              %10.1fx\n", legacyNs / arenaNs);
+
+  return 0;
+}
+
+uint32_t LegacyCrcAddByte(uint32_t crc, uint8_t addByte)
+{
+  for(uint8_t bitPosition = 0x01; bitPosition > 0; bitPosition <<= 1)
+  {
+    uint32_t mostSignificantBit = crc & 0x80000000;
+    if(addByte & bitPosition)
+    {
+      mostSignificantBit ^= 0x80000000;
+    }
+
+    crc = mostSignificantBit ? ((crc << 1) ^ 0x4C11DB7) : (crc << 1);
+  }
+  return crc;
+}
+
+void LegacyGeneratePageCrc(uint32_t* crcValue, const uint8_t* firmwareFile, uint32_t offset, long fileSize)
+{
+  if(offset < fileSize)
+  {
+    *crcValue = LegacyCrcAddByte(*crcValue, firmwareFile[offset]);
+  }
+  else
+  {
+    *crcValue = LegacyCrcAddByte(*crcValue, 0x00);
+  }
+}
+
+uint8_t LegacyPageDataByte(const uint8_t* firmwareFile, uint32_t offset, long fileSize)
+{
+  return (offset < fileSize) ? firmwareFile[offset] : 0x00;
+}
+
+uint32_t LegacyCrcResult(uint32_t crc)
+{
+  uint32_t reversed = 0;
+  for(int bit = 0; bit < 32; ++bit)
+  {
+    reversed = (reversed << 1) | (crc & 0x01);
+    crc >>= 1;
+  }
+  return reversed ^ 0xFFFFFFFF;
+}
+
+uint32_t LegacyPreparePage(const std::vector<uint8_t>& image, uint32_t pageIndex, uint32_t* dataSum)
+{
+  uint32_t pageOffset = pageIndex * XBOX_HDMI_PAGE_SIZE;
+  uint32_t crcValue = CRC_INIT;
+
+  for(uint32_t index = 0; index < XBOX_HDMI_PAGE_SIZE; ++index)
+  {
+    LegacyGeneratePageCrc(&crcValue, image.data(), pageOffset + index, (long)image.size());
+  }
+
+  // Stands in for the bytes handed to the bus one at a time
+  for(uint32_t index = 0; index < XBOX_HDMI_PAGE_SIZE; ++index)
+  {
+    *dataSum += LegacyPageDataByte(image.data(), pageOffset + index, (long)image.size());
+  }
+
+  return LegacyCrcResult(crcValue);
+}
+
+uint32_t ArenaPreparePage(const std::vector<uint8_t>& image, PageArena* arena, uint32_t pageIndex, uint32_t* dataSum)
+{
+  uint32_t pageOffset = pageIndex * XBOX_HDMI_PAGE_SIZE;
+  uint32_t bytesInImage = 0;
+  uint8_t* page = arena->GetPage(pageIndex);
+
+  if(pageOffset < image.size())
+  {
+    bytesInImage = (uint32_t)image.size() - pageOffset;
+    if(bytesInImage > XBOX_HDMI_PAGE_SIZE)
+    {
+      bytesInImage = XBOX_HDMI_PAGE_SIZE;
+    }
+    memcpy(page, image.data() + pageOffset, bytesInImage);
+  }
+  memset(page + bytesInImage, 0x00, XBOX_HDMI_PAGE_SIZE - bytesInImage);
+  arena->MarkPrepared(pageIndex, Crc32::Compute(page, XBOX_HDMI_PAGE_SIZE));
+
+  for(uint32_t index = 0; index < XBOX_HDMI_PAGE_SIZE; ++index)
+  {
+    *dataSum += page[index];
+  }
+
+  return arena->GetPageCrc(pageIndex);
+}
+
+bool ReadImage(const char* path, std::vector<uint8_t>* image)
+{
+  FILE* file = fopen(path, "rb");
+  if(!file)
+  {
+    return false;
+  }
+
+  fseek(file, 0, SEEK_END);
+  long fileSize = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  bool readSuccessful = fileSize > 0;
+  if(readSuccessful)
+  {
+    image->resize((size_t)fileSize);
+    readSuccessful = fread(image->data(), 1, image->size(), file) == image->size();
+  }
+
+  fclose(file);
+  return readSuccessful;
+}
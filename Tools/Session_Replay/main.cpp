@@ -0,0 +1,184 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "HdmiTools.h"
+#include "SimulatedXboxHdmi.h"
+#include "SmBusTracer.h"
+#include "SmBusReplay.h"
+#include "XboxHDMI_Config.h"
+
+using namespace Conflux;
+using namespace Conflux::XboxHDMI;
+
+// Stand-ins for the console when a session is recorded on a PC
+const uint32_t SIMULATED_TRANSACTION_LATENCY_US = 20;
+const uint32_t SIMULATED_PAGE_PROGRAM_LATENCY_MS = 2;
+
+void PrintUsage(const char* toolName);
+bool RunSession(HdmiTools* hdmiTools, SmBusTransport* transport, const char* firmwarePath);
+int Record(const char* firmwarePath, const char* sessionPath);
+int Replay(const char* firmwarePath, const char* sessionPath, SmBusReplayTiming timing);
+
+int main(int argc, char* argv[])
+{
+  if(argc == 4 && strcmp(argv[1], "record") == 0)
+  {
+    return Record(argv[2], argv[3]);
+  }
+  else if(argc == 4 && strcmp(argv[1], "replay") == 0)
+  {
+    return Replay(argv[2], argv[3], REPLAY_RECORDED_TIMING);
+  }
+  else if(argc == 4 && strcmp(argv[1], "replay-fast") == 0)
+  {
+    return Replay(argv[2], argv[3], REPLAY_FAST);
+  }
+
+  PrintUsage(argv[0]);
+  return 1;
+}
+
+void PrintUsage(const char* toolName)
+{
+  printf("Usage:\n");
+  printf("  %s record <firmware.bin> <session file>\n", toolName);
+  printf("  %s replay <firmware.bin> <session file>\n", toolName);
+  printf("  %s replay-fast <firmware.bin> <session file>\n", toolName);
+  printf("\n");
+  printf("Every mode runs the same session: initialize, read the version, edit and\n");
+  printf("save a setting, then flash firmware.bin. Sessions recorded on a console\n");
+  printf("must come from an application doing the same, with an SmBusTracer given\n");
+  printf("to HdmiTools::SetSmBusTransport() and StartRecording() called on it.\n");
+}
+
+bool RunSession(HdmiTools* hdmiTools, SmBusTransport* transport, const char* firmwarePath)
+{
+  // A console that has never been flashed by this library
+  remove(DEFAULT_FLASH_MANIFEST_PATH);
+
+  if(!hdmiTools->SetSmBusTransport(transport) || !hdmiTools->Initialize())
+  {
+    printf("Initialize() failed\n");
+    return false;
+  }
+
+  printf("Firmware %s\n", hdmiTools->GetFirmwareVersion().GetVersionCodeAsCString());
+
+  int luma, lumaMin, lumaMax;
+  if(!hdmiTools->GetFeatureValues(SupportedFeatures::LUMA_ADJUST, &luma, &lumaMin, &lumaMax) ||
+     !hdmiTools->SetFeatureValue(SupportedFeatures::LUMA_ADJUST, luma < lumaMax ? luma + 1 : lumaMin) ||
+     !hdmiTools->UpdateFeatureConfig() || !hdmiTools->SaveSettings())
+  {
+    printf("Editing settings failed\n");
+    return false;
+  }
+
+  if(!hdmiTools->UpdateFirmware(UpdateSource::WORKING_DIRECTORY, nullptr, nullptr, nullptr, nullptr, firmwarePath))
+  {
+    printf("UpdateFirmware() failed to start\n");
+    return false;
+  }
+
+  FirmwareUpdateEvent event;
+  while(true)
+  {
+    if(!hdmiTools->PollFirmwareUpdateEvent(&event))
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      continue;
+    }
+
+    if(event.type == EVENT_ERROR)
+    {
+      printf("  error: %s\n", event.message);
+    }
+    else if(event.type == EVENT_UPDATE_COMPLETE)
+    {
+      printf("Update %s\n", event.value == 1 ? "succeeded" : "failed");
+      break;
+    }
+  }
+
+  printf("Firmware %s\n", hdmiTools->GetFirmwareVersion().GetVersionCodeAsCString());
+  remove(DEFAULT_FLASH_MANIFEST_PATH);
+  return event.value == 1;
+}
+
+int Record(const char* firmwarePath, const char* sessionPath)
+{
+  // Outlive the singleton, which is never torn down
+  static SimulatedXboxHdmi device;
+  static SmBusTracer recorder(&device);
+  device.SetTransactionLatencyUs(SIMULATED_TRANSACTION_LATENCY_US);
+  device.SetPageProgramLatencyMs(SIMULATED_PAGE_PROGRAM_LATENCY_MS);
+
+  if(!recorder.StartRecording(sessionPath))
+  {
+    printf("Unable to create %s\n", sessionPath);
+    return 1;
+  }
+
+  bool sessionSuccessful = RunSession(HdmiTools::GetInstance(), &recorder, firmwarePath);
+  if(!recorder.StopRecording())
+  {
+    printf("Unable to write %s\n", sessionPath);
+    return 1;
+  }
+
+  printf("Recorded %llu transactions to %s\n", device.GetTransactionCount(), sessionPath);
+  return sessionSuccessful ? 0 : 1;
+}
+
+int Replay(const char* firmwarePath, const char* sessionPath, SmBusReplayTiming timing)
+{
+  static SmBusReplay replay;
+  if(!replay.Load(sessionPath))
+  {
+    printf("%s is not a recorded session\n", sessionPath);
+    return 1;
+  }
+  replay.SetTiming(timing);
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  bool sessionSuccessful = RunSession(HdmiTools::GetInstance(), &replay, firmwarePath);
+  double elapsedMs = (double)std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::steady_clock::now() - start).count() / 1000.0;
+
+  SmBusReplayReport report;
+  replay.GetReport(&report);
+  double deltaMs = ((double)report.replayedUs - (double)report.recordedUs) / 1000.0;
+  printf("\n%s replay of %s\n", timing == REPLAY_FAST ? "Fast" : "Timed", sessionPath);
+  printf("  transactions:  %llu replayed, %llu never reached\n", report.transactions, report.remaining);
+  printf("  divergences:   %llu, %llu recorded transactions skipped\n", report.divergences, report.skipped);
+  if(report.divergences > 0)
+  {
+    printf("  first:         %s\n", replay.GetFirstDivergence().c_str());
+  }
+  printf("  recorded:      %10.1f ms\n", (double)report.recordedUs / 1000.0);
+  printf("  replayed:      %10.1f ms (%+.1f ms, %+.1f%%)\n", (double)report.replayedUs / 1000.0, deltaMs,
+         report.recordedUs > 0 ? deltaMs * 100000.0 / (double)report.recordedUs : 0.0);
+  printf("  whole session: %10.1f ms\n", elapsedMs);
+
+  return (sessionSuccessful && report.divergences == 0 && report.remaining == 0) ? 0 : 1;
+}
@@ -0,0 +1,170 @@
+/*
+Copyright 2021 Chase Cobb
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "SmBusTransport.h"
+#include "SmBusTraceFormat.h"
+
+using namespace Conflux;
+
+// Latencies of one register and operation
+struct LatencyGroup
+{
+  std::vector<uint32_t> durationsNs;
+  uint32_t failures = 0;
+};
+
+void PrintUsage(const char* toolName);
+const char* OperationName(uint8_t operation);
+const char* ResultName(uint8_t result);
+double Percentile(const std::vector<uint32_t>& sortedNs, double percentile);
+void PrintSummary(const std::vector<SmBusTraceRecord>& records);
+void PrintTail(const std::vector<SmBusTraceRecord>& records, size_t tailLength);
+
+int main(int argc, char* argv[])
+{
+  if(argc != 2 && argc != 3)
+  {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  std::vector<SmBusTraceRecord> records;
+  if(!ReadTraceFile(argv[1], &records))
+  {
+    printf("%s is not an SMBus trace\n", argv[1]);
+    return 1;
+  }
+
+  PrintSummary(records);
+  if(argc == 3)
+  {
+    PrintTail(records, (size_t)atoi(argv[2]));
+  }
+  return 0;
+}
+
+void PrintUsage(const char* toolName)
+{
+  printf("Usage:\n");
+  printf("  %s <smbus.trace> [transactions to list from the end]\n", toolName);
+}
+
+const char* OperationName(uint8_t operation)
+{
+  switch(operation)
+  {
+    case TRACE_READ_BYTE:
+      return "read byte";
+    case TRACE_WRITE_BYTE:
+      return "write byte";
+    case TRACE_READ_WORD:
+      return "read word";
+    case TRACE_WRITE_WORD:
+      return "write word";
+    default:
+      return "unknown";
+  }
+}
+
+const char* ResultName(uint8_t result)
+{
+  switch(result)
+  {
+    case SMBUS_OK:
+      return "ok";
+    case SMBUS_NAK:
+      return "NAK";
+    case SMBUS_ARBITRATION_LOST:
+      return "ARBITRATION";
+    case SMBUS_BUS_BUSY:
+      return "BUSY";
+    case SMBUS_TIMEOUT:
+      return "TIMEOUT";
+    case SMBUS_INVALID_REQUEST:
+      return "INVALID";
+    default:
+      return "FAILED";
+  }
+}
+
+double Percentile(const std::vector<uint32_t>& sortedNs, double percentile)
+{
+  // Nearest rank
+  size_t rank = (size_t)((percentile / 100.0) * (double)sortedNs.size() + 0.999999);
+  rank = std::max<size_t>(rank, 1);
+  return (double)sortedNs[std::min(rank, sortedNs.size()) - 1] / 1000.0;
+}
+
+void PrintSummary(const std::vector<SmBusTraceRecord>& records)
+{
+  if(records.empty())
+  {
+    printf("Empty trace\n");
+    return;
+  }
+
+  const SmBusTraceRecord& first = records.front();
+  const SmBusTraceRecord& last = records.back();
+  printf("%zu transactions, sequence %u to %u, %u dropped before the first, %.3f ms span\n",
+         records.size(), first.sequence, last.sequence, first.sequence,
+         (double)(last.startNs + last.durationNs - first.startNs) / 1000000.0);
+
+  // Keyed by address, command then operation so the output is in register order
+  std::map<std::pair<uint16_t, uint16_t>, LatencyGroup> groups;
+  for(const SmBusTraceRecord& record : records)
+  {
+    LatencyGroup& group = groups[std::make_pair((uint16_t)((record.address << 8) | record.command),
+                                                (uint16_t)record.operation)];
+    group.durationsNs.push_back(record.durationNs);
+    group.failures += (record.result == SMBUS_OK) ? 0 : 1;
+  }
+
+  printf("addr cmd  operation    count  failed    p50 us    p90 us    p99 us    max us\n");
+  for(std::pair<const std::pair<uint16_t, uint16_t>, LatencyGroup>& entry : groups)
+  {
+    LatencyGroup& group = entry.second;
+    std::sort(group.durationsNs.begin(), group.durationsNs.end());
+    printf("0x%02X 0x%02X %-10s %7zu %7u %9.1f %9.1f %9.1f %9.1f\n",
+           entry.first.first >> 8, entry.first.first & 0xFF, OperationName((uint8_t)entry.first.second),
+           group.durationsNs.size(), group.failures, Percentile(group.durationsNs, 50.0),
+           Percentile(group.durationsNs, 90.0), Percentile(group.durationsNs, 99.0),
+           (double)group.durationsNs.back() / 1000.0);
+  }
+}
+
+void PrintTail(const std::vector<SmBusTraceRecord>& records, size_t tailLength)
+{
+  size_t firstListed = records.size() > tailLength ? records.size() - tailLength : 0;
+  printf("\n  sequence    start us  thread addr cmd  operation   value  result       us\n");
+  for(size_t index = firstListed; index < records.size(); ++index)
+  {
+    const SmBusTraceRecord& record = records[index];
+    printf("%10u %11.1f    %04x 0x%02X 0x%02X %-10s 0x%04X  %-11s %.1f\n", record.sequence,
+           (double)record.startNs / 1000.0, record.thread, record.address, record.command,
+           OperationName(record.operation), record.value, ResultName(record.result),
+           (double)record.durationNs / 1000.0);
+  }
+}